@@ -0,0 +1,189 @@
+#include "ch8_arena.h"
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#define CH8_ARENA_COW 1
+#else
+#define CH8_ARENA_COW 0
+#endif
+
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+struct ch8_arena
+{
+    u8 *base;
+    size_t slotSize;
+    int count;
+
+    // Template every slot starts from: a memfd mapped privately into each
+    // slot, or a plain image copied in where copy-on-write isn't available
+    int fd;
+    ch8_cpu *image;
+};
+
+static size_t roundUp(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+static bool mapSlot(ch8_arena *arena, int i)
+{
+    u8 *slot = arena->base + (size_t)i * arena->slotSize;
+
+#if CH8_ARENA_COW
+    // MAP_FIXED replaces the old mapping, discarding any pages the slot dirtied
+    void *ptr = mmap(slot, arena->slotSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, arena->fd, 0);
+    return ptr == slot;
+#else
+    memcpy(slot, arena->image, sizeof(ch8_cpu));
+    return true;
+#endif
+}
+
+#if CH8_ARENA_COW
+static int createImageFile(const ch8_cpu *image, size_t size)
+{
+    int fd = memfd_create("ch8_arena", MFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    const u8 *data = (const u8 *)image;
+    size_t done = 0;
+    while (done < sizeof(ch8_cpu)) {
+        ssize_t n = write(fd, data + done, sizeof(ch8_cpu) - done);
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        done += (size_t)n;
+    }
+
+    return fd;
+}
+#endif
+
+ch8_arena *ch8_arenaCreate(const u8 *program, size_t size, u32 quirks, int count)
+{
+    assert(program != NULL || size == 0);
+    assert(count > 0);
+
+    if (size > CH8_MAX_PROGRAM_SIZE) {
+        ch8_logError("Program too large for the arena (%zu bytes)", size);
+        return NULL;
+    }
+
+    ch8_arena *arena = (ch8_arena *)ch8_malloc(sizeof(ch8_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->count = count;
+    arena->fd = -1;
+
+    arena->image = (ch8_cpu *)aligned_alloc(CH8_CACHE_LINE, sizeof(ch8_cpu));
+    if (arena->image == NULL) {
+        ch8_arenaDestroy(&arena);
+        return NULL;
+    }
+    ch8_reset(arena->image);
+    ch8_loadRomData(arena->image, program, size);
+    ch8_setQuirks(arena->image, quirks);
+    ch8_markClean(arena->image);
+
+#if CH8_ARENA_COW
+    // Slots are whole pages so each one can be its own private mapping
+    arena->slotSize = roundUp(sizeof(ch8_cpu), (size_t)sysconf(_SC_PAGESIZE));
+
+    arena->fd = createImageFile(arena->image, arena->slotSize);
+    if (arena->fd < 0) {
+        ch8_logError("Could not create the arena template image");
+        ch8_arenaDestroy(&arena);
+        return NULL;
+    }
+
+    // Reserve the whole range up front so the instances stay contiguous
+    void *base = mmap(NULL, arena->slotSize * count, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        ch8_logError("Could not reserve %d arena slots", count);
+        ch8_arenaDestroy(&arena);
+        return NULL;
+    }
+    arena->base = (u8 *)base;
+#else
+    arena->slotSize = roundUp(sizeof(ch8_cpu), CH8_CACHE_LINE);
+    arena->base = (u8 *)aligned_alloc(CH8_CACHE_LINE, arena->slotSize * count);
+    if (arena->base == NULL) {
+        ch8_logError("Could not allocate %d arena slots", count);
+        ch8_arenaDestroy(&arena);
+        return NULL;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        if (!mapSlot(arena, i)) {
+            ch8_logError("Could not map arena slot %d", i);
+            ch8_arenaDestroy(&arena);
+            return NULL;
+        }
+    }
+
+    ch8_logDebug("Arena of %d VMs created (%zu bytes per slot)", count, arena->slotSize);
+
+    return arena;
+}
+
+void ch8_arenaDestroy(ch8_arena **arena)
+{
+    assert(arena != NULL);
+
+    ch8_arena *a = *arena;
+    if (a == NULL) {
+        return;
+    }
+
+#if CH8_ARENA_COW
+    if (a->base != NULL) {
+        munmap(a->base, a->slotSize * a->count);
+    }
+    if (a->fd >= 0) {
+        close(a->fd);
+    }
+#else
+    free(a->base);
+#endif
+    free(a->image);
+
+    ch8_free((void **)arena);
+}
+
+int ch8_arenaCount(const ch8_arena *arena)
+{
+    assert(arena != NULL);
+    return arena->count;
+}
+
+ch8_cpu *ch8_arenaGet(ch8_arena *arena, int i)
+{
+    assert(arena != NULL);
+    assert(i >= 0 && i < arena->count);
+
+    return (ch8_cpu *)(arena->base + (size_t)i * arena->slotSize);
+}
+
+bool ch8_arenaReset(ch8_arena *arena, int i)
+{
+    assert(arena != NULL);
+    assert(i >= 0 && i < arena->count);
+
+    return mapSlot(arena, i);
+}
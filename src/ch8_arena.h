@@ -0,0 +1,36 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/*
+ * Pool of VMs running the same ROM, packed back to back in one mapping.
+ *
+ * Every instance starts as a copy-on-write view of a single template image
+ * (reset state, font and loaded program), so pages an instance never writes,
+ * which is most of its 64 KB of guest memory, stay shared between all of
+ * them. Resetting an instance drops its private pages again.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct ch8_arena ch8_arena;
+
+/* Returns NULL if the program doesn't fit or the mapping can't be made */
+ch8_arena *ch8_arenaCreate(const u8 *program, size_t size, u32 quirks, int count);
+void ch8_arenaDestroy(ch8_arena **arena);
+
+int ch8_arenaCount(const ch8_arena *arena);
+ch8_cpu *ch8_arenaGet(ch8_arena *arena, int i);
+
+/* Returns instance i to the template state, releasing its private pages */
+bool ch8_arenaReset(ch8_arena *arena, int i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
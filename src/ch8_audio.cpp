@@ -1,31 +1,36 @@
 #include "ch8_audio.h"
 
+#include <assert.h>
 #include <SDL.h>
 
 #include "ch8_log.h"
+#include "ch8_util.h"
 
-static SDL_AudioDeviceID audioDeviceId = 0;
-static int sampleNr = 0;
+struct ch8_audio
+{
+    SDL_AudioDeviceID deviceId;
+    int sampleNr; // advanced by the audio thread only
+};
 
 #define AMPLITUDE 28000
 #define SAMPLE_RATE 44100
 
-#define INIT_CHECK if (audioDeviceId == 0) return
-
 void audioCallback(void* userdata, Uint8* stream, int len)
 {
+    ch8_audio *audio = (ch8_audio *)userdata;
     Sint16 *buffer = (Sint16*)stream;
     len = len / 2; // 2 bytes per sample for AUDIO_S16SYS
-    for (int i = 0; i < len; i++, sampleNr++) {
-        double time = (double)sampleNr / (double)SAMPLE_RATE;
+    for (int i = 0; i < len; i++, audio->sampleNr++) {
+        double time = (double)audio->sampleNr / (double)SAMPLE_RATE;
         buffer[i] = (Sint16)(AMPLITUDE * SDL_sin(2.0f * M_PI * 441.0f * time)); // render 441 HZ sine wave
     }
 }
 
-int ch8_audioInit()
+ch8_audio *ch8_audioCreate()
 {
-    if (audioDeviceId != 0) {
-        return 1;
+    ch8_audio *audio = (ch8_audio *)ch8_malloc(sizeof(ch8_audio));
+    if (audio == NULL) {
+        return NULL;
     }
 
     SDL_AudioSpec want, have;
@@ -36,25 +41,32 @@ int ch8_audioInit()
     want.channels = 1;
     want.samples = 2048;
     want.callback = audioCallback;
+    want.userdata = audio;
 
-    audioDeviceId = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
-    if (audioDeviceId == 0) {
+    audio->deviceId = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (audio->deviceId == 0) {
         ch8_logError("Unable to find a usable audio device");
-        return 1;
+        ch8_free((void **)&audio);
+        return NULL;
     }
 
-    return 0;
+    return audio;
 }
 
-void ch8_audioQuit()
+void ch8_audioDestroy(ch8_audio **audio)
 {
-    INIT_CHECK;
-    SDL_CloseAudioDevice(audioDeviceId);
+    assert(audio != NULL);
+    if (*audio == NULL) {
+        return;
+    }
+
+    SDL_CloseAudioDevice((*audio)->deviceId);
+    ch8_free((void **)audio);
 }
 
-void ch8_audioUpdate(const ch8_cpu* cpu)
+void ch8_audioUpdate(ch8_audio *audio, const ch8_cpu* cpu)
 {
-    INIT_CHECK;
+    assert(audio != NULL);
     int paused = cpu->soundTimer != 0 ? 0 : 1;
-    SDL_PauseAudioDevice(audioDeviceId, paused);
+    SDL_PauseAudioDevice(audio->deviceId, paused);
 }
@@ -8,9 +8,13 @@ extern "C"
 {
 #endif
 
-int ch8_audioInit();
-void ch8_audioQuit();
-void ch8_audioUpdate(const ch8_cpu* cpu);
+/* A beeper on its own audio device, one per session */
+typedef struct ch8_audio ch8_audio;
+
+/* Returns NULL if no usable audio device could be opened */
+ch8_audio *ch8_audioCreate();
+void ch8_audioDestroy(ch8_audio **audio);
+void ch8_audioUpdate(ch8_audio *audio, const ch8_cpu* cpu);
 
 #ifdef __cplusplus
 }
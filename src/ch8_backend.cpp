@@ -0,0 +1,66 @@
+#include "ch8_backend.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "ch8_debug.h"
+#include "ch8_fuse.h"
+#include "ch8_tier.h"
+
+static u32 runReference(ch8_cpu *cpu, u32 budget)
+{
+    u32 n = 0;
+    while (n < budget && !cpu->waitFlag && ch8_clockCycle(cpu, 0.0f)) {
+        n++;
+    }
+    return n;
+}
+
+static u32 runLoop(ch8_cpu *cpu, u32 budget)
+{
+    u64 start = cpu->cycles;
+    ch8_runUntil(cpu, NULL, budget);
+    return (u32)(cpu->cycles - start);
+}
+
+// One engine per thread; it starts over whenever it is handed another VM or a reset one
+static u32 runTiered(ch8_cpu *cpu, u32 budget)
+{
+    static thread_local struct engine
+    {
+        ch8_tier *tier = ch8_tierCreate(NULL);
+        ~engine()
+        {
+            ch8_tierDestroy(&tier);
+        }
+    } engine;
+
+    return ch8_tierRun(engine.tier, cpu, budget);
+}
+
+// The first entry is the reference every other backend is checked against
+static const ch8_backend backends[] = {
+    {"reference", "ch8_clockCycle one instruction at a time", runReference},
+    {"runloop", "uninstrumented ch8_runUntil loop", runLoop},
+    {"fused", "superinstructions for common opcode sequences", ch8_fuseRun},
+    {"tiered", "interpreter promoting hot blocks to decoded blocks", runTiered},
+};
+
+const ch8_backend *ch8_getBackends(int *count)
+{
+    assert(count != NULL);
+    *count = sizeof(backends) / sizeof(backends[0]);
+    return backends;
+}
+
+const ch8_backend *ch8_findBackend(const char *name)
+{
+    assert(name != NULL);
+
+    for (const ch8_backend &backend : backends) {
+        if (strcmp(backend.name, name) == 0) {
+            return &backend;
+        }
+    }
+    return NULL;
+}
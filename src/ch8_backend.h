@@ -0,0 +1,32 @@
+#ifndef __BACKEND_H__
+#define __BACKEND_H__
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Runs up to `budget` cycles and returns how many were executed. Stops early
+ * when the VM halts or waits for a key (FX0A).
+ */
+typedef u32 (*ch8_backendRun)(ch8_cpu *cpu, u32 budget);
+
+/* An execution engine that must be observably equivalent to ch8_clockCycle */
+typedef struct ch8_backend
+{
+    const char *name;
+    const char *description;
+    ch8_backendRun run;
+} ch8_backend;
+
+const ch8_backend *ch8_getBackends(int *count);
+const ch8_backend *ch8_findBackend(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
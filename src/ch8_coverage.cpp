@@ -0,0 +1,82 @@
+#include "ch8_coverage.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ch8_debug.h"
+#include "ch8_log.h"
+
+#define MAP_SIZE 256
+
+void ch8_coverageReset(ch8_coverage *cov)
+{
+    assert(cov != NULL);
+    memset(cov, 0, sizeof(ch8_coverage));
+}
+
+void ch8_coverageRecord(ch8_coverage *cov, const ch8_cpu *cpu, u16 opcode)
+{
+    u16 pc = cpu->programCounter;
+    cov->execs[pc & CH8_ADDR_MASK]++;
+    cov->execs[(pc + 1) & CH8_ADDR_MASK]++;
+
+    ch8_access access;
+    if (ch8_decodeAccess(cpu, opcode, &access) == CH8_ACCESS_NONE) {
+        return;
+    }
+
+    u32 *counters = (access.flags & CH8_ACCESS_WRITE) ? cov->writes : cov->reads;
+    for (u16 i = 0; i < access.length; i++) {
+        counters[(access.address + i) & CH8_ADDR_MASK]++;
+    }
+}
+
+void ch8_coverageSummarize(const ch8_coverage *cov, ch8_coverageSummary *summary)
+{
+    assert(cov != NULL);
+    assert(summary != NULL);
+
+    memset(summary, 0, sizeof(ch8_coverageSummary));
+
+    for (u32 a = 0; a < CH8_MEM_SIZE; a++) {
+        bool data = cov->reads[a] > 0 || cov->writes[a] > 0;
+        if (cov->execs[a] > 0) {
+            summary->codeBytes++;
+            if (data) {
+                summary->mixedBytes++;
+            }
+        } else if (data) {
+            summary->dataBytes++;
+        }
+    }
+}
+
+bool ch8_coverageExport(const ch8_coverage *cov, const char *file)
+{
+    assert(cov != NULL);
+    assert(file != NULL);
+
+    FILE *f = fopen(file, "wb");
+    if (f == NULL) {
+        ch8_logError("Could not open %s for writing", file);
+        return false;
+    }
+
+    fprintf(f, "P6\n%d %d\n255\n", MAP_SIZE, MAP_SIZE);
+
+    for (u32 a = 0; a < CH8_MEM_SIZE; a++) {
+        u8 rgb[3] = {
+            (u8)(cov->writes[a] > 0 ? 255 : 0),
+            (u8)(cov->execs[a] > 0 ? 255 : 0),
+            (u8)(cov->reads[a] > 0 ? 255 : 0),
+        };
+        fwrite(rgb, 1, sizeof(rgb), f);
+    }
+
+    fclose(f);
+
+    ch8_logInfo("Coverage map written to %s", file);
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef __COVERAGE_H__
+#define __COVERAGE_H__
+
+#include <stdbool.h>
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Per-byte access counters for guest memory */
+typedef struct ch8_coverage
+{
+    u32 reads[CH8_MEM_SIZE];  /* DXYN sprite rows, FX65, 5XY3 */
+    u32 writes[CH8_MEM_SIZE]; /* FX33, FX55, 5XY2 */
+    u32 execs[CH8_MEM_SIZE];  /* opcode fetches */
+} ch8_coverage;
+
+typedef struct ch8_coverageSummary
+{
+    u32 codeBytes;  /* executed at least once */
+    u32 dataBytes;  /* read or written but never executed */
+    u32 mixedBytes; /* executed and also accessed as data */
+} ch8_coverageSummary;
+
+void ch8_coverageReset(ch8_coverage *cov);
+void ch8_coverageRecord(ch8_coverage *cov, const ch8_cpu *cpu, u16 opcode);
+void ch8_coverageSummarize(const ch8_coverage *cov, ch8_coverageSummary *summary);
+
+/*
+ * Writes a 256x256 binary PPM, one pixel per byte of guest memory (row-major
+ * from address 0): red = written, green = executed, blue = read.
+ */
+bool ch8_coverageExport(const ch8_coverage *cov, const char *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
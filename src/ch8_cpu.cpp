@@ -1,10 +1,16 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stddef.h>
+#include <array>
+#include <utility>
+#include <vector>
 
 #include "ch8_cpu.h"
 #include "ch8_opcodes.h"
+#include "ch8_quirks.h"
 #include "ch8_log.h"
+#include "ch8_trace.h"
 #include "ch8_util.h"
 
 // clang-format off
@@ -28,34 +34,149 @@ static const u8 font[] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80,
 };
 #define CH8_FONT_SIZE 80
+
+static const u8 bigFont[] = {
+    // SCHIP 8x10 font sprites (0-F)
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C,
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C,
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF,
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C,
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06,
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C,
+    0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C,
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60,
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C,
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C,
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3,
+    0xFE, 0xFF, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xC3, 0xFF, 0xFE,
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C,
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC,
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0,
+};
 // clang-format on
 
+#define CH8_DEFAULT_SEED 0x2F6B3A91
+
+// The hot registers must fit the first cache line, ahead of guest memory
+static_assert(offsetof(ch8_cpu, memory) == CH8_CACHE_LINE, "ch8_cpu hot state spills past one cache line");
+
+// VIP layout: return addresses big-endian at 0xEA0, the 64x32 display one bit per pixel at 0xF00
+static void writeVipStackSlot(ch8_cpu *cpu, int slot)
+{
+    ch8_writeMemory(cpu, CH8_CALL_STACK_OFFSET + slot * 2, cpu->stack[slot] >> 8);
+    ch8_writeMemory(cpu, CH8_CALL_STACK_OFFSET + slot * 2 + 1, cpu->stack[slot] & 0xFF);
+}
+
+static void writeVipRow(ch8_cpu *cpu, int y)
+{
+    u64 row = cpu->framebuffer[0][y][0];
+    for (int b = 0; b < 8; b++) {
+        ch8_writeMemory(cpu, CH8_DISPLAY_REFRESH_OFFSET + y * 8 + b, (u8)(row >> (56 - b * 8)));
+    }
+}
+
+static void writeVipDisplay(ch8_cpu *cpu)
+{
+    for (int y = 0; y < CH8_DISPLAY_HEIGHT; y++) {
+        writeVipRow(cpu, y);
+    }
+}
+
+static void writeVipLayout(ch8_cpu *cpu)
+{
+    for (int i = 0; i < CH8_STACK_DEPTH; i++) {
+        writeVipStackSlot(cpu, i);
+    }
+    writeVipDisplay(cpu);
+}
+
+static void readVipLayout(ch8_cpu *cpu)
+{
+    for (int i = 0; i < CH8_STACK_DEPTH; i++) {
+        cpu->stack[i] = cpu->memory[CH8_CALL_STACK_OFFSET + i * 2] << 8 | cpu->memory[CH8_CALL_STACK_OFFSET + i * 2 + 1];
+    }
+
+    const u8 *display = cpu->memory + CH8_DISPLAY_REFRESH_OFFSET;
+    for (int y = 0; y < CH8_DISPLAY_HEIGHT; y++) {
+        u64 row = 0;
+        for (int b = 0; b < 8; b++) {
+            row = row << 8 | display[y * 8 + b];
+        }
+        cpu->framebuffer[0][y][0] = row;
+    }
+}
+
+// Guest stores may have targeted the mirrored area; otherwise copies what the instruction changed.
+// `drawY` is VY from before the instruction, since DXYN may overwrite it with the collision flag.
+static void mirrorVipLayout(ch8_cpu *cpu, u16 opcode, u8 drawY)
+{
+    switch (opcode & 0xF000)
+    {
+    case 0x0000:
+        // Decoded as in execute(); 00EE only moves the stack pointer, which the VIP keeps in a register
+        if ((opcode & 0xFFF0) == 0x00C0) {
+            writeVipDisplay(cpu);
+            break;
+        }
+        switch (opcode & 0x00FF)
+        {
+        case 0x00E0:
+        case 0x00FB:
+        case 0x00FC:
+        case 0x00FE:
+        case 0x00FF:
+            writeVipDisplay(cpu);
+            break;
+        }
+        break;
+    case 0x2000:
+        writeVipStackSlot(cpu, cpu->stackPointer - 1);
+        break;
+    case 0x5000:
+        if ((opcode & 0x000F) == 2) {
+            readVipLayout(cpu);
+            cpu->drawFlag = true;
+        }
+        break;
+    case 0xD000:
+    {
+        int height = ch8_fbHeight(cpu);
+        int rows = (opcode & 0x000F) == 0 ? 16 : opcode & 0x000F;
+        for (int row = 0; row < rows; row++) {
+            int y = (drawY % height + row) % height;
+            if (y < CH8_DISPLAY_HEIGHT) {
+                writeVipRow(cpu, y);
+            }
+        }
+        break;
+    }
+    case 0xF000:
+        if ((opcode & 0x00FF) == 0x33 || (opcode & 0x00FF) == 0x55) {
+            readVipLayout(cpu);
+            cpu->drawFlag = true;
+        }
+        break;
+    }
+}
+
 void ch8_reset(ch8_cpu *cpu)
 {
     assert(cpu != NULL);
 
-    // Initialize all memory to 0
-    memset(cpu->memory, 0, CH8_MEM_SIZE);
+    // Initialize all memory to 0, padding included so whole-state comparisons are stable
+    memset(cpu, 0, sizeof(*cpu));
 
     // Font data sits at beginning
     memcpy(cpu->memory, font, CH8_FONT_SIZE);
+    memcpy(cpu->memory + CH8_BIG_FONT_OFFSET, bigFont, sizeof(bigFont));
 
-    // Stack sits at offset 0xEA0-0xEFF
-    cpu->stack = (u16 *)(cpu->memory + CH8_CALL_STACK_OFFSET);
-
-    // Display refresh sits at 0xF00-0xFFF
-    cpu->framebuffer = cpu->memory + CH8_DISPLAY_REFRESH_OFFSET;
-
-    cpu->index = 0;
+    cpu->planeMask = 1;
+    memset(cpu->dirty, 0xFF, sizeof(cpu->dirty));
     cpu->programCounter = CH8_PROGRAM_START_OFFSET;
-    cpu->stackPointer = 0;
-
-    cpu->delayTimer = 0;
-    cpu->soundTimer = 0;
 
-    cpu->drawFlag = false;
-    cpu->waitFlag = false;
-    cpu->waitReg = 0;
+    ch8_seedRandom(cpu, CH8_DEFAULT_SEED);
+    ch8_setQuirks(cpu, CH8_QUIRKS_LEGACY);
 
     ch8_logDebug("CHIP-VM (re)-initialized");
 }
@@ -65,8 +186,19 @@ void ch8_loadRomData(ch8_cpu *cpu, const u8 *program, size_t size)
     assert(cpu != NULL);
     assert(size <= CH8_MAX_PROGRAM_SIZE);
 
-    memset(cpu->memory + CH8_PROGRAM_START_OFFSET, 0, CH8_MAX_PROGRAM_SIZE);
+    // Only the tail of a longer previous ROM needs clearing, not the whole program area
+    u32 end = CH8_PROGRAM_START_OFFSET + (u32)ch8_max(size, (size_t)cpu->programSize);
+    memset(cpu->memory + CH8_PROGRAM_START_OFFSET + size, 0, end - CH8_PROGRAM_START_OFFSET - size);
     memcpy(cpu->memory + CH8_PROGRAM_START_OFFSET, program, size);
+    cpu->programSize = (u32)size;
+
+    for (u32 page = CH8_PROGRAM_START_OFFSET >> CH8_PAGE_SHIFT; page < (end + CH8_PAGE_SIZE - 1) >> CH8_PAGE_SHIFT; page++) {
+        cpu->dirty[page >> 6] |= 1ull << (page & 63);
+    }
+
+    if ((cpu->quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        writeVipLayout(cpu);
+    }
 
     ch8_logDebug("%d byte-long ROM binary loaded", size);
 }
@@ -96,11 +228,12 @@ bool ch8_loadRomFile(ch8_cpu *cpu, const char *file)
         return false;
     }
 
-    memset(cpu->memory + CH8_PROGRAM_START_OFFSET, 0, CH8_MAX_PROGRAM_SIZE);
-    fread(cpu->memory + CH8_PROGRAM_START_OFFSET, sizeof(u8), len, f);
-
+    std::vector<u8> program(len);
+    len = fread(program.data(), sizeof(u8), len, f);
     fclose(f);
 
+    ch8_loadRomData(cpu, program.data(), len);
+
     return true;
 }
 
@@ -108,31 +241,30 @@ u16 ch8_nextOpcode(ch8_cpu *cpu)
 {
     assert(cpu != NULL);
 
-    u8 msb = cpu->memory[cpu->programCounter];
-    u8 lsb = cpu->memory[cpu->programCounter + 1];
+    u8 msb = cpu->memory[cpu->programCounter & CH8_ADDR_MASK];
+    u8 lsb = cpu->memory[(cpu->programCounter + 1) & CH8_ADDR_MASK];
     u16 opcode = msb << 8 | lsb;
 
     return opcode;
 }
 
-bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
+// One interpreter per quirk combination; quirk checks fold away at compile time
+template <u32 Quirks>
+static bool execute(ch8_cpu *cpu, u16 pc, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u16 opcode = ch8_nextOpcode(cpu);
-    if (opcode == 0) {
-        return false;
+    u8 drawY = 0;
+    if constexpr ((Quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        drawY = cpu->V[(opcode & 0x00F0) >> 4];
     }
 
-    // Set flags to false before each instruction
-    cpu->drawFlag = false;
-    cpu->waitFlag = false;
-    cpu->waitReg = 0;
-
     switch (opcode & 0xF000)
     {
     // Call a machine code subroutine
     case 0x0000:
+        if ((opcode & 0xFFF0) == 0x00C0) {
+            ch8_op_ScrollDown(cpu, opcode);
+            break;
+        }
         switch (opcode & 0x00FF)
         {
         case 0x00E0:
@@ -141,8 +273,20 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
         case 0x00EE:
             ch8_op_ReturnFromSub(cpu);
             break;
+        case 0x00FB:
+            ch8_op_ScrollRight(cpu);
+            break;
+        case 0x00FC:
+            ch8_op_ScrollLeft(cpu);
+            break;
+        case 0x00FE:
+            ch8_op_LowRes(cpu);
+            break;
+        case 0x00FF:
+            ch8_op_HighRes(cpu);
+            break;
         default:
-            ch8_logDebug("NOOP");
+            // NOOP
             break;
         }
         break;
@@ -162,9 +306,23 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
     case 0x4000:
         ch8_op_SkipNotEquals(cpu, opcode);
         break;
-    // Equality check against two variables
+    // Equality check against two variables, XO-CHIP register ranges
     case 0x5000:
-        ch8_op_SkipVXEqualsVY(cpu, opcode);
+        switch (opcode & 0x000F)
+        {
+        case 0x0000:
+            ch8_op_SkipVXEqualsVY(cpu, opcode);
+            break;
+        case 0x0002:
+            ch8_op_StoreRange(cpu, opcode);
+            break;
+        case 0x0003:
+            ch8_op_LoadRange(cpu, opcode);
+            break;
+        default:
+            ch8_logError("Invalid opcode %X", opcode);
+            break;
+        }
         break;
     // Set constant in register
     case 0x6000:
@@ -184,13 +342,13 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
             ch8_op_Assign(cpu, opcode);
             break;
         case 0x0001:
-            ch8_op_LogicalOr(cpu, opcode);
+            ch8_op_LogicalOr<Quirks>(cpu, opcode);
             break;
         case 0x0002:
-            ch8_op_LogicalAnd(cpu, opcode);
+            ch8_op_LogicalAnd<Quirks>(cpu, opcode);
             break;
         case 0x0003:
-            ch8_op_LogicalXor(cpu, opcode);
+            ch8_op_LogicalXor<Quirks>(cpu, opcode);
             break;
         case 0x0004:
             ch8_op_AddAssign(cpu, opcode);
@@ -199,13 +357,13 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
             ch8_op_SubtractAssign(cpu, opcode);
             break;
         case 0x0006:
-            ch8_op_BitshiftRight(cpu, opcode);
+            ch8_op_BitshiftRight<Quirks>(cpu, opcode);
             break;
         case 0x0007:
             ch8_op_SubtractAssignReverse(cpu, opcode);
             break;
         case 0x000E:
-            ch8_op_BitshiftLeft(cpu, opcode);
+            ch8_op_BitshiftLeft<Quirks>(cpu, opcode);
             break;
         default:
             ch8_logError("Invalid opcode %X", opcode);
@@ -222,13 +380,13 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
         ch8_op_SetIndex(cpu, opcode);
         break;
     case 0xB000:
-        ch8_op_JumpOffset(cpu, opcode);
+        ch8_op_JumpOffset<Quirks>(cpu, opcode);
         break;
     case 0xC000:
         ch8_op_BitwiseRandom(cpu, opcode);
         break;
     case 0xD000:
-        ch8_op_DrawSprite(cpu, opcode);
+        ch8_op_DrawSprite<Quirks>(cpu, opcode);
         break;
     case 0xE000:
     {
@@ -250,6 +408,16 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
     {
         switch (opcode & 0x00FF)
         {
+        case 0x0000:
+            if (opcode != 0xF000) {
+                ch8_logError("Invalid opcode %X", opcode);
+                break;
+            }
+            ch8_op_SetIndexLong(cpu);
+            break;
+        case 0x0001:
+            ch8_op_SelectPlanes(cpu, opcode);
+            break;
         case 0x0007:
             ch8_op_ReadDelayTimer(cpu, opcode);
             break;
@@ -268,14 +436,23 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
         case 0x0029:
             ch8_op_SetFontChar(cpu, opcode);
             break;
+        case 0x0030:
+            ch8_op_SetBigFontChar(cpu, opcode);
+            break;
         case 0x0033:
             ch8_op_StoreBinaryCodedDecimal(cpu, opcode);
             break;
         case 0x0055:
-            ch8_op_Store(cpu, opcode);
+            ch8_op_Store<Quirks>(cpu, opcode);
             break;
         case 0x0065:
-            ch8_op_Load(cpu, opcode);
+            ch8_op_Load<Quirks>(cpu, opcode);
+            break;
+        case 0x0075:
+            ch8_op_StoreFlags(cpu, opcode);
+            break;
+        case 0x0085:
+            ch8_op_LoadFlags(cpu, opcode);
             break;
         default:
             ch8_logError("Invalid opcode %X", opcode);
@@ -288,29 +465,196 @@ bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
         return false;
     }
 
+    if (cpu->fault != CH8_FAULT_NONE) {
+        ch8_logError("%s at %X", ch8_faultName((ch8_fault)cpu->fault), pc);
+        return false;
+    }
+
+    if constexpr ((Quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        mirrorVipLayout(cpu, opcode, drawY);
+    }
+
+    return true;
+}
+
+template <u32... Quirks>
+static constexpr std::array<ch8_executeFn, sizeof...(Quirks)> makeExecutors(std::integer_sequence<u32, Quirks...>)
+{
+    return {{execute<Quirks>...}};
+}
+
+static constexpr auto executors = makeExecutors(std::make_integer_sequence<u32, CH8_QUIRKS_SPECIALIZED + 1>());
+
+static const struct
+{
+    const char *name;
+    u32 quirks;
+} profiles[] = {
+    {"legacy", CH8_QUIRKS_LEGACY},
+    {"cosmac", CH8_QUIRKS_COSMAC},
+    {"schip", CH8_QUIRKS_SCHIP},
+    {"xochip", CH8_QUIRKS_XOCHIP},
+    {"vip", CH8_QUIRKS_VIP},
+};
+
+static const char *faultNames[] = {
+    "No fault",
+    "Stack overflow",
+    "Stack underflow",
+};
+
+void ch8_setQuirks(ch8_cpu *cpu, u32 quirks)
+{
+    assert(cpu != NULL);
+    assert((quirks & ~CH8_QUIRK_ALL) == 0);
+
+    cpu->quirks = quirks;
+    cpu->execute = executors[quirks & CH8_QUIRKS_SPECIALIZED];
+
+    // Instructions only mirror what they change, so start from a full copy
+    if ((quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        writeVipLayout(cpu);
+    }
+}
+
+bool ch8_findQuirkProfile(const char *name, u32 *quirks)
+{
+    assert(name != NULL);
+    assert(quirks != NULL);
+
+    for (const auto &profile : profiles) {
+        if (strcmp(profile.name, name) == 0) {
+            *quirks = profile.quirks;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *ch8_faultName(ch8_fault fault)
+{
+    assert(fault < sizeof(faultNames) / sizeof(faultNames[0]));
+    return faultNames[fault];
+}
+
+void ch8_markClean(ch8_cpu *cpu)
+{
+    assert(cpu != NULL);
+    memset(cpu->dirty, 0, sizeof(cpu->dirty));
+}
+
+void ch8_syncDirty(ch8_cpu *dst, const ch8_cpu *src)
+{
+    assert(dst != NULL);
+    assert(src != NULL);
+
+    for (int w = 0; w < CH8_NUM_PAGES / 64; w++) {
+        u64 pages = dst->dirty[w] | src->dirty[w];
+        while (pages != 0) {
+            int page = w * 64 + ch8_lowestSetBit(pages);
+            memcpy(dst->memory + page * CH8_PAGE_SIZE, src->memory + page * CH8_PAGE_SIZE, CH8_PAGE_SIZE);
+            pages &= pages - 1;
+        }
+    }
+
+    // Everything but guest memory is small enough to copy outright; this brings src's dirty set along
+    const size_t tail = offsetof(ch8_cpu, memory) + CH8_MEM_SIZE;
+    memcpy(dst, src, offsetof(ch8_cpu, memory));
+    memcpy((u8 *)dst + tail, (const u8 *)src + tail, sizeof(ch8_cpu) - tail);
+}
+
+bool ch8_dirtyEqual(const ch8_cpu *a, const ch8_cpu *b)
+{
+    assert(a != NULL);
+    assert(b != NULL);
+
+    if (memcmp(a, b, offsetof(ch8_cpu, memory)) != 0 || memcmp(a->stack, b->stack, sizeof(a->stack)) != 0 ||
+        memcmp(a->flags, b->flags, sizeof(a->flags)) != 0 ||
+        memcmp(a->framebuffer, b->framebuffer, sizeof(a->framebuffer)) != 0) {
+        return false;
+    }
+
+    for (int w = 0; w < CH8_NUM_PAGES / 64; w++) {
+        u64 pages = a->dirty[w] | b->dirty[w];
+        while (pages != 0) {
+            int page = w * 64 + ch8_lowestSetBit(pages);
+            if (memcmp(a->memory + page * CH8_PAGE_SIZE, b->memory + page * CH8_PAGE_SIZE, CH8_PAGE_SIZE) != 0) {
+                return false;
+            }
+            pages &= pages - 1;
+        }
+    }
+
     return true;
 }
 
+bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms)
+{
+    assert(cpu != NULL);
+
+    if (cpu->fault != CH8_FAULT_NONE) {
+        return false;
+    }
+
+    u16 pc = cpu->programCounter;
+    u16 opcode = ch8_nextOpcode(cpu);
+    if (opcode == 0) {
+        return false;
+    }
+
+    // Set flags to false before each instruction
+    cpu->drawFlag = false;
+    cpu->waitFlag = false;
+    cpu->waitReg = 0;
+
+    if (!cpu->execute(cpu, pc, opcode)) {
+        return false;
+    }
+
+    ch8_traceRecordCycle(cpu, pc, opcode);
+    cpu->cycles++;
+
+    return true;
+}
+
+void ch8_seedRandom(ch8_cpu *cpu, u32 seed)
+{
+    assert(cpu != NULL);
+    // xorshift has a fixed point at zero
+    cpu->rngState = seed != 0 ? seed : CH8_DEFAULT_SEED;
+}
+
+u8 ch8_nextRandom(ch8_cpu *cpu)
+{
+    u32 x = cpu->rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cpu->rngState = x;
+    return (u8)(x >> 24);
+}
+
 bool ch8_getPixel(const ch8_cpu *cpu, int x, int y)
 {
-    int index = y * CH8_DISPLAY_WIDTH + x;
-    int byteIndex = index / 8;
-    int offset = index % 8;
-    return cpu->framebuffer[byteIndex] & (0x80 >> offset);
+    return (cpu->framebuffer[0][y][x >> 6] >> (63 - (x & 63))) & 1;
+}
+
+u8 ch8_getPixelColor(const ch8_cpu *cpu, int x, int y)
+{
+    u8 color = 0;
+    for (int plane = 0; plane < CH8_NUM_PLANES; plane++) {
+        color |= ((cpu->framebuffer[plane][y][x >> 6] >> (63 - (x & 63))) & 1) << plane;
+    }
+    return color;
 }
 
 void ch8_setPixel(ch8_cpu *cpu, int x, int y, bool on)
 {
-    int index = y * CH8_DISPLAY_WIDTH + x;
-    int byteIndex = index / 8;
-    int offset = index % 8;
-    u8 byte = cpu->framebuffer[byteIndex];
+    u64 bit = 1ull << (63 - (x & 63));
 
-    if(on) {
-        byte = byte | (0x80 >> offset);
+    if (on) {
+        cpu->framebuffer[0][y][x >> 6] |= bit;
     } else {
-        byte = byte & (~(0x80 >> offset));
+        cpu->framebuffer[0][y][x >> 6] &= ~bit;
     }
-
-    cpu->framebuffer[byteIndex] = byte;
 }
@@ -11,51 +11,151 @@ extern "C"
 {
 #endif
 
-#define CH8_MEM_SIZE 4096
+#define CH8_MEM_SIZE 0x10000 /* XO-CHIP address space; CHIP-8 ROMs use the first 4 KB */
 #define CH8_STACK_SIZE 64
 #define CH8_NUM_REGISTERS 16
-#define CH8_MAX_PROGRAM_SIZE 3232
+#define CH8_MAX_PROGRAM_SIZE (CH8_MEM_SIZE - CH8_PROGRAM_START_OFFSET)
 #define CH8_NUM_KEYS 16
 
 #define CH8_PROGRAM_START_OFFSET 0x200
 #define CH8_CALL_STACK_OFFSET 0xEA0
 #define CH8_DISPLAY_REFRESH_OFFSET 0xF00
 
+/* Guest memory writes are tracked per page so baselines can be restored and compared quickly */
+#define CH8_PAGE_SHIFT 8
+#define CH8_PAGE_SIZE (1 << CH8_PAGE_SHIFT)
+#define CH8_NUM_PAGES (CH8_MEM_SIZE / CH8_PAGE_SIZE)
+
+/* Addresses wrap around the 16-bit address space */
+#define CH8_ADDR_MASK (CH8_MEM_SIZE - 1)
+/* Return addresses the VIP had room for between the stack offset and the display */
+#define CH8_STACK_DEPTH ((CH8_DISPLAY_REFRESH_OFFSET - CH8_CALL_STACK_OFFSET) / 2)
+
 #define CH8_PC_STEP_SIZE 2
 
 #define CH8_DISPLAY_WIDTH 64
 #define CH8_DISPLAY_HEIGHT 32
-#define CH8_DISPLAY_SIZE 256
+#define CH8_DISPLAY_HIRES_WIDTH 128 /* SCHIP high resolution */
+#define CH8_DISPLAY_HIRES_HEIGHT 64
+#define CH8_DISPLAY_ROW_WORDS 2 /* u64 words per 128-pixel row */
+#define CH8_NUM_PLANES 2 /* XO-CHIP bitplanes, blended to four colors */
 
+#define CH8_BIG_FONT_OFFSET 0x50 /* SCHIP 8x10 digits, after the 4x5 font */
+#define CH8_NUM_FLAG_REGISTERS 16 /* FX75/FX85 storage (HP-48 RPL flags) */
+
+/* Behavior that differs between CHIP-8 variants */
+typedef enum ch8_quirk
+{
+    CH8_QUIRK_SHIFT_VX = 1 << 0,    /* 8XY6/8XYE shift VX in place instead of VY */
+    CH8_QUIRK_INCREMENT_I = 1 << 1, /* FX55/FX65 leave I at I + X + 1 */
+    CH8_QUIRK_JUMP_VX = 1 << 2,     /* BXNN jumps to XNN + VX instead of NNN + V0 */
+    CH8_QUIRK_SPRITE_WRAP = 1 << 3, /* DXYN wraps pixels around the edges instead of clipping */
+    CH8_QUIRK_VF_RESET = 1 << 4,    /* 8XY1/8XY2/8XY3 clear VF */
+    CH8_QUIRK_VIP_LAYOUT = 1 << 5,  /* mirror the stack and display at 0xEA0/0xF00 like the VIP */
+    CH8_QUIRK_LORES_TALL = 1 << 6,  /* DXY0 draws an 8x16 sprite in low resolution instead of nothing */
+    CH8_QUIRK_LORES_BIG = 1 << 7,   /* DXY0 draws a 16x16 sprite in low resolution too */
+    CH8_QUIRK_ALL = (1 << 8) - 1
+} ch8_quirk;
+
+/* Quirks the interpreter is specialized on; the rest only matter on rare paths and are tested there */
+#define CH8_QUIRKS_SPECIALIZED ((1 << 6) - 1)
+
+#define CH8_QUIRKS_LEGACY (CH8_QUIRK_JUMP_VX) /* this emulator's historical behavior */
+#define CH8_QUIRKS_COSMAC (CH8_QUIRK_INCREMENT_I | CH8_QUIRK_VF_RESET)
+#define CH8_QUIRKS_SCHIP (CH8_QUIRK_SHIFT_VX | CH8_QUIRK_JUMP_VX | CH8_QUIRK_LORES_TALL)
+#define CH8_QUIRKS_XOCHIP (CH8_QUIRK_INCREMENT_I | CH8_QUIRK_SPRITE_WRAP | CH8_QUIRK_LORES_BIG)
+#define CH8_QUIRKS_VIP (CH8_QUIRKS_COSMAC | CH8_QUIRK_VIP_LAYOUT)
+
+/* Why the VM stopped; execution cannot continue until reset */
+typedef enum ch8_fault
+{
+    CH8_FAULT_NONE,
+    CH8_FAULT_STACK_OVERFLOW,  /* 2NNN with a full stack */
+    CH8_FAULT_STACK_UNDERFLOW, /* 00EE with an empty stack */
+} ch8_fault;
+
+struct ch8_cpu;
+typedef bool (*ch8_executeFn)(struct ch8_cpu *cpu, u16 pc, u16 opcode);
+
+/*
+ * Plain data: a VM can be snapshotted and restored with memcpy. The stack and
+ * framebuffer live outside guest memory unless CH8_QUIRK_VIP_LAYOUT mirrors
+ * them back in.
+ *
+ * Everything an instruction typically touches sits in the first cache line;
+ * guest memory and the display start on lines of their own.
+ */
 typedef struct ch8_cpu
 {
-    u8 memory[CH8_MEM_SIZE];
-    u16 *stack;
-    u8 *framebuffer;
+    CH8_ALIGNED(CH8_CACHE_LINE) ch8_executeFn execute; /* interpreter specialized for `quirks` */
+    u64 cycles; /* instructions executed since reset */
+    u32 quirks;
+    u32 rngState; /* CXNN random source, per VM so runs are reproducible */
 
     u8 V[CH8_NUM_REGISTERS]; /* data registers */
-
     u16 index;
     u16 programCounter;
+    u16 keypad; /* bit k set while key k is held */
     u8 stackPointer;
+    u8 fault; /* ch8_fault */
 
     u8 delayTimer;
     u8 soundTimer;
 
-    bool keypad[CH8_NUM_KEYS];
-
     bool drawFlag;
     bool waitFlag;
     u8 waitReg;
+
+    bool hires;
+    u8 planeMask; /* planes drawn to, cleared and scrolled (FN01) */
+
+    CH8_ALIGNED(CH8_CACHE_LINE) u8 memory[CH8_MEM_SIZE];
+    u16 stack[CH8_STACK_DEPTH];
+    u8 flags[CH8_NUM_FLAG_REGISTERS];
+    u32 programSize; /* bytes of the last ROM loaded, cleared by the next load */
+    u64 dirty[CH8_NUM_PAGES / 64]; /* pages of `memory` written since ch8_markClean */
+    CH8_ALIGNED(CH8_CACHE_LINE) u64 framebuffer[CH8_NUM_PLANES][CH8_DISPLAY_HIRES_HEIGHT][CH8_DISPLAY_ROW_WORDS]; /* see ch8_framebuffer.h */
 } ch8_cpu;
 
+/* Every guest memory write goes through here so its page gets marked dirty */
+static inline void ch8_writeMemory(ch8_cpu *cpu, u16 addr, u8 value)
+{
+    cpu->memory[addr] = value;
+    cpu->dirty[addr >> (CH8_PAGE_SHIFT + 6)] |= 1ull << ((addr >> CH8_PAGE_SHIFT) & 63);
+}
+
 void ch8_reset(ch8_cpu *cpu);
+/* Replaces the previously loaded ROM; the rest of memory is left as it is, so reset first for a fresh VM */
+void ch8_loadRomData(ch8_cpu *cpu, const u8 *program, size_t size);
 bool ch8_loadRomFile(ch8_cpu *cpu, const char *file);
 u16 ch8_nextOpcode(ch8_cpu *cpu);
 bool ch8_clockCycle(ch8_cpu *cpu, float elapsed_ms);
 
+void ch8_setQuirks(ch8_cpu *cpu, u32 quirks);
+bool ch8_findQuirkProfile(const char *name, u32 *quirks);
+
+const char *ch8_faultName(ch8_fault fault);
+
+/*
+ * Dirty pages are the ones that may differ from the state at the last
+ * ch8_markClean. VMs cleaned at the same baseline can then be synced and
+ * compared by touching only those pages. ch8_reset marks everything
+ * dirty, ROM loading the pages it rewrites.
+ */
+void ch8_markClean(ch8_cpu *cpu);
+/* Makes dst a copy of src, both descended from the same clean baseline */
+void ch8_syncDirty(ch8_cpu *dst, const ch8_cpu *src);
+/* Whole-state equality for VMs descended from the same clean baseline */
+bool ch8_dirtyEqual(const ch8_cpu *a, const ch8_cpu *b);
+
+void ch8_seedRandom(ch8_cpu *cpu, u32 seed);
+u8 ch8_nextRandom(ch8_cpu *cpu);
+
+/* Pixel on the first plane */
 bool ch8_getPixel(const ch8_cpu *cpu, int x, int y);
 void ch8_setPixel(ch8_cpu *cpu, int x, int y, bool on);
+/* Color index 0-3: one bit per plane */
+u8 ch8_getPixelColor(const ch8_cpu *cpu, int x, int y);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,233 @@
+#include "ch8_debug.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "ch8_coverage.h"
+#include "ch8_util.h"
+
+void ch8_debugInit(ch8_debugger *dbg)
+{
+    assert(dbg != NULL);
+    memset(dbg, 0, sizeof(ch8_debugger));
+}
+
+bool ch8_debugIsArmed(const ch8_debugger *dbg)
+{
+    return dbg != NULL && (dbg->numBreakpoints > 0 || dbg->numWatchpoints > 0 || dbg->numConditions > 0);
+}
+
+void ch8_debugSetBreakpoint(ch8_debugger *dbg, u16 addr, bool enabled)
+{
+    assert(dbg != NULL);
+
+    u8 bit = 1 << (addr & 7);
+    bool wasSet = (dbg->breakpoints[addr >> 3] & bit) != 0;
+
+    if (enabled && !wasSet) {
+        dbg->breakpoints[addr >> 3] |= bit;
+        dbg->numBreakpoints++;
+    } else if (!enabled && wasSet) {
+        dbg->breakpoints[addr >> 3] &= ~bit;
+        dbg->numBreakpoints--;
+    }
+}
+
+bool ch8_debugHasBreakpoint(const ch8_debugger *dbg, u16 addr)
+{
+    assert(dbg != NULL);
+    return (dbg->breakpoints[addr >> 3] & (1 << (addr & 7))) != 0;
+}
+
+void ch8_debugSetWatchpoint(ch8_debugger *dbg, u16 addr, u16 length, u8 flags)
+{
+    assert(dbg != NULL);
+
+    u32 end = ch8_min((u32)addr + length, (u32)CH8_MEM_SIZE);
+    for (u32 a = addr; a < end; a++) {
+        if (dbg->watchpoints[a] == 0 && flags != 0) {
+            dbg->numWatchpoints++;
+        } else if (dbg->watchpoints[a] != 0 && flags == 0) {
+            dbg->numWatchpoints--;
+        }
+        dbg->watchpoints[a] = flags;
+    }
+}
+
+bool ch8_debugAddRegCondition(ch8_debugger *dbg, u8 reg, ch8_regCompare compare, u8 value)
+{
+    assert(dbg != NULL);
+    assert(reg < CH8_NUM_REGISTERS);
+
+    if (dbg->numConditions >= CH8_MAX_REG_CONDITIONS) {
+        return false;
+    }
+
+    ch8_regCondition *cond = &dbg->conditions[dbg->numConditions++];
+    cond->reg = reg;
+    cond->compare = (u8)compare;
+    cond->value = value;
+
+    return true;
+}
+
+void ch8_debugClearRegConditions(ch8_debugger *dbg)
+{
+    assert(dbg != NULL);
+    dbg->numConditions = 0;
+}
+
+u8 ch8_decodeAccess(const ch8_cpu *cpu, u16 opcode, ch8_access *access)
+{
+    assert(cpu != NULL);
+    assert(access != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+
+    access->address = cpu->index;
+    access->length = 0;
+    access->flags = CH8_ACCESS_NONE;
+
+    switch (opcode & 0xF000)
+    {
+    case 0x5000: {
+        u8 y = (opcode & 0x00F0) >> 4;
+        if ((opcode & 0x000F) == 2 || (opcode & 0x000F) == 3) {
+            access->length = (x > y ? x - y : y - x) + 1;
+            access->flags = (opcode & 0x000F) == 2 ? CH8_ACCESS_WRITE : CH8_ACCESS_READ;
+        }
+        break;
+    }
+    case 0xD000: {
+        // DXY0 reads a 16x16 sprite in high resolution, and in low resolution whatever the quirks
+        // make of it (see ch8_op_DrawSprite); each selected plane reads its own sprite
+        int planes = (cpu->planeMask & 1) + ((cpu->planeMask >> 1) & 1);
+        int bytes = opcode & 0x000F;
+        if (bytes == 0 && (cpu->hires || (cpu->quirks & CH8_QUIRK_LORES_BIG) != 0)) {
+            bytes = 32;
+        } else if (bytes == 0 && (cpu->quirks & CH8_QUIRK_LORES_TALL) != 0) {
+            bytes = 16;
+        }
+        access->length = bytes * planes;
+        access->flags = CH8_ACCESS_READ;
+        break;
+    }
+    case 0xF000:
+        switch (opcode & 0x00FF)
+        {
+        case 0x33:
+            access->length = 3;
+            access->flags = CH8_ACCESS_WRITE;
+            break;
+        case 0x55:
+            access->length = x + 1;
+            access->flags = CH8_ACCESS_WRITE;
+            break;
+        case 0x65:
+            access->length = x + 1;
+            access->flags = CH8_ACCESS_READ;
+            break;
+        }
+        break;
+    }
+
+    if (access->length == 0) {
+        access->flags = CH8_ACCESS_NONE;
+    }
+
+    return access->flags;
+}
+
+static bool checkRegister(const ch8_regCondition *cond, u8 before, u8 after)
+{
+    switch (cond->compare)
+    {
+    case CH8_REG_CHANGED:
+        return before != after;
+    case CH8_REG_EQUALS:
+        return after == cond->value && before != after;
+    case CH8_REG_NOT_EQUALS:
+        return after != cond->value && before != after;
+    }
+    return false;
+}
+
+// Debug == false and Coverage == false compiles to the bare interpreter loop;
+// all instrumentation is discarded at compile time rather than skipped at run time.
+template <bool Debug, bool Coverage>
+static ch8_stopReason run(ch8_cpu *cpu, ch8_debugger *dbg, u32 budget)
+{
+    for (u32 i = 0; i < budget; i++) {
+        if (cpu->waitFlag) {
+            return CH8_STOP_KEY_WAIT;
+        }
+
+        ch8_access access;
+        u8 watched = 0;
+        u8 before[CH8_MAX_REG_CONDITIONS];
+
+        if constexpr (Coverage) {
+            ch8_coverageRecord(dbg->coverage, cpu, ch8_nextOpcode(cpu));
+        }
+
+        if constexpr (Debug) {
+            u16 pc = cpu->programCounter;
+            if (i > 0 && ch8_debugHasBreakpoint(dbg, pc)) {
+                dbg->stopAddress = pc;
+                return CH8_STOP_BREAKPOINT;
+            }
+
+            if (dbg->numWatchpoints > 0 && ch8_decodeAccess(cpu, ch8_nextOpcode(cpu), &access) != 0) {
+                for (u16 n = 0; n < access.length; n++) {
+                    u16 a = (access.address + n) & CH8_ADDR_MASK;
+                    if (dbg->watchpoints[a] & access.flags) {
+                        watched = dbg->watchpoints[a] & access.flags;
+                        dbg->stopAddress = a;
+                        break;
+                    }
+                }
+            }
+
+            for (u8 c = 0; c < dbg->numConditions; c++) {
+                before[c] = cpu->V[dbg->conditions[c].reg];
+            }
+        }
+
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            return CH8_STOP_HALT;
+        }
+
+        if constexpr (Debug) {
+            // Watchpoints report after the access so the effect is visible
+            if (watched & CH8_ACCESS_WRITE) {
+                return CH8_STOP_WATCH_WRITE;
+            }
+            if (watched & CH8_ACCESS_READ) {
+                return CH8_STOP_WATCH_READ;
+            }
+
+            for (u8 c = 0; c < dbg->numConditions; c++) {
+                const ch8_regCondition *cond = &dbg->conditions[c];
+                if (checkRegister(cond, before[c], cpu->V[cond->reg])) {
+                    dbg->stopRegister = cond->reg;
+                    return CH8_STOP_REGISTER;
+                }
+            }
+        }
+    }
+
+    return CH8_STOP_BUDGET;
+}
+
+ch8_stopReason ch8_runUntil(ch8_cpu *cpu, ch8_debugger *dbg, u32 budget)
+{
+    assert(cpu != NULL);
+
+    bool armed = ch8_debugIsArmed(dbg);
+    bool coverage = dbg != NULL && dbg->coverage != NULL;
+
+    if (armed) {
+        return coverage ? run<true, true>(cpu, dbg, budget) : run<true, false>(cpu, dbg, budget);
+    }
+    return coverage ? run<false, true>(cpu, dbg, budget) : run<false, false>(cpu, dbg, budget);
+}
@@ -0,0 +1,105 @@
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+#include <stdbool.h>
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_MAX_REG_CONDITIONS 8
+
+typedef enum ch8_accessFlags
+{
+    CH8_ACCESS_NONE = 0,
+    CH8_ACCESS_READ = 1 << 0,
+    CH8_ACCESS_WRITE = 1 << 1,
+} ch8_accessFlags;
+
+/* Guest memory touched by an instruction's operands (instruction fetch excluded) */
+typedef struct ch8_access
+{
+    u16 address;
+    u16 length;
+    u8 flags;
+} ch8_access;
+
+/*
+ * All conditions are edge-triggered: they only fire on an instruction that
+ * changes the register, so a register already holding the value does not
+ * stop every step.
+ */
+typedef enum ch8_regCompare
+{
+    CH8_REG_CHANGED = 0,
+    CH8_REG_EQUALS,     /* changed to `value` */
+    CH8_REG_NOT_EQUALS, /* changed to anything but `value` */
+} ch8_regCompare;
+
+typedef struct ch8_regCondition
+{
+    u8 reg;
+    u8 compare;
+    u8 value;
+} ch8_regCondition;
+
+typedef enum ch8_stopReason
+{
+    CH8_STOP_BUDGET = 0, /* ran the requested number of cycles */
+    CH8_STOP_BREAKPOINT,
+    CH8_STOP_WATCH_READ,
+    CH8_STOP_WATCH_WRITE,
+    CH8_STOP_REGISTER,
+    CH8_STOP_KEY_WAIT, /* FX0A is waiting for input */
+    CH8_STOP_HALT,     /* ch8_clockCycle refused to execute */
+} ch8_stopReason;
+
+struct ch8_coverage;
+
+typedef struct ch8_debugger
+{
+    u8 breakpoints[CH8_MEM_SIZE / 8]; /* one bit per address */
+    u8 watchpoints[CH8_MEM_SIZE];     /* ch8_accessFlags per byte */
+    ch8_regCondition conditions[CH8_MAX_REG_CONDITIONS];
+
+    u16 numBreakpoints;
+    u16 numWatchpoints;
+    u8 numConditions;
+
+    /* When set, every executed instruction's memory accesses are counted */
+    struct ch8_coverage *coverage;
+
+    /* Filled in when ch8_runUntil stops on a debugger event */
+    u16 stopAddress;
+    u8 stopRegister;
+} ch8_debugger;
+
+void ch8_debugInit(ch8_debugger *dbg);
+bool ch8_debugIsArmed(const ch8_debugger *dbg);
+
+void ch8_debugSetBreakpoint(ch8_debugger *dbg, u16 addr, bool enabled);
+bool ch8_debugHasBreakpoint(const ch8_debugger *dbg, u16 addr);
+
+void ch8_debugSetWatchpoint(ch8_debugger *dbg, u16 addr, u16 length, u8 flags);
+
+bool ch8_debugAddRegCondition(ch8_debugger *dbg, u8 reg, ch8_regCompare compare, u8 value);
+void ch8_debugClearRegConditions(ch8_debugger *dbg);
+
+u8 ch8_decodeAccess(const ch8_cpu *cpu, u16 opcode, ch8_access *access);
+
+/*
+ * Executes up to `budget` cycles. With no debugger (or nothing armed and no
+ * coverage recording) this runs an instantiation of the loop without any
+ * per-cycle debugger checks.
+ * A breakpoint on the first instruction is ignored so a stopped VM can resume.
+ */
+ch8_stopReason ch8_runUntil(ch8_cpu *cpu, ch8_debugger *dbg, u32 budget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
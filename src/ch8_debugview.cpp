@@ -0,0 +1,368 @@
+#include "ch8_debugview.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <imgui.h>
+
+#include "ch8_coverage.h"
+#include "ch8_disasm.h"
+#include "ch8_util.h"
+
+#define DISASM_START CH8_PROGRAM_START_OFFSET
+#define DISASM_LINES ((CH8_MEM_SIZE - DISASM_START) / 2)
+
+// Lines are only re-decoded when the bytes they came from change
+#define BLOCK_SIZE 64
+
+// Each cell sums the counters of HEATMAP_BYTES consecutive addresses
+#define HEATMAP_SIZE 64
+#define HEATMAP_CELL 4.0f
+#define HEATMAP_BYTES (CH8_MEM_SIZE / (HEATMAP_SIZE * HEATMAP_SIZE))
+#define COVERAGE_FILE "coverage.ppm"
+
+typedef struct disasmLine
+{
+    u16 opcode;
+    char text[CH8_DISASM_MAX_LEN];
+} disasmLine;
+
+struct ch8_debugView
+{
+    disasmLine lines[DISASM_LINES];
+    u8 decoded[CH8_MEM_SIZE];
+    bool cacheValid;
+
+    bool visible;
+    bool paused;
+    bool stepRequested;
+    bool followPc;
+    u16 lastPc;
+    ch8_stopReason lastStop;
+
+    bool heatmapVisible;
+    bool recording;
+    ch8_coverage coverage;
+
+    // Heatmap cells, summed from the coverage counters every frame
+    u32 writes[HEATMAP_SIZE * HEATMAP_SIZE];
+    u32 execs[HEATMAP_SIZE * HEATMAP_SIZE];
+    u32 reads[HEATMAP_SIZE * HEATMAP_SIZE];
+};
+
+static const char *stopNames[] = {
+    "running",
+    "breakpoint",
+    "read watchpoint",
+    "write watchpoint",
+    "register condition",
+    "waiting for key",
+    "halted",
+};
+
+static void decodeRange(ch8_debugView *view, const u8 *memory, u32 start, u32 end)
+{
+    for (u32 addr = start; addr < end; addr += 2) {
+        disasmLine *line = &view->lines[(addr - DISASM_START) / 2];
+        line->opcode = memory[addr] << 8 | memory[addr + 1];
+        ch8_disassemble(line->opcode, line->text, sizeof(line->text));
+    }
+}
+
+static void updateCache(ch8_debugView *view, const ch8_cpu *cpu)
+{
+    if (!view->cacheValid) {
+        decodeRange(view, cpu->memory, DISASM_START, CH8_MEM_SIZE);
+        memcpy(view->decoded, cpu->memory, CH8_MEM_SIZE);
+        view->cacheValid = true;
+        return;
+    }
+
+    // Guest code only changes through FX33/FX55 stores, so this is almost always a no-op
+    for (u32 block = DISASM_START; block < CH8_MEM_SIZE; block += BLOCK_SIZE) {
+        if (memcmp(view->decoded + block, cpu->memory + block, BLOCK_SIZE) != 0) {
+            decodeRange(view, cpu->memory, block, block + BLOCK_SIZE);
+            memcpy(view->decoded + block, cpu->memory + block, BLOCK_SIZE);
+        }
+    }
+}
+
+static void drawControls(ch8_debugView *view, const ch8_cpu *cpu)
+{
+    if (ImGui::Button(view->paused ? "Run" : "Pause")) {
+        view->paused = !view->paused;
+        view->lastStop = CH8_STOP_BUDGET;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Step")) {
+        view->paused = true;
+        view->stepRequested = true;
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Follow PC", &view->followPc);
+
+    ImGui::Text("%s, cycle %llu", view->paused ? "Paused" : "Running", (unsigned long long)cpu->cycles);
+    if (view->lastStop != CH8_STOP_BUDGET) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "(%s)", stopNames[view->lastStop]);
+    }
+    if (cpu->fault != CH8_FAULT_NONE) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", ch8_faultName((ch8_fault)cpu->fault));
+    }
+}
+
+static void drawRegisters(const ch8_cpu *cpu)
+{
+    if (ImGui::BeginTable("registers", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        for (int i = 0; i < CH8_NUM_REGISTERS; i++) {
+            ImGui::TableNextColumn();
+            ImGui::Text("V%X %02X", i, cpu->V[i]);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("I  %04X  PC %04X  SP %02X", cpu->index, cpu->programCounter, cpu->stackPointer);
+    ImGui::Text("DT %02X    ST %02X", cpu->delayTimer, cpu->soundTimer);
+}
+
+static void drawCallStack(const ch8_cpu *cpu)
+{
+    if (cpu->stackPointer == 0) {
+        ImGui::TextDisabled("(empty)");
+        return;
+    }
+
+    for (int i = cpu->stackPointer - 1; i >= 0; i--) {
+        ImGui::Text("#%-2d %04X", cpu->stackPointer - 1 - i, cpu->stack[i]);
+    }
+}
+
+static void drawDisassembly(ch8_debugView *view, const ch8_cpu *cpu, ch8_debugger *dbg)
+{
+    if (!ImGui::BeginChild("disassembly", ImVec2(0.0f, 0.0f), true)) {
+        ImGui::EndChild();
+        return;
+    }
+
+    float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    u16 pc = cpu->programCounter;
+
+    if (view->followPc && pc != view->lastPc && pc >= DISASM_START) {
+        ImGui::SetScrollY((f32)((pc - DISASM_START) / 2) * lineHeight - ImGui::GetContentRegionAvail().y * 0.5f);
+    }
+    view->lastPc = pc;
+
+    // Only the visible rows are formatted and submitted
+    ImGuiListClipper clipper;
+    clipper.Begin(DISASM_LINES, lineHeight);
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            u16 addr = (u16)(DISASM_START + i * 2);
+            const disasmLine *line = &view->lines[i];
+            bool breakpoint = ch8_debugHasBreakpoint(dbg, addr);
+
+            char label[64];
+            snprintf(label, sizeof(label), "%c %04X  %04X  %s##%d", breakpoint ? '*' : ' ', addr, line->opcode, line->text, i);
+
+            if (ImGui::Selectable(label, addr == pc)) {
+                ch8_debugSetBreakpoint(dbg, addr, !breakpoint);
+            }
+        }
+    }
+    clipper.End();
+
+    ImGui::EndChild();
+}
+
+static u32 cellCount(const u32 *counters, u32 cell)
+{
+    u32 sum = 0;
+    for (u32 a = cell * HEATMAP_BYTES; a < (cell + 1) * HEATMAP_BYTES; a++) {
+        sum += counters[a];
+    }
+    return sum;
+}
+
+static void sumCells(const u32 *counters, u32 *cells, u32 *max)
+{
+    *max = 0;
+    for (u32 c = 0; c < HEATMAP_SIZE * HEATMAP_SIZE; c++) {
+        cells[c] = cellCount(counters, c);
+        *max = ch8_max(*max, cells[c]);
+    }
+}
+
+// Log scale so a hot loop doesn't wash out everything touched only a few times
+static u8 intensity(u32 count, f32 scale)
+{
+    if (count == 0) {
+        return 0;
+    }
+    return (u8)(64.0f + 191.0f * log2f(1.0f + (f32)count) * scale);
+}
+
+static void drawHeatmap(ch8_debugView *view, ch8_debugger *dbg)
+{
+    ImGui::SetNextWindowSize(ImVec2(300.0f, 400.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Memory heatmap", &view->heatmapVisible)) {
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Checkbox("Record", &view->recording)) {
+        dbg->coverage = view->recording ? &view->coverage : NULL;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        ch8_coverageReset(&view->coverage);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export")) {
+        ch8_coverageExport(&view->coverage, COVERAGE_FILE);
+    }
+
+    ch8_coverageSummary summary;
+    ch8_coverageSummarize(&view->coverage, &summary);
+    ImGui::Text("code %u  data %u  mixed %u bytes", summary.codeBytes, summary.dataBytes, summary.mixedBytes);
+    ImGui::TextDisabled("red = write, green = execute, blue = read");
+
+    u32 *writes = view->writes;
+    u32 *execs = view->execs;
+    u32 *reads = view->reads;
+    u32 maxWrites, maxExecs, maxReads;
+    sumCells(view->coverage.writes, writes, &maxWrites);
+    sumCells(view->coverage.execs, execs, &maxExecs);
+    sumCells(view->coverage.reads, reads, &maxReads);
+
+    f32 writeScale = 1.0f / log2f(2.0f + (f32)maxWrites);
+    f32 execScale = 1.0f / log2f(2.0f + (f32)maxExecs);
+    f32 readScale = 1.0f / log2f(2.0f + (f32)maxReads);
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+
+    for (u32 c = 0; c < HEATMAP_SIZE * HEATMAP_SIZE; c++) {
+        f32 x = origin.x + (f32)(c % HEATMAP_SIZE) * HEATMAP_CELL;
+        f32 y = origin.y + (f32)(c / HEATMAP_SIZE) * HEATMAP_CELL;
+        ImU32 color = IM_COL32(intensity(writes[c], writeScale),
+                               intensity(execs[c], execScale),
+                               intensity(reads[c], readScale), 255);
+        drawList->AddRectFilled(ImVec2(x, y), ImVec2(x + HEATMAP_CELL, y + HEATMAP_CELL), color);
+    }
+
+    ImGui::Dummy(ImVec2(HEATMAP_SIZE * HEATMAP_CELL, HEATMAP_SIZE * HEATMAP_CELL));
+    if (ImGui::IsItemHovered()) {
+        ImVec2 mouse = ImGui::GetMousePos();
+        int col = (int)((mouse.x - origin.x) / HEATMAP_CELL);
+        int row = (int)((mouse.y - origin.y) / HEATMAP_CELL);
+        if (col >= 0 && col < HEATMAP_SIZE && row >= 0 && row < HEATMAP_SIZE) {
+            u32 c = row * HEATMAP_SIZE + col;
+            ImGui::SetTooltip("%04X-%04X  r %u  w %u  x %u", c * HEATMAP_BYTES, (c + 1) * HEATMAP_BYTES - 1, reads[c],
+                              writes[c], execs[c]);
+        }
+    }
+
+    ImGui::End();
+}
+
+ch8_debugView *ch8_debugViewCreate()
+{
+    ch8_debugView *view = (ch8_debugView *)ch8_malloc(sizeof(ch8_debugView));
+    if (view == NULL) {
+        return NULL;
+    }
+    view->followPc = true;
+    view->lastPc = 0xFFFF;
+    view->lastStop = CH8_STOP_BUDGET;
+
+    return view;
+}
+
+void ch8_debugViewDestroy(ch8_debugView **view)
+{
+    assert(view != NULL);
+    ch8_free((void **)view);
+}
+
+void ch8_debugViewToggle(ch8_debugView *view)
+{
+    assert(view != NULL);
+    view->visible = !view->visible;
+}
+
+void ch8_debugViewToggleHeatmap(ch8_debugView *view)
+{
+    assert(view != NULL);
+    view->heatmapVisible = !view->heatmapVisible;
+}
+
+void ch8_debugViewDraw(ch8_debugView *view, const ch8_cpu *cpu, ch8_debugger *dbg)
+{
+    assert(view != NULL);
+    assert(cpu != NULL);
+    assert(dbg != NULL);
+
+    if (view->heatmapVisible) {
+        drawHeatmap(view, dbg);
+    }
+
+    if (!view->visible) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(360.0f, 480.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Debugger", &view->visible)) {
+        ImGui::End();
+        return;
+    }
+
+    updateCache(view, cpu);
+
+    drawControls(view, cpu);
+    ImGui::Separator();
+    drawRegisters(cpu);
+
+    if (ImGui::CollapsingHeader("Call stack")) {
+        drawCallStack(cpu);
+    }
+
+    ImGui::Separator();
+    ImGui::TextDisabled("Click a line to toggle a breakpoint");
+    drawDisassembly(view, cpu, dbg);
+
+    ImGui::End();
+}
+
+u32 ch8_debugViewCycleBudget(ch8_debugView *view, u32 cyclesPerFrame)
+{
+    assert(view != NULL);
+
+    if (!view->paused) {
+        return cyclesPerFrame;
+    }
+    if (view->stepRequested) {
+        view->stepRequested = false;
+        return 1;
+    }
+    return 0;
+}
+
+void ch8_debugViewOnStop(ch8_debugView *view, ch8_stopReason reason)
+{
+    assert(view != NULL);
+
+    switch (reason)
+    {
+    case CH8_STOP_BREAKPOINT:
+    case CH8_STOP_WATCH_READ:
+    case CH8_STOP_WATCH_WRITE:
+    case CH8_STOP_REGISTER:
+        view->paused = true;
+        view->lastStop = reason;
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef __DEBUGVIEW_H__
+#define __DEBUGVIEW_H__
+
+#include <stdbool.h>
+
+#include "ch8_cpu.h"
+#include "ch8_debug.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Debugger panel and heatmap state: run controls, disassembly cache and coverage */
+typedef struct ch8_debugView ch8_debugView;
+
+/* Returns NULL on failure */
+ch8_debugView *ch8_debugViewCreate();
+void ch8_debugViewDestroy(ch8_debugView **view);
+
+void ch8_debugViewToggle(ch8_debugView *view);
+void ch8_debugViewToggleHeatmap(ch8_debugView *view);
+void ch8_debugViewDraw(ch8_debugView *view, const ch8_cpu *cpu, ch8_debugger *dbg);
+
+/* Number of cycles the emulator may run this frame given the panel's run controls */
+u32 ch8_debugViewCycleBudget(ch8_debugView *view, u32 cyclesPerFrame);
+void ch8_debugViewOnStop(ch8_debugView *view, ch8_stopReason reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,14 @@ typedef uint64_t u64;
 typedef float f32;
 typedef double f64;
 
+#define CH8_CACHE_LINE 64
+
+#ifdef __cplusplus
+#define CH8_ALIGNED(n) alignas(n)
+#else
+#define CH8_ALIGNED(n) _Alignas(n)
+#endif
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -0,0 +1,146 @@
+#include "ch8_disasm.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+int ch8_disassemble(u16 opcode, char *buf, size_t size)
+{
+    assert(buf != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+    u8 n = opcode & 0x000F;
+    u8 kk = opcode & 0x00FF;
+    u16 nnn = opcode & 0x0FFF;
+
+    switch (opcode & 0xF000)
+    {
+    case 0x0000:
+        if ((opcode & 0xFFF0) == 0x00C0) {
+            return snprintf(buf, size, "SCD  %d", n);
+        }
+        switch (opcode)
+        {
+        case 0x00E0:
+            return snprintf(buf, size, "CLS");
+        case 0x00EE:
+            return snprintf(buf, size, "RET");
+        case 0x00FB:
+            return snprintf(buf, size, "SCR");
+        case 0x00FC:
+            return snprintf(buf, size, "SCL");
+        case 0x00FE:
+            return snprintf(buf, size, "LOW");
+        case 0x00FF:
+            return snprintf(buf, size, "HIGH");
+        default:
+            return snprintf(buf, size, "SYS  0x%03X", nnn);
+        }
+    case 0x1000:
+        return snprintf(buf, size, "JP   0x%03X", nnn);
+    case 0x2000:
+        return snprintf(buf, size, "CALL 0x%03X", nnn);
+    case 0x3000:
+        return snprintf(buf, size, "SE   V%X, 0x%02X", x, kk);
+    case 0x4000:
+        return snprintf(buf, size, "SNE  V%X, 0x%02X", x, kk);
+    case 0x5000:
+        if (n == 0) {
+            return snprintf(buf, size, "SE   V%X, V%X", x, y);
+        }
+        if (n == 2) {
+            return snprintf(buf, size, "SAVE V%X - V%X", x, y);
+        }
+        if (n == 3) {
+            return snprintf(buf, size, "LOAD V%X - V%X", x, y);
+        }
+        break;
+    case 0x6000:
+        return snprintf(buf, size, "LD   V%X, 0x%02X", x, kk);
+    case 0x7000:
+        return snprintf(buf, size, "ADD  V%X, 0x%02X", x, kk);
+    case 0x8000:
+        switch (n)
+        {
+        case 0x0:
+            return snprintf(buf, size, "LD   V%X, V%X", x, y);
+        case 0x1:
+            return snprintf(buf, size, "OR   V%X, V%X", x, y);
+        case 0x2:
+            return snprintf(buf, size, "AND  V%X, V%X", x, y);
+        case 0x3:
+            return snprintf(buf, size, "XOR  V%X, V%X", x, y);
+        case 0x4:
+            return snprintf(buf, size, "ADD  V%X, V%X", x, y);
+        case 0x5:
+            return snprintf(buf, size, "SUB  V%X, V%X", x, y);
+        case 0x6:
+            return snprintf(buf, size, "SHR  V%X, V%X", x, y);
+        case 0x7:
+            return snprintf(buf, size, "SUBN V%X, V%X", x, y);
+        case 0xE:
+            return snprintf(buf, size, "SHL  V%X, V%X", x, y);
+        }
+        break;
+    case 0x9000:
+        if (n == 0) {
+            return snprintf(buf, size, "SNE  V%X, V%X", x, y);
+        }
+        break;
+    case 0xA000:
+        return snprintf(buf, size, "LD   I, 0x%03X", nnn);
+    case 0xB000:
+        return snprintf(buf, size, "JP   V%X, 0x%03X", x, nnn);
+    case 0xC000:
+        return snprintf(buf, size, "RND  V%X, 0x%02X", x, kk);
+    case 0xD000:
+        return snprintf(buf, size, "DRW  V%X, V%X, %d", x, y, n);
+    case 0xE000:
+        switch (kk)
+        {
+        case 0x9E:
+            return snprintf(buf, size, "SKP  V%X", x);
+        case 0xA1:
+            return snprintf(buf, size, "SKNP V%X", x);
+        }
+        break;
+    case 0xF000:
+        switch (kk)
+        {
+        case 0x00:
+            if (x == 0) {
+                return snprintf(buf, size, "LD   I, long");
+            }
+            break;
+        case 0x01:
+            return snprintf(buf, size, "PLANE %d", x);
+        case 0x07:
+            return snprintf(buf, size, "LD   V%X, DT", x);
+        case 0x0A:
+            return snprintf(buf, size, "LD   V%X, K", x);
+        case 0x15:
+            return snprintf(buf, size, "LD   DT, V%X", x);
+        case 0x18:
+            return snprintf(buf, size, "LD   ST, V%X", x);
+        case 0x1E:
+            return snprintf(buf, size, "ADD  I, V%X", x);
+        case 0x29:
+            return snprintf(buf, size, "LD   F, V%X", x);
+        case 0x30:
+            return snprintf(buf, size, "LD   HF, V%X", x);
+        case 0x33:
+            return snprintf(buf, size, "LD   B, V%X", x);
+        case 0x55:
+            return snprintf(buf, size, "LD   [I], V%X", x);
+        case 0x65:
+            return snprintf(buf, size, "LD   V%X, [I]", x);
+        case 0x75:
+            return snprintf(buf, size, "LD   R, V%X", x);
+        case 0x85:
+            return snprintf(buf, size, "LD   V%X, R", x);
+        }
+        break;
+    }
+
+    return snprintf(buf, size, "DW   0x%04X", opcode);
+}
@@ -0,0 +1,22 @@
+#ifndef __DISASM_H__
+#define __DISASM_H__
+
+#include <stddef.h>
+
+#include "ch8_def.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_DISASM_MAX_LEN 32
+
+/* Writes a mnemonic for `opcode` into `buf`, returns the number of characters written */
+int ch8_disassemble(u16 opcode, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
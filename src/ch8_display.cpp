@@ -1,6 +1,7 @@
 #include "ch8_display.h"
 
 #include <assert.h>
+#include <string.h>
 #include <SDL.h>
 
 #include <imgui.h>
@@ -8,139 +9,321 @@
 #include <imgui_impl_sdlrenderer2.h>
 
 #include "ch8_cpu.h"
+#include "ch8_framebuffer.h"
 #include "ch8_log.h"
+#include "ch8_util.h"
 
-static SDL_Renderer *renderer = nullptr;
-static SDL_Texture *display = nullptr;
-static SDL_PixelFormat *pixelFormat = nullptr;
-static ImGuiContext *imgui = nullptr;
-
-static bool initialized = false;
-
-#define INIT_CHECK() if (!initialized) return
-
-int ch8_displayInit(void* handle)
+struct ch8_display
+{
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+    SDL_PixelFormat *pixelFormat;
+    ImGuiContext *imgui;
+    bool imguiPlatform;
+    bool imguiRenderer;
+
+    // Region of the texture holding the current resolution
+    SDL_Rect source;
+    u32 colors[4];
+
+    // Grid mode: every VM gets a 128x64 cell of one atlas, staged in memory and
+    // uploaded once per frame covering only the cells redrawn since the last one
+    SDL_Texture *atlas;
+    u32 *atlasPixels;
+    int gridCount;
+    int gridColumns;
+    int gridRows;
+    SDL_Rect atlasDirty;
+};
+
+ch8_display *ch8_displayCreate(void* handle)
 {
-    if (initialized) {
-        ch8_logInfo("Display sub-system already initialized\n");
-        return 1; // designate some kind of error code
+    ch8_display *display = (ch8_display *)ch8_malloc(sizeof(ch8_display));
+    if (display == NULL) {
+        return NULL;
     }
+    display->source = {0, 0, CH8_DISPLAY_WIDTH, CH8_DISPLAY_HEIGHT};
 
-    renderer = SDL_CreateRenderer((SDL_Window*)handle, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == NULL)
+    display->renderer = SDL_CreateRenderer((SDL_Window*)handle, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (display->renderer == NULL)
     {
         ch8_logError("Failed to create renderer: %s\n", SDL_GetError());
-        return 1;
+        ch8_displayDestroy(&display);
+        return NULL;
     }
 
-    display = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, CH8_DISPLAY_WIDTH, CH8_DISPLAY_HEIGHT);
-    if (display == NULL)
+    // Sized for high resolution once; low resolution uses the top-left corner
+    display->texture = SDL_CreateTexture(display->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING,
+                                         CH8_DISPLAY_HIRES_WIDTH, CH8_DISPLAY_HIRES_HEIGHT);
+    if (display->texture == NULL)
     {
         ch8_logError("Failed to create render target: %s\n", SDL_GetError());
-        return 1;
+        ch8_displayDestroy(&display);
+        return NULL;
     }
 
-    pixelFormat = SDL_AllocFormat(SDL_PIXELFORMAT_RGB888);
-    if (pixelFormat == NULL) {
+    display->pixelFormat = SDL_AllocFormat(SDL_PIXELFORMAT_RGB888);
+    if (display->pixelFormat == NULL) {
         ch8_logError("Failed to allocate pixel format: %s", SDL_GetError());
-        return 1;
+        ch8_displayDestroy(&display);
+        return NULL;
+    }
+    for (int i = 0; i < 4; i++) {
+        display->colors[i] = SDL_MapRGB(display->pixelFormat, ch8_palette[i][0], ch8_palette[i][1], ch8_palette[i][2]);
     }
 
-    // Initialize ImGui
+    // Initialize ImGui, with a context of its own so every display keeps separate UI state
     IMGUI_CHECKVERSION();
-    imgui = ImGui::CreateContext();
+    display->imgui = ImGui::CreateContext();
+    ImGui::SetCurrentContext(display->imgui);
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
 
-    if (!ImGui_ImplSDL2_InitForSDLRenderer(static_cast<SDL_Window*>(handle), renderer)) {
+    display->imguiPlatform = ImGui_ImplSDL2_InitForSDLRenderer(static_cast<SDL_Window*>(handle), display->renderer);
+    if (!display->imguiPlatform) {
         ch8_logError("Failed to initialize ImGui SDL2 window backend.");
-        return 1;
+        ch8_displayDestroy(&display);
+        return NULL;
     }
-    if (!ImGui_ImplSDLRenderer2_Init(renderer)) {
+    display->imguiRenderer = ImGui_ImplSDLRenderer2_Init(display->renderer);
+    if (!display->imguiRenderer) {
         ch8_logError("Failed to initialize ImGui SDL2 renderer backend.");
-        return 1;
+        ch8_displayDestroy(&display);
+        return NULL;
     }
 
-    initialized = true;
-
-    return 0;
+    return display;
 }
 
-void ch8_displayQuit()
+void ch8_displayDestroy(ch8_display **display)
 {
-    INIT_CHECK();
+    assert(display != NULL);
+
+    ch8_display *d = *display;
+    if (d == NULL) {
+        return;
+    }
 
     // ImGui cleanup
-    ImGui_ImplSDLRenderer2_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
-    ImGui::DestroyContext();
-    imgui = nullptr;
-    ch8_logDebug("ImGui resources freed");
+    if (d->imgui != nullptr) {
+        ImGui::SetCurrentContext(d->imgui);
+        if (d->imguiRenderer) {
+            ImGui_ImplSDLRenderer2_Shutdown();
+        }
+        if (d->imguiPlatform) {
+            ImGui_ImplSDL2_Shutdown();
+        }
+        ImGui::DestroyContext(d->imgui);
+        ch8_logDebug("ImGui resources freed");
+    }
 
     // Cleanup display buffer resources
-    SDL_FreeFormat(pixelFormat);
-    pixelFormat = NULL;
-    ch8_logDebug("Pixel format freed");
+    if (d->atlas != NULL) {
+        SDL_DestroyTexture(d->atlas);
+    }
+    free(d->atlasPixels);
+
+    if (d->pixelFormat != NULL) {
+        SDL_FreeFormat(d->pixelFormat);
+        ch8_logDebug("Pixel format freed");
+    }
 
-    SDL_DestroyTexture(display);
-    display = NULL;
-    ch8_logDebug("Render target destroyed\n");
+    if (d->texture != NULL) {
+        SDL_DestroyTexture(d->texture);
+        ch8_logDebug("Render target destroyed\n");
+    }
 
-    SDL_DestroyRenderer(renderer);
-    renderer = NULL;
-    ch8_logDebug("Renderer destroyed\n");
+    if (d->renderer != NULL) {
+        SDL_DestroyRenderer(d->renderer);
+        ch8_logDebug("Renderer destroyed\n");
+    }
 
-    initialized = false;
+    ch8_free((void **)display);
 }
 
-void ch8_displayBeginFrame()
+bool ch8_displayProcessEvent(ch8_display *display, const void *event)
 {
-    INIT_CHECK();
+    assert(display != NULL);
+
+    ImGui::SetCurrentContext(display->imgui);
+    return ImGui_ImplSDL2_ProcessEvent(static_cast<const SDL_Event*>(event));
+}
+
+void ch8_displayBeginFrame(ch8_display *display)
+{
+    assert(display != NULL);
 
     // Clear display
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(display->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+    SDL_RenderClear(display->renderer);
 
-    // Start the Dear ImGui frame
+    // Start the Dear ImGui frame; UI code runs against this display's context until EndFrame
+    ImGui::SetCurrentContext(display->imgui);
     ImGui_ImplSDLRenderer2_NewFrame();
     ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
 }
 
-void ch8_displayEndFrame()
+static void uploadAtlas(ch8_display *display)
+{
+    SDL_Rect &dirty = display->atlasDirty;
+    if (dirty.w == 0) {
+        return;
+    }
+
+    int width = display->gridColumns * CH8_DISPLAY_HIRES_WIDTH;
+    SDL_UpdateTexture(display->atlas, &dirty, display->atlasPixels + dirty.y * width + dirty.x, width * sizeof(u32));
+    dirty = {0, 0, 0, 0};
+}
+
+static void drawGrid(ch8_display *display)
+{
+    uploadAtlas(display);
+    SDL_RenderCopy(display->renderer, display->atlas, NULL, NULL);
+
+    int w, h;
+    SDL_GetRendererOutputSize(display->renderer, &w, &h);
+
+    SDL_SetRenderDrawColor(display->renderer, 0x30, 0x30, 0x30, SDL_ALPHA_OPAQUE);
+    for (int c = 1; c < display->gridColumns; c++) {
+        int x = c * w / display->gridColumns;
+        SDL_RenderDrawLine(display->renderer, x, 0, x, h);
+    }
+    for (int r = 1; r < display->gridRows; r++) {
+        int y = r * h / display->gridRows;
+        SDL_RenderDrawLine(display->renderer, 0, y, w, y);
+    }
+}
+
+void ch8_displayEndFrame(ch8_display *display)
 {
-    INIT_CHECK();
+    assert(display != NULL);
 
     // Render display buffer
-    SDL_RenderCopy(renderer, display, NULL, NULL);
+    if (display->gridCount > 0) {
+        drawGrid(display);
+    } else {
+        SDL_RenderCopy(display->renderer, display->texture, &display->source, NULL);
+    }
 
     // Render UI
     ImGui::Render();
     ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
+}
+
+void ch8_displayPresent(ch8_display *display)
+{
+    assert(display != NULL);
 
     // Boom goes the dynamite
-    SDL_RenderPresent(renderer);
+    SDL_RenderPresent(display->renderer);
+}
+
+// Expands the VM's planes into pixels, each one repeated `scale` times in both directions
+static void expand(const ch8_cpu *cpu, const u32 colors[4], int scale, u32 *pixels, int pitch)
+{
+    int width = ch8_fbWidth(cpu);
+    int height = ch8_fbHeight(cpu);
+
+    for (int y = 0; y < height; y++) {
+        u32 *p = pixels + pitch * y * scale;
+        for (int word = 0; word < width / 64; word++) {
+            u64 first = cpu->framebuffer[0][y][word];
+            u64 second = cpu->framebuffer[1][y][word];
+            for (int bit = 63; bit >= 0; bit--) {
+                u32 color = colors[((first >> bit) & 1) | ((second >> bit) & 1) << 1];
+                for (int i = 0; i < scale; i++) {
+                    *p++ = color;
+                }
+            }
+        }
+        for (int i = 1; i < scale; i++) {
+            memcpy(pixels + pitch * (y * scale + i), pixels + pitch * y * scale, width * scale * sizeof(u32));
+        }
+    }
 }
 
-void ch8_displayWriteFb(const ch8_cpu* cpu)
+void ch8_displayWriteFb(ch8_display *display, const ch8_cpu* cpu)
 {
-    INIT_CHECK();
+    assert(display != NULL);
     assert(cpu != NULL);
 
     u8* pixels = NULL;
-    int x, y, pitch;
+    int pitch;
 
-    SDL_LockTexture(display, NULL, (void**)&pixels, &pitch);
+    SDL_Rect &source = display->source;
+    source.w = ch8_fbWidth(cpu);
+    source.h = ch8_fbHeight(cpu);
 
-    for (y = 0; y < CH8_DISPLAY_HEIGHT; y++) {
-        u32* p = (u32*)(pixels + pitch * y);
-        for (x = 0; x < CH8_DISPLAY_WIDTH; x++) {
-            u8 color = ch8_getPixel(cpu, x, y) > 0 ? 255 : 0;
-            *p = SDL_MapRGB(pixelFormat, color, color, color);
-            p++;
+    SDL_LockTexture(display->texture, &source, (void**)&pixels, &pitch);
+    expand(cpu, display->colors, 1, (u32*)pixels, pitch / (int)sizeof(u32));
+    SDL_UnlockTexture(display->texture);
+}
+
+bool ch8_displaySetGrid(ch8_display *display, int count)
+{
+    assert(display != NULL);
+    assert(count > 0);
+
+    int columns = 1;
+    while (columns * columns < count) {
+        columns++;
+    }
+    int rows = (count + columns - 1) / columns;
+    int width = columns * CH8_DISPLAY_HIRES_WIDTH;
+    int height = rows * CH8_DISPLAY_HIRES_HEIGHT;
+
+    SDL_Texture *atlas = SDL_CreateTexture(display->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING,
+                                           width, height);
+    u32 *pixels = (u32*)ch8_malloc((size_t)width * height * sizeof(u32));
+    if (atlas == NULL || pixels == NULL) {
+        ch8_logError("Failed to create a %dx%d grid atlas: %s", columns, rows, SDL_GetError());
+        if (atlas != NULL) {
+            SDL_DestroyTexture(atlas);
         }
+        free(pixels);
+        return false;
+    }
+
+    if (display->atlas != NULL) {
+        SDL_DestroyTexture(display->atlas);
     }
+    free(display->atlasPixels);
 
-    SDL_UnlockTexture(display);
+    display->atlas = atlas;
+    display->atlasPixels = pixels;
+    display->gridCount = count;
+    display->gridColumns = columns;
+    display->gridRows = rows;
+
+    // Start from a fully black atlas
+    display->atlasDirty = {0, 0, width, height};
+
+    return true;
+}
+
+void ch8_displayWriteGridCell(ch8_display *display, int cell, const ch8_cpu *cpu)
+{
+    assert(display != NULL);
+    assert(cpu != NULL);
+    assert(cell >= 0 && cell < display->gridCount);
+
+    SDL_Rect rect = {
+        (cell % display->gridColumns) * CH8_DISPLAY_HIRES_WIDTH,
+        (cell / display->gridColumns) * CH8_DISPLAY_HIRES_HEIGHT,
+        CH8_DISPLAY_HIRES_WIDTH,
+        CH8_DISPLAY_HIRES_HEIGHT,
+    };
+
+    // Low resolution VMs are doubled so every cell is filled
+    int pitch = display->gridColumns * CH8_DISPLAY_HIRES_WIDTH;
+    int scale = CH8_DISPLAY_HIRES_WIDTH / ch8_fbWidth(cpu);
+    expand(cpu, display->colors, scale, display->atlasPixels + rect.y * pitch + rect.x, pitch);
+
+    if (display->atlasDirty.w == 0) {
+        display->atlasDirty = rect;
+    } else {
+        SDL_UnionRect(&display->atlasDirty, &rect, &display->atlasDirty);
+    }
 }
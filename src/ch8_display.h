@@ -8,11 +8,25 @@ extern "C"
 {
 #endif
 
-int ch8_displayInit(void* handle);
-void ch8_displayQuit();
-void ch8_displayBeginFrame();
-void ch8_displayEndFrame();
-void ch8_displayWriteFb(const ch8_cpu *cpu);
+/* Renderer, VM texture and ImGui context for one window */
+typedef struct ch8_display ch8_display;
+
+/* `handle` is the SDL_Window to render into; returns NULL on failure */
+ch8_display *ch8_displayCreate(void* handle);
+void ch8_displayDestroy(ch8_display **display);
+/* Feeds an SDL_Event to the display's UI; true if the UI wants it */
+bool ch8_displayProcessEvent(ch8_display *display, const void *event);
+void ch8_displayBeginFrame(ch8_display *display);
+void ch8_displayEndFrame(ch8_display *display);
+void ch8_displayPresent(ch8_display *display);
+void ch8_displayWriteFb(ch8_display *display, const ch8_cpu *cpu);
+
+/*
+ * Grid mode shows `count` VMs side by side from a single atlas texture.
+ * Cells written during a frame are uploaded together in EndFrame.
+ */
+bool ch8_displaySetGrid(ch8_display *display, int count);
+void ch8_displayWriteGridCell(ch8_display *display, int cell, const ch8_cpu *cpu);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,330 @@
+#include "ch8_env.h"
+
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ch8_arena.h"
+#include "ch8_framebuffer.h"
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+// Envs a worker claims at a time
+#define ENV_CHUNK 16
+
+typedef enum envJob
+{
+    JOB_RESET,
+    JOB_STEP,
+} envJob;
+
+typedef struct envSlot
+{
+    u32 seed;
+    bool done; // restart before the next step
+} envSlot;
+
+struct ch8_envBatch
+{
+    ch8_envConfig config;
+    int count;
+    int width;
+    int height;
+    size_t obsSize;
+
+    // VMs live in an arena; resets copy back only the pages dirtied since the clean image
+    ch8_arena *arena;
+    ch8_cpu *image;
+    std::vector<envSlot> slots;
+
+    // Arguments of the job being run
+    envJob job;
+    const u32 *seeds;
+    const u16 *actions;
+    u8 *obs;
+    f32 *rewards;
+    bool *dones;
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable start;
+    std::condition_variable finished;
+    u64 generation = 0;
+    int busy = 0;
+    bool stopping = false;
+    std::atomic<int> nextChunk{0};
+};
+
+static void resetEnv(ch8_envBatch *batch, int i, u32 seed)
+{
+    ch8_cpu *cpu = ch8_arenaGet(batch->arena, i);
+    ch8_syncDirty(cpu, batch->image);
+    ch8_seedRandom(cpu, seed);
+
+    batch->slots[i].seed = seed;
+    batch->slots[i].done = false;
+}
+
+// Mirrors the frontend: keypad follows the mask and FX0A takes the lowest pressed key
+static void applyAction(ch8_cpu *cpu, u16 keys)
+{
+    cpu->keypad = keys;
+
+    if (cpu->waitFlag && keys != 0) {
+        int key = 0;
+        while (((keys >> key) & 1) == 0) {
+            key++;
+        }
+        cpu->V[cpu->waitReg] = (u8)key;
+        cpu->waitFlag = false;
+    }
+}
+
+static void storeBigEndian(u8 *out, u64 bits)
+{
+    for (int b = 0; b < 8; b++) {
+        out[b] = (u8)(bits >> (56 - b * 8));
+    }
+}
+
+static void writeObs(const ch8_envBatch *batch, const ch8_cpu *cpu, u8 *out)
+{
+    int width = batch->width;
+    int height = batch->height;
+    int fbWidth = ch8_fbWidth(cpu);
+    int fbHeight = ch8_fbHeight(cpu);
+    bool packed = batch->config.format == CH8_OBS_1BPP;
+
+    if (packed) {
+        memset(out, 0, batch->obsSize);
+    }
+
+    for (int y = 0; y < height; y++) {
+        const u64 *first = cpu->framebuffer[0][y * fbHeight / height];
+        const u64 *second = cpu->framebuffer[1][y * fbHeight / height];
+
+        // Matching resolution copies whole words
+        if (packed && fbWidth == width) {
+            for (int word = 0; word < width / 64; word++) {
+                storeBigEndian(out + y * width / 8 + word * 8, first[word] | second[word]);
+            }
+            continue;
+        }
+
+        for (int x = 0; x < width; x++) {
+            int fx = x * fbWidth / width;
+            int shift = 63 - fx % 64;
+            u8 color = (u8)(((first[fx / 64] >> shift) & 1) | ((second[fx / 64] >> shift) & 1) << 1);
+            if (packed) {
+                out[y * width / 8 + x / 8] |= (color != 0) << (7 - x % 8);
+            } else {
+                out[y * width + x] = color;
+            }
+        }
+    }
+}
+
+static void stepEnv(ch8_envBatch *batch, int i)
+{
+    const ch8_envConfig &config = batch->config;
+    envSlot &slot = batch->slots[i];
+
+    if (slot.done) {
+        resetEnv(batch, i, slot.seed * 1664525u + 1013904223u);
+    }
+
+    ch8_cpu *cpu = ch8_arenaGet(batch->arena, i);
+    bool halted = false;
+
+    for (u32 frame = 0; frame < config.framesPerStep && !halted; frame++) {
+        applyAction(cpu, batch->actions[i]);
+
+        for (u32 n = 0; n < config.cyclesPerFrame && !cpu->waitFlag; n++) {
+            if (!ch8_clockCycle(cpu, 0.0f)) {
+                halted = true;
+                break;
+            }
+        }
+
+        cpu->delayTimer = ch8_max(cpu->delayTimer - 1, 0);
+        cpu->soundTimer = ch8_max(cpu->soundTimer - 1, 0);
+    }
+
+    bool done = false;
+    f32 reward = config.reward != NULL ? config.reward(cpu, i, config.user, &done) : 0.0f;
+
+    slot.done = done || halted;
+    batch->rewards[i] = reward;
+    batch->dones[i] = slot.done;
+    writeObs(batch, cpu, batch->obs + i * batch->obsSize);
+}
+
+static void work(ch8_envBatch *batch)
+{
+    for (;;) {
+        int first = batch->nextChunk.fetch_add(1, std::memory_order_relaxed) * ENV_CHUNK;
+        if (first >= batch->count) {
+            return;
+        }
+
+        int last = ch8_min(first + ENV_CHUNK, batch->count);
+        for (int i = first; i < last; i++) {
+            if (batch->job == JOB_RESET) {
+                resetEnv(batch, i, batch->seeds[i]);
+                writeObs(batch, ch8_arenaGet(batch->arena, i), batch->obs + i * batch->obsSize);
+            } else {
+                stepEnv(batch, i);
+            }
+        }
+    }
+}
+
+static void workerLoop(ch8_envBatch *batch)
+{
+    u64 seen = 0;
+    std::unique_lock<std::mutex> guard(batch->lock);
+
+    for (;;) {
+        batch->start.wait(guard, [&] { return batch->stopping || batch->generation != seen; });
+        if (batch->stopping) {
+            return;
+        }
+        seen = batch->generation;
+
+        guard.unlock();
+        work(batch);
+        guard.lock();
+
+        if (--batch->busy == 0) {
+            batch->finished.notify_one();
+        }
+    }
+}
+
+// Runs the current job on every worker plus the calling thread
+static void runJob(ch8_envBatch *batch)
+{
+    batch->nextChunk.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(batch->lock);
+        batch->generation++;
+        batch->busy = (int)batch->workers.size();
+    }
+    batch->start.notify_all();
+
+    work(batch);
+
+    std::unique_lock<std::mutex> guard(batch->lock);
+    batch->finished.wait(guard, [&] { return batch->busy == 0; });
+}
+
+ch8_envBatch *ch8_envBatchCreate(const u8 *program, size_t size, int count, const ch8_envConfig *config)
+{
+    assert(config != NULL);
+    assert(count > 0);
+    assert(config->threads > 0);
+
+    ch8_envBatch *batch = new ch8_envBatch();
+    batch->config = *config;
+    batch->count = count;
+    batch->width = config->hires ? CH8_DISPLAY_HIRES_WIDTH : CH8_DISPLAY_WIDTH;
+    batch->height = config->hires ? CH8_DISPLAY_HIRES_HEIGHT : CH8_DISPLAY_HEIGHT;
+    batch->obsSize = (size_t)batch->width * batch->height / (config->format == CH8_OBS_1BPP ? 8 : 1);
+    batch->slots.resize(count);
+
+    batch->arena = ch8_arenaCreate(program, size, config->quirks, count);
+    batch->image = (ch8_cpu *)aligned_alloc(CH8_CACHE_LINE, sizeof(ch8_cpu));
+    if (batch->arena == NULL || batch->image == NULL) {
+        ch8_envBatchDestroy(&batch);
+        return NULL;
+    }
+
+    // Same state the arena slots start from, kept clean as the reset baseline
+    ch8_reset(batch->image);
+    ch8_loadRomData(batch->image, program, size);
+    ch8_setQuirks(batch->image, config->quirks);
+    ch8_markClean(batch->image);
+
+    for (int t = 1; t < config->threads; t++) {
+        batch->workers.emplace_back(workerLoop, batch);
+    }
+
+    return batch;
+}
+
+void ch8_envBatchDestroy(ch8_envBatch **batch)
+{
+    assert(batch != NULL);
+
+    ch8_envBatch *b = *batch;
+    if (b == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(b->lock);
+        b->stopping = true;
+    }
+    b->start.notify_all();
+    for (std::thread &t : b->workers) {
+        t.join();
+    }
+
+    if (b->arena != NULL) {
+        ch8_arenaDestroy(&b->arena);
+    }
+    free(b->image);
+
+    delete b;
+    *batch = NULL;
+}
+
+int ch8_envBatchCount(const ch8_envBatch *batch)
+{
+    assert(batch != NULL);
+    return batch->count;
+}
+
+size_t ch8_envBatchObsSize(const ch8_envBatch *batch)
+{
+    assert(batch != NULL);
+    return batch->obsSize;
+}
+
+const ch8_cpu *ch8_envBatchCpu(const ch8_envBatch *batch, int env)
+{
+    assert(batch != NULL);
+    return ch8_arenaGet(batch->arena, env);
+}
+
+void ch8_envBatchReset(ch8_envBatch *batch, const u32 *seeds, u8 *obs)
+{
+    assert(batch != NULL);
+    assert(seeds != NULL);
+    assert(obs != NULL);
+
+    batch->job = JOB_RESET;
+    batch->seeds = seeds;
+    batch->obs = obs;
+    runJob(batch);
+}
+
+void ch8_envBatchStep(ch8_envBatch *batch, const u16 *actions, u8 *obs, f32 *rewards, bool *dones)
+{
+    assert(batch != NULL);
+    assert(actions != NULL);
+    assert(obs != NULL);
+    assert(rewards != NULL);
+    assert(dones != NULL);
+
+    batch->job = JOB_STEP;
+    batch->actions = actions;
+    batch->obs = obs;
+    batch->rewards = rewards;
+    batch->dones = dones;
+    runJob(batch);
+}
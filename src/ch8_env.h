@@ -0,0 +1,68 @@
+#ifndef __ENV_H__
+#define __ENV_H__
+
+/*
+ * Batch of N headless environments running one ROM, stepped together for
+ * reinforcement learning. Each step holds every env's action (a key mask)
+ * for a number of frames, then writes observations, rewards and done flags
+ * into caller-provided arrays indexed by env. Envs are spread over a
+ * thread pool; results don't depend on the number of threads.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum ch8_obsFormat
+{
+    CH8_OBS_1BPP, /* rows of width / 8 bytes, leftmost pixel in the top bit, lit on any plane */
+    CH8_OBS_U8,   /* one byte per pixel holding the color index 0-3 */
+} ch8_obsFormat;
+
+/*
+ * Called on a worker thread after each env's step. Returns the reward;
+ * setting *done ends the episode. Envs whose VM halts are always done.
+ */
+typedef f32 (*ch8_envRewardFn)(const ch8_cpu *cpu, int env, void *user, bool *done);
+
+typedef struct ch8_envConfig
+{
+    u32 quirks;
+    u32 framesPerStep;  /* action repeat; timers tick once per frame */
+    u32 cyclesPerFrame;
+    ch8_obsFormat format;
+    bool hires;         /* 128x64 observations (low resolution is doubled) instead of 64x32 */
+    int threads;        /* including the caller's */
+    ch8_envRewardFn reward;
+    void *user;
+} ch8_envConfig;
+
+typedef struct ch8_envBatch ch8_envBatch;
+
+/* Returns NULL if the program doesn't fit or allocation fails */
+ch8_envBatch *ch8_envBatchCreate(const u8 *program, size_t size, int count, const ch8_envConfig *config);
+void ch8_envBatchDestroy(ch8_envBatch **batch);
+
+int ch8_envBatchCount(const ch8_envBatch *batch);
+/* Bytes of one env's observation; env i's starts at obs + i * ch8_envBatchObsSize */
+size_t ch8_envBatchObsSize(const ch8_envBatch *batch);
+const ch8_cpu *ch8_envBatchCpu(const ch8_envBatch *batch, int env);
+
+/* Restarts every env with its seed and writes the first observations */
+void ch8_envBatchReset(ch8_envBatch *batch, const u32 *seeds, u8 *obs);
+
+/*
+ * Advances every env by one step. Envs that were done after the previous
+ * step are restarted first (with a new seed drawn from their old one), so
+ * the observation returned with done set is the episode's last.
+ */
+void ch8_envBatchStep(ch8_envBatch *batch, const u16 *actions, u8 *obs, f32 *rewards, bool *dones);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
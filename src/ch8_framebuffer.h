@@ -0,0 +1,85 @@
+#ifndef __FRAMEBUFFER_H__
+#define __FRAMEBUFFER_H__
+
+/*
+ * Framebuffer rows are 128 pixels stored as two u64 words, most significant
+ * bit first: pixel x lives in word x / 64 at bit 63 - x % 64. Low resolution
+ * only uses the first word of the first 32 rows.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Colors for the four plane combinations: off, first plane, second plane, both */
+static const u8 ch8_palette[4][3] = {
+    {0x00, 0x00, 0x00},
+    {0xFF, 0xFF, 0xFF},
+    {0xAA, 0xAA, 0xAA},
+    {0x55, 0x55, 0x55},
+};
+
+static inline int ch8_fbWidth(const ch8_cpu *cpu)
+{
+    return cpu->hires ? CH8_DISPLAY_HIRES_WIDTH : CH8_DISPLAY_WIDTH;
+}
+
+static inline int ch8_fbHeight(const ch8_cpu *cpu)
+{
+    return cpu->hires ? CH8_DISPLAY_HIRES_HEIGHT : CH8_DISPLAY_HEIGHT;
+}
+
+/* Moves pixels n places to the right (0 <= n < 128) */
+static inline void ch8_fbShiftRight(u64 row[CH8_DISPLAY_ROW_WORDS], int n)
+{
+    if (n >= 64) {
+        row[1] = row[0] >> (n - 64);
+        row[0] = 0;
+    } else if (n > 0) {
+        row[1] = (row[1] >> n) | (row[0] << (64 - n));
+        row[0] >>= n;
+    }
+}
+
+/* Moves pixels n places to the left (0 <= n < 128) */
+static inline void ch8_fbShiftLeft(u64 row[CH8_DISPLAY_ROW_WORDS], int n)
+{
+    if (n >= 64) {
+        row[0] = row[1] << (n - 64);
+        row[1] = 0;
+    } else if (n > 0) {
+        row[0] = (row[0] << n) | (row[1] >> (64 - n));
+        row[1] <<= n;
+    }
+}
+
+/*
+ * Expands a sprite row of `bits` (`spriteWidth` pixels, leftmost in the most
+ * significant bit) into a framebuffer row with its first pixel at x. Pixels
+ * past `width` are dropped, or wrap to the start of the row when `wrap` is set.
+ */
+static inline void ch8_fbSpriteRow(u32 bits, int spriteWidth, int x, int width, bool wrap,
+                                   u64 out[CH8_DISPLAY_ROW_WORDS])
+{
+    u64 top = (u64)bits << (64 - spriteWidth);
+
+    out[0] = top;
+    out[1] = 0;
+    ch8_fbShiftRight(out, x);
+
+    if (wrap && x + spriteWidth > width) {
+        out[0] |= top << (width - x);
+    }
+    if (width < CH8_DISPLAY_HIRES_WIDTH) {
+        out[1] = 0;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+#include "ch8_frametime.h"
+
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <SDL.h>
+
+#include <imgui.h>
+
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+#define CSV_FILE "frametimes.csv"
+
+static const char *stageNames[CH8_STAGE_COUNT] = {
+    "Emulation",
+    "Texture upload",
+    "ImGui",
+    "Present",
+};
+
+struct ch8_frameTime
+{
+    // Rolling window of per-stage timings in milliseconds, oldest sample at `head` once full
+    f32 samples[CH8_STAGE_COUNT][CH8_FRAMETIME_WINDOW];
+    f32 current[CH8_STAGE_COUNT];
+    u64 stageStart[CH8_STAGE_COUNT];
+    u32 head;
+    u32 count;
+    u64 frameNumber;
+    f64 ticksToMs;
+
+    // Window is tiny, sorting a scratch copy is cheaper than maintaining buckets
+    f32 sorted[CH8_FRAMETIME_WINDOW];
+
+    bool overlayVisible;
+    bool dumpOnExit;
+};
+
+ch8_frameTime *ch8_frameTimeCreate()
+{
+    ch8_frameTime *ft = (ch8_frameTime *)ch8_malloc(sizeof(ch8_frameTime));
+    if (ft == NULL) {
+        return NULL;
+    }
+    ft->ticksToMs = 1000.0 / (f64)SDL_GetPerformanceFrequency();
+
+    return ft;
+}
+
+void ch8_frameTimeDestroy(ch8_frameTime **ft)
+{
+    assert(ft != NULL);
+
+    if (*ft == NULL) {
+        return;
+    }
+    if ((*ft)->dumpOnExit) {
+        ch8_frameTimeDumpCsv(*ft, CSV_FILE);
+    }
+
+    ch8_free((void **)ft);
+}
+
+void ch8_frameTimeBegin(ch8_frameTime *ft, ch8_frameStage stage)
+{
+    assert(ft != NULL);
+    assert(stage < CH8_STAGE_COUNT);
+    ft->stageStart[stage] = SDL_GetPerformanceCounter();
+}
+
+void ch8_frameTimeEnd(ch8_frameTime *ft, ch8_frameStage stage)
+{
+    assert(ft != NULL);
+    assert(stage < CH8_STAGE_COUNT);
+    u64 end = SDL_GetPerformanceCounter();
+    ft->current[stage] += (f32)((f64)(end - ft->stageStart[stage]) * ft->ticksToMs);
+}
+
+void ch8_frameTimeCommit(ch8_frameTime *ft)
+{
+    assert(ft != NULL);
+
+    for (int s = 0; s < CH8_STAGE_COUNT; s++) {
+        ft->samples[s][ft->head] = ft->current[s];
+        ft->current[s] = 0.0f;
+    }
+
+    ft->head = (ft->head + 1) % CH8_FRAMETIME_WINDOW;
+    if (ft->count < CH8_FRAMETIME_WINDOW) {
+        ft->count++;
+    }
+    ft->frameNumber++;
+}
+
+static f32 percentile(const f32 *sorted, u32 n, f32 p)
+{
+    u32 rank = (u32)(p * (f32)n + 0.999f);
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted[ch8_min(rank, n) - 1];
+}
+
+void ch8_frameTimeGetStats(ch8_frameTime *ft, ch8_frameStage stage, ch8_frameStats *stats)
+{
+    assert(ft != NULL);
+    assert(stage < CH8_STAGE_COUNT);
+    assert(stats != NULL);
+
+    memset(stats, 0, sizeof(ch8_frameStats));
+    u32 count = ft->count;
+    u32 head = ft->head;
+    if (count == 0) {
+        return;
+    }
+
+    f32 *sorted = ft->sorted;
+    f32 *samples = ft->samples[stage];
+    u32 first = (count < CH8_FRAMETIME_WINDOW) ? 0 : head;
+    for (u32 i = 0; i < count; i++) {
+        sorted[i] = samples[(first + i) % CH8_FRAMETIME_WINDOW];
+    }
+    std::sort(sorted, sorted + count);
+
+    stats->last = samples[(head + CH8_FRAMETIME_WINDOW - 1) % CH8_FRAMETIME_WINDOW];
+    stats->p50 = percentile(sorted, count, 0.50f);
+    stats->p95 = percentile(sorted, count, 0.95f);
+    stats->p99 = percentile(sorted, count, 0.99f);
+    stats->max = sorted[count - 1];
+}
+
+void ch8_frameTimeToggleOverlay(ch8_frameTime *ft)
+{
+    assert(ft != NULL);
+    ft->overlayVisible = !ft->overlayVisible;
+}
+
+void ch8_frameTimeDrawOverlay(ch8_frameTime *ft)
+{
+    assert(ft != NULL);
+    if (!ft->overlayVisible) {
+        return;
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(8.0f, 8.0f), ImGuiCond_Once);
+    ImGui::SetNextWindowBgAlpha(0.75f);
+    if (!ImGui::Begin("Frame time", &ft->overlayVisible, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Frame %llu, %u sample window", (unsigned long long)ft->frameNumber, ft->count);
+
+    if (ImGui::BeginTable("stages", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Stage (ms)");
+        ImGui::TableSetupColumn("last");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableHeadersRow();
+
+        for (int s = 0; s < CH8_STAGE_COUNT; s++) {
+            ch8_frameStats stats;
+            ch8_frameTimeGetStats(ft, (ch8_frameStage)s, &stats);
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stageNames[s]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.last);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.p50);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.p95);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.p99);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.max);
+        }
+
+        ImGui::EndTable();
+    }
+
+    // Plot the window in chronological order
+    int offset = (ft->count < CH8_FRAMETIME_WINDOW) ? 0 : (int)ft->head;
+    for (int s = 0; s < CH8_STAGE_COUNT; s++) {
+        ImGui::PlotLines(stageNames[s], ft->samples[s], (int)ft->count, offset, NULL, 0.0f, FLT_MAX, ImVec2(240.0f, 32.0f));
+    }
+
+    ImGui::Checkbox("Dump CSV on exit (" CSV_FILE ")", &ft->dumpOnExit);
+
+    ImGui::End();
+}
+
+bool ch8_frameTimeDumpCsv(ch8_frameTime *ft, const char *file)
+{
+    assert(ft != NULL);
+    assert(file != NULL);
+
+    FILE *f = fopen(file, "w");
+    if (f == NULL) {
+        ch8_logError("Could not open %s for writing", file);
+        return false;
+    }
+
+    // Summary first as comment lines so the body stays plain CSV
+    for (int s = 0; s < CH8_STAGE_COUNT; s++) {
+        ch8_frameStats stats;
+        ch8_frameTimeGetStats(ft, (ch8_frameStage)s, &stats);
+        fprintf(f, "# %s: p50=%.4f p95=%.4f p99=%.4f max=%.4f\n", stageNames[s], stats.p50, stats.p95, stats.p99, stats.max);
+    }
+
+    fprintf(f, "frame,emulation_ms,texture_upload_ms,imgui_ms,present_ms\n");
+
+    u32 first = (ft->count < CH8_FRAMETIME_WINDOW) ? 0 : ft->head;
+    for (u32 i = 0; i < ft->count; i++) {
+        u32 slot = (first + i) % CH8_FRAMETIME_WINDOW;
+        fprintf(f, "%llu", (unsigned long long)(ft->frameNumber - ft->count + i));
+        for (int s = 0; s < CH8_STAGE_COUNT; s++) {
+            fprintf(f, ",%.4f", ft->samples[s][slot]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+
+    ch8_logInfo("Frame times written to %s", file);
+
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef __FRAMETIME_H__
+#define __FRAMETIME_H__
+
+#include <stdbool.h>
+
+#include "ch8_def.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Number of frames kept in the rolling window (~10 seconds at 60hz)
+#define CH8_FRAMETIME_WINDOW 600
+
+typedef enum ch8_frameStage
+{
+    CH8_STAGE_EMULATION = 0,
+    CH8_STAGE_TEXTURE_UPLOAD,
+    CH8_STAGE_IMGUI,
+    CH8_STAGE_PRESENT,
+    CH8_STAGE_COUNT
+} ch8_frameStage;
+
+typedef struct ch8_frameStats
+{
+    f32 last;
+    f32 p50;
+    f32 p95;
+    f32 p99;
+    f32 max;
+} ch8_frameStats;
+
+/* Stage timings of one window's frames; each session and grid owns one */
+typedef struct ch8_frameTime ch8_frameTime;
+
+/* Returns NULL on failure */
+ch8_frameTime *ch8_frameTimeCreate();
+/* Dumps the CSV first if the overlay asked for it */
+void ch8_frameTimeDestroy(ch8_frameTime **ft);
+
+void ch8_frameTimeBegin(ch8_frameTime *ft, ch8_frameStage stage);
+void ch8_frameTimeEnd(ch8_frameTime *ft, ch8_frameStage stage);
+void ch8_frameTimeCommit(ch8_frameTime *ft);
+
+void ch8_frameTimeGetStats(ch8_frameTime *ft, ch8_frameStage stage, ch8_frameStats *stats);
+
+void ch8_frameTimeToggleOverlay(ch8_frameTime *ft);
+void ch8_frameTimeDrawOverlay(ch8_frameTime *ft);
+
+bool ch8_frameTimeDumpCsv(ch8_frameTime *ft, const char *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
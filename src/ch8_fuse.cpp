@@ -0,0 +1,164 @@
+#include "ch8_fuse.h"
+
+#include <assert.h>
+#include <array>
+#include <utility>
+
+#include "ch8_quirks.h"
+#include "ch8_trace.h"
+
+typedef u32 (*fuseRunFn)(ch8_cpu *cpu, u32 budget);
+
+static inline u16 fetch(const ch8_cpu *cpu, u16 addr)
+{
+    return cpu->memory[addr & CH8_ADDR_MASK] << 8 | cpu->memory[(addr + 1) & CH8_ADDR_MASK];
+}
+
+// None of the fused instructions set a flag before the last one, so one reset covers the sequence
+static inline void resetFlags(ch8_cpu *cpu)
+{
+    cpu->drawFlag = false;
+    cpu->waitFlag = false;
+    cpu->waitReg = 0;
+}
+
+static bool isLoop(u16 head, u16 test, u16 jump)
+{
+    bool counts = (head & 0xF000) == 0x7000 || (head & 0xF0FF) == 0xF007;
+    bool tests = (test & 0xF000) == 0x3000 || (test & 0xF000) == 0x4000;
+    return counts && tests && (jump & 0xF000) == 0x1000;
+}
+
+// 7XKK or FX07, then 3XKK/4XKK over 1NNN; returns 2 when the test skips the jump
+static u32 runLoop(ch8_cpu *cpu, u16 pc, u16 head, u16 test, u16 jump)
+{
+    u8 x = (head & 0x0F00) >> 8;
+    if ((head & 0xF000) == 0x7000) {
+        cpu->V[x] += head & 0x00FF;
+    } else {
+        cpu->V[x] = cpu->delayTimer;
+    }
+
+    bool equal = cpu->V[(test & 0x0F00) >> 8] == (test & 0x00FF);
+    if (equal == ((test & 0xF000) == 0x3000)) {
+        cpu->programCounter = pc + 3 * CH8_PC_STEP_SIZE;
+        return 2;
+    }
+
+    cpu->programCounter = jump & 0x0FFF;
+    return 3;
+}
+
+static u32 runPlain(ch8_cpu *cpu, u32 budget)
+{
+    u32 n = 0;
+    while (n < budget && !cpu->waitFlag && ch8_clockCycle(cpu, 0.0f)) {
+        n++;
+    }
+    return n;
+}
+
+// Anything that does not start a fused sequence, or does not fit in the budget, runs alone in the interpreter
+template <u32 Quirks>
+static u32 run(ch8_cpu *cpu, u32 budget)
+{
+    // Fused sequences would skip mirroring the stack and display after each instruction
+    if constexpr ((Quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        return runPlain(cpu, budget);
+    }
+
+    u32 n = 0;
+
+    while (n < budget && !cpu->waitFlag && cpu->fault == CH8_FAULT_NONE) {
+        u16 pc = cpu->programCounter;
+        u16 opcode = fetch(cpu, pc);
+        u32 left = budget - n;
+        u32 ran = 0;
+
+        switch (opcode & 0xF000)
+        {
+        case 0x1000:
+            if ((opcode & 0x0FFF) == pc) {
+                resetFlags(cpu);
+                ran = left;
+            }
+            break;
+        case 0xA000:
+        {
+            u16 next = left >= 2 ? fetch(cpu, pc + CH8_PC_STEP_SIZE) : 0;
+            if ((next & 0xF000) == 0xD000) {
+                resetFlags(cpu);
+                cpu->index = opcode & 0x0FFF;
+                cpu->programCounter += CH8_PC_STEP_SIZE;
+                ch8_op_DrawSprite<Quirks>(cpu, next);
+                ran = 2;
+            } else if ((next & 0xF0FF) == 0xF065) {
+                resetFlags(cpu);
+                cpu->index = opcode & 0x0FFF;
+                cpu->programCounter += CH8_PC_STEP_SIZE;
+                ch8_op_Load<Quirks>(cpu, next);
+                ran = 2;
+            }
+            break;
+        }
+        case 0x7000:
+        case 0xF000:
+        {
+            if (left < 3) {
+                break;
+            }
+            u16 test = fetch(cpu, pc + CH8_PC_STEP_SIZE);
+            u16 jump = fetch(cpu, pc + 2 * CH8_PC_STEP_SIZE);
+            if (isLoop(opcode, test, jump)) {
+                resetFlags(cpu);
+                ran = runLoop(cpu, pc, opcode, test, jump);
+
+                // The timer cannot change within a run, so every further iteration would be the same
+                if ((opcode & 0xF000) == 0xF000 && cpu->programCounter == pc) {
+                    ran += (left - 3) / 3 * 3;
+                }
+            }
+            break;
+        }
+        }
+
+        // What ch8_clockCycle does, minus the fetch and trace hook already taken care of
+        if (ran == 0) {
+            if (opcode == 0) {
+                break;
+            }
+            resetFlags(cpu);
+            if (!cpu->execute(cpu, pc, opcode)) {
+                break;
+            }
+            cpu->cycles++;
+            n++;
+            continue;
+        }
+
+        cpu->cycles += ran;
+        n += ran;
+    }
+
+    return n;
+}
+
+template <u32... Quirks>
+static constexpr std::array<fuseRunFn, sizeof...(Quirks)> makeRunners(std::integer_sequence<u32, Quirks...>)
+{
+    return {{run<Quirks>...}};
+}
+
+static constexpr auto runners = makeRunners(std::make_integer_sequence<u32, CH8_QUIRKS_SPECIALIZED + 1>());
+
+u32 ch8_fuseRun(ch8_cpu *cpu, u32 budget)
+{
+    assert(cpu != NULL);
+
+    // A trace needs every instruction recorded on its own
+    if (ch8_traceIsActive()) {
+        return runPlain(cpu, budget);
+    }
+
+    return runners[cpu->quirks & CH8_QUIRKS_SPECIALIZED](cpu, budget);
+}
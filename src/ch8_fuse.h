@@ -0,0 +1,34 @@
+#ifndef __FUSE_H__
+#define __FUSE_H__
+
+/*
+ * Superinstructions: sequences that dominate the bundled ROMs run in a single
+ * dispatch. They are recognized whenever the PC is decoded, never cached, so
+ * a jump into the middle of a sequence simply decodes from that address and
+ * rewritten code is picked up on the next fetch.
+ *
+ *   ANNN DXYN          set I and draw
+ *   ANNN FX65          set I and load registers
+ *   7XKK 3XKK/4XKK 1NNN   counting loop
+ *   FX07 3XKK/4XKK 1NNN   delay timer wait
+ *   1NNN to itself     idle loop
+ *
+ * Timers only tick between runs, so a timer wait or idle loop that jumps back
+ * to itself repeats identically and is fast-forwarded through the budget.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Same contract as ch8_backendRun */
+u32 ch8_fuseRun(ch8_cpu *cpu, u32 budget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+#include "ch8_grid.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <SDL.h>
+
+#include "ch8_arena.h"
+#include "ch8_display.h"
+#include "ch8_keyboard.h"
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+struct ch8_grid
+{
+    ch8_arena *arena;
+    SDL_Window *window;
+    ch8_display *display;
+    ch8_frameTime *frameTime;
+};
+
+static bool readRom(const char *file, u8 *program, size_t *size)
+{
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+        ch8_logError("Could not open file %s...", file);
+        return false;
+    }
+
+    // One byte more than fits, to tell a full-size ROM from an oversized one
+    *size = fread(program, 1, CH8_MAX_PROGRAM_SIZE + 1, f);
+    fclose(f);
+
+    if (*size > CH8_MAX_PROGRAM_SIZE) {
+        ch8_logError("File size too large (%s)", file);
+        return false;
+    }
+    return true;
+}
+
+ch8_grid *ch8_gridCreate(const char *rom, u32 quirks, int count)
+{
+    assert(rom != NULL);
+    assert(count > 0);
+
+    static u8 program[CH8_MAX_PROGRAM_SIZE + 1];
+    size_t size = 0;
+    if (!readRom(rom, program, &size)) {
+        return NULL;
+    }
+
+    ch8_grid *grid = (ch8_grid *)ch8_malloc(sizeof(ch8_grid));
+    if (grid == NULL) {
+        return NULL;
+    }
+
+    grid->arena = ch8_arenaCreate(program, size, quirks, count);
+    if (grid->arena == NULL) {
+        ch8_gridDestroy(&grid);
+        return NULL;
+    }
+
+    // Same ROM, different random streams
+    u32 seed = (u32)time(NULL);
+    for (int i = 0; i < count; i++) {
+        ch8_seedRandom(ch8_arenaGet(grid->arena, i), seed + i);
+    }
+
+    grid->window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1280, 640,
+                                    SDL_WINDOW_RESIZABLE);
+    if (grid->window == NULL) {
+        ch8_logCritical("Could not create SDL window: %s", SDL_GetError());
+        ch8_gridDestroy(&grid);
+        return NULL;
+    }
+
+    grid->display = ch8_displayCreate(static_cast<void*>(grid->window));
+    if (grid->display == NULL || !ch8_displaySetGrid(grid->display, count)) {
+        ch8_logCritical("Failed to initialize the display\n");
+        ch8_gridDestroy(&grid);
+        return NULL;
+    }
+
+    grid->frameTime = ch8_frameTimeCreate();
+    if (grid->frameTime == NULL) {
+        ch8_logCritical("Failed to initialize frame timing");
+        ch8_gridDestroy(&grid);
+        return NULL;
+    }
+
+    return grid;
+}
+
+void ch8_gridDestroy(ch8_grid **grid)
+{
+    assert(grid != NULL);
+
+    ch8_grid *g = *grid;
+    if (g == NULL) {
+        return;
+    }
+
+    ch8_frameTimeDestroy(&g->frameTime);
+    ch8_displayDestroy(&g->display);
+    if (g->window != NULL) {
+        SDL_DestroyWindow(g->window);
+    }
+    if (g->arena != NULL) {
+        ch8_arenaDestroy(&g->arena);
+    }
+
+    ch8_free((void **)grid);
+}
+
+void ch8_gridHandleEvent(ch8_grid *grid, const void *event)
+{
+    assert(grid != NULL);
+    assert(event != NULL);
+
+    const SDL_Event *e = static_cast<const SDL_Event*>(event);
+    ch8_displayProcessEvent(grid->display, event);
+
+    if (e->type != SDL_KEYDOWN && e->type != SDL_KEYUP) {
+        return;
+    }
+
+    ch8_key key = __SDLKeycodeToKeyRegister(e->key.keysym.sym);
+    if (key == KEY_UNKNOWN) {
+        return;
+    }
+
+    for (int i = 0; i < ch8_arenaCount(grid->arena); i++) {
+        ch8_cpu *cpu = ch8_arenaGet(grid->arena, i);
+        if (e->type == SDL_KEYUP) {
+            ch8_setKeyUp(cpu, key);
+            continue;
+        }
+
+        ch8_setKeyDown(cpu, key);
+        if (cpu->waitFlag) {
+            cpu->V[cpu->waitReg] = key;
+            cpu->waitFlag = false;
+        }
+    }
+}
+
+void ch8_gridRunFrame(ch8_grid *grid)
+{
+    assert(grid != NULL);
+
+    ch8_frameTime *ft = grid->frameTime;
+    ch8_frameTimeBegin(ft, CH8_STAGE_EMULATION);
+
+    for (int i = 0; i < ch8_arenaCount(grid->arena); i++) {
+        ch8_cpu *cpu = ch8_arenaGet(grid->arena, i);
+
+        // drawFlag only describes the last instruction, so collect it over the frame
+        bool drawn = false;
+        for (u32 n = 0; n < CH8_GRID_CYCLES_PER_FRAME && !cpu->waitFlag; n++) {
+            if (!ch8_clockCycle(cpu, 0.0f)) {
+                break;
+            }
+            drawn |= cpu->drawFlag;
+        }
+
+        cpu->delayTimer = ch8_max(cpu->delayTimer - 1, 0);
+        cpu->soundTimer = ch8_max(cpu->soundTimer - 1, 0);
+
+        // Only changed cells are expanded; EndFrame uploads them together
+        if (drawn) {
+            ch8_displayWriteGridCell(grid->display, i, cpu);
+        }
+    }
+    ch8_frameTimeEnd(ft, CH8_STAGE_EMULATION);
+
+    // The atlas upload happens in EndFrame and is counted with the UI
+    ch8_frameTimeBegin(ft, CH8_STAGE_IMGUI);
+    ch8_displayBeginFrame(grid->display);
+    ch8_frameTimeDrawOverlay(ft);
+    ch8_displayEndFrame(grid->display);
+    ch8_frameTimeEnd(ft, CH8_STAGE_IMGUI);
+
+    ch8_frameTimeBegin(ft, CH8_STAGE_PRESENT);
+    ch8_displayPresent(grid->display);
+    ch8_frameTimeEnd(ft, CH8_STAGE_PRESENT);
+
+    ch8_frameTimeCommit(ft);
+}
+
+ch8_frameTime *ch8_gridFrameTime(ch8_grid *grid)
+{
+    assert(grid != NULL);
+    return grid->frameTime;
+}
@@ -0,0 +1,36 @@
+#ifndef __GRID_H__
+#define __GRID_H__
+
+/*
+ * Frontend mode that runs many VMs of one ROM (each seeded differently) and
+ * shows them side by side in a single window. Key presses go to every VM.
+ */
+
+#include "ch8_cpu.h"
+#include "ch8_frametime.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_GRID_CYCLES_PER_FRAME 10
+
+typedef struct ch8_grid ch8_grid;
+
+/* Returns NULL on failure */
+ch8_grid *ch8_gridCreate(const char *rom, u32 quirks, int count);
+void ch8_gridDestroy(ch8_grid **grid);
+
+/* Feeds an SDL_Event to the grid's UI and the VMs' keypads */
+void ch8_gridHandleEvent(ch8_grid *grid, const void *event);
+/* Runs every VM for one 60hz frame and redraws the cells that changed */
+void ch8_gridRunFrame(ch8_grid *grid);
+
+ch8_frameTime *ch8_gridFrameTime(ch8_grid *grid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
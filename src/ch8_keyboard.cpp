@@ -54,7 +54,7 @@ bool ch8_isKeyDown(const ch8_cpu *cpu, ch8_key key)
     if (key == KEY_UNKNOWN) {
         return false;
     }
-    return cpu->keypad[key] == true;
+    return (cpu->keypad & (1 << key)) != 0;
 }
 
 bool ch8_isKeyUp(const ch8_cpu *cpu, ch8_key key)
@@ -63,14 +63,14 @@ bool ch8_isKeyUp(const ch8_cpu *cpu, ch8_key key)
     if (key == KEY_UNKNOWN) {
         return false;
     }
-    return cpu->keypad[key] == false;
+    return (cpu->keypad & (1 << key)) == 0;
 }
 
 void ch8_setKeyDown(ch8_cpu *cpu, ch8_key key)
 {
     assert(cpu != NULL);
     if (key != KEY_UNKNOWN) {
-        cpu->keypad[key] = true;
+        cpu->keypad |= (u16)(1 << key);
     }
 }
 
@@ -78,6 +78,6 @@ void ch8_setKeyUp(ch8_cpu *cpu, ch8_key key)
 {
     assert(cpu != NULL);
     if (key != KEY_UNKNOWN) {
-        cpu->keypad[key] = false;
+        cpu->keypad &= (u16)~(1 << key);
     }
 }
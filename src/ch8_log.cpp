@@ -1,24 +1,200 @@
 #include "ch8_log.h"
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <atomic>
 #include <SDL.h>
 
+#include "ch8_def.h"
+
 #define LOG_CATEGORY SDL_LOG_CATEGORY_APPLICATION
 
-static bool initialized = false;
-#define INIT_CHECK if (!initialized) return
+// Bounded queue of preallocated message buffers (must be a power of two)
+#define LOG_QUEUE_SIZE 256
+#define LOG_MESSAGE_SIZE 256
+
+typedef struct ch8_logSlot
+{
+    std::atomic<u32> sequence;
+    SDL_LogPriority priority;
+    char text[LOG_MESSAGE_SIZE];
+} ch8_logSlot;
+
+struct ch8_logger
+{
+    ch8_logSlot queue[LOG_QUEUE_SIZE];
+    std::atomic<u32> enqueuePos{0};
+    u32 dequeuePos = 0; // only touched by the writer thread
+    std::atomic<u32> dropped{0};
+
+    SDL_Thread *writer = NULL;
+    SDL_sem *pending = NULL;
+    std::atomic<bool> running{false};
+
+    char name[32] = {0}; // prefixed to every message when set
+};
+
+// Messages go to the logger bound to the calling thread, else the process-wide one
+static ch8_logger *processLogger = NULL;
+static thread_local ch8_logger *boundLogger = NULL;
+
+static ch8_logger *current()
+{
+    return boundLogger != NULL ? boundLogger : processLogger;
+}
+
+#define INIT_CHECK if (current() == NULL) return
+
+// Writes out everything that has been published so far
+static void drain(ch8_logger *log)
+{
+    for (;;) {
+        ch8_logSlot *slot = &log->queue[log->dequeuePos & (LOG_QUEUE_SIZE - 1)];
+        if (slot->sequence.load(std::memory_order_acquire) != log->dequeuePos + 1) {
+            break;
+        }
+
+        SDL_LogMessage(LOG_CATEGORY, slot->priority, "%s", slot->text);
+
+        // Hand the slot back to producers for the next lap around the ring
+        slot->sequence.store(log->dequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+        log->dequeuePos++;
+    }
+
+    u32 lost = log->dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        SDL_LogMessage(LOG_CATEGORY, SDL_LOG_PRIORITY_WARN, "%u log messages dropped (queue full)", lost);
+    }
+}
+
+static int writerThread(void *data)
+{
+    ch8_logger *log = (ch8_logger *)data;
+
+    while (log->running.load(std::memory_order_acquire)) {
+        SDL_SemWait(log->pending);
+        drain(log);
+    }
+
+    // Flush whatever was logged before the logger was destroyed
+    drain(log);
+
+    return 0;
+}
+
+// Multi-producer enqueue, never blocks: the message is dropped if the queue is full
+static void enqueue(SDL_LogPriority priority, const char *fmt, va_list va)
+{
+    ch8_logger *log = current();
+    if (log == NULL) {
+        return;
+    }
+
+    ch8_logSlot *slot;
+    u32 pos = log->enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        slot = &log->queue[pos & (LOG_QUEUE_SIZE - 1)];
+        u32 seq = slot->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (log->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            log->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = log->enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    int prefix = 0;
+    if (log->name[0] != '\0') {
+        prefix = snprintf(slot->text, LOG_MESSAGE_SIZE, "[%s] ", log->name);
+    }
+
+    slot->priority = priority;
+    vsnprintf(slot->text + prefix, LOG_MESSAGE_SIZE - prefix, fmt, va);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    SDL_SemPost(log->pending);
+}
+
+ch8_logger *ch8_logCreate(const char *name)
+{
+    ch8_logger *log = new ch8_logger();
+
+    for (u32 i = 0; i < LOG_QUEUE_SIZE; i++) {
+        log->queue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    if (name != NULL) {
+        snprintf(log->name, sizeof(log->name), "%s", name);
+    }
+
+    log->pending = SDL_CreateSemaphore(0);
+    if (log->pending == NULL) {
+        fprintf(stderr, "Could not create log semaphore: %s\n", SDL_GetError());
+        delete log;
+        return NULL;
+    }
+
+    log->running.store(true, std::memory_order_release);
+    log->writer = SDL_CreateThread(writerThread, "ch8_log", log);
+    if (log->writer == NULL) {
+        fprintf(stderr, "Could not create log thread: %s\n", SDL_GetError());
+        SDL_DestroySemaphore(log->pending);
+        delete log;
+        return NULL;
+    }
+
+    return log;
+}
+
+void ch8_logDestroy(ch8_logger **logger)
+{
+    assert(logger != NULL);
+
+    ch8_logger *log = *logger;
+    if (log == NULL) {
+        return;
+    }
+    *logger = NULL;
+
+    if (boundLogger == log) {
+        boundLogger = NULL;
+    }
+
+    log->running.store(false, std::memory_order_release);
+    SDL_SemPost(log->pending);
+    SDL_WaitThread(log->writer, NULL);
+
+    SDL_DestroySemaphore(log->pending);
+    delete log;
+}
+
+void ch8_logBind(ch8_logger *logger)
+{
+    boundLogger = logger;
+}
 
 int ch8_logInit()
 {
+    if (processLogger != NULL) {
+        return 1;
+    }
+
     SDL_LogSetPriority(LOG_CATEGORY, SDL_LOG_PRIORITY_DEBUG);
-    initialized = true;
-    return 0;
+
+    processLogger = ch8_logCreate(NULL);
+    return processLogger != NULL ? 0 : 1;
 }
 
 void ch8_logQuit()
 {
-    initialized = false;
+    ch8_logDestroy(&processLogger);
 }
 
 void ch8_logCritical(const char* fmt, ...)
@@ -26,7 +202,7 @@ void ch8_logCritical(const char* fmt, ...)
     INIT_CHECK;
     va_list va;
     va_start(va, fmt);
-    SDL_LogMessageV(LOG_CATEGORY, SDL_LOG_PRIORITY_CRITICAL, fmt, va);
+    enqueue(SDL_LOG_PRIORITY_CRITICAL, fmt, va);
     va_end(va);
 }
 
@@ -35,7 +211,7 @@ void ch8_logError(const char* fmt, ...)
     INIT_CHECK;
     va_list va;
     va_start(va, fmt);
-    SDL_LogMessageV(LOG_CATEGORY, SDL_LOG_PRIORITY_ERROR, fmt, va);
+    enqueue(SDL_LOG_PRIORITY_ERROR, fmt, va);
     va_end(va);
 }
 
@@ -44,7 +220,7 @@ void ch8_logWarning(const char* fmt, ...)
     INIT_CHECK;
     va_list va;
     va_start(va, fmt);
-    SDL_LogMessageV(LOG_CATEGORY, SDL_LOG_PRIORITY_WARN, fmt, va);
+    enqueue(SDL_LOG_PRIORITY_WARN, fmt, va);
     va_end(va);
 }
 
@@ -53,7 +229,7 @@ void ch8_logInfo(const char* fmt, ...)
     INIT_CHECK;
     va_list va;
     va_start(va, fmt);
-    SDL_LogMessageV(LOG_CATEGORY, SDL_LOG_PRIORITY_INFO, fmt, va);
+    enqueue(SDL_LOG_PRIORITY_INFO, fmt, va);
     va_end(va);
 }
 
@@ -62,6 +238,6 @@ void ch8_logDebug(const char* fmt, ...)
     INIT_CHECK;
     va_list va;
     va_start(va, fmt);
-    SDL_LogMessageV(LOG_CATEGORY, SDL_LOG_PRIORITY_DEBUG, fmt, va);
+    enqueue(SDL_LOG_PRIORITY_DEBUG, fmt, va);
     va_end(va);
 }
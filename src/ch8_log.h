@@ -6,9 +6,21 @@ extern "C"
 {
 #endif
 
+/*
+ * Messages are queued and written by a background thread. ch8_logInit sets
+ * up the process-wide logger; a session can have its own, bound to the
+ * threads it runs on, so its messages carry its name.
+ */
+typedef struct ch8_logger ch8_logger;
+
 int ch8_logInit();
 void ch8_logQuit();
 
+ch8_logger *ch8_logCreate(const char *name);
+void ch8_logDestroy(ch8_logger **logger);
+/* Routes the calling thread's messages to `logger`, or back to the process-wide one when NULL */
+void ch8_logBind(ch8_logger *logger);
+
 void ch8_logCritical(const char *fmt, ...);
 void ch8_logError(const char *fmt, ...);
 void ch8_logWarning(const char *fmt, ...);
@@ -4,7 +4,8 @@
 #include <assert.h>
 #include <string.h>
 
-#include "ch8_log.h"
+#include "ch8_framebuffer.h"
+#include "ch8_quirks.h"
 #include "ch8_util.h"
 
 static inline void next(ch8_cpu* cpu)
@@ -12,15 +13,109 @@ static inline void next(ch8_cpu* cpu)
     cpu->programCounter += CH8_PC_STEP_SIZE;
 }
 
+// Steps over the following instruction, which is four bytes long if it is F000 NNNN
+static inline void skip(ch8_cpu* cpu)
+{
+    u16 following = cpu->programCounter + CH8_PC_STEP_SIZE;
+    bool isLong = cpu->memory[following & CH8_ADDR_MASK] == 0xF0 && cpu->memory[(following + 1) & CH8_ADDR_MASK] == 0x00;
+
+    cpu->programCounter += isLong ? 2 * CH8_PC_STEP_SIZE : CH8_PC_STEP_SIZE;
+}
+
+// Loops over the planes selected by FN01
+#define FOR_EACH_PLANE(cpu, plane)                                   \
+    for (int plane = 0; plane < CH8_NUM_PLANES; plane++)             \
+        if ((cpu)->planeMask & (1 << plane))
+
 // 0x00E0
 void ch8_op_ClearDisplay(ch8_cpu *cpu)
 {
     assert(cpu != NULL);
-    ch8_logDebug("[00E0] - Clear Display");
 
-    for (int i = 0; i < CH8_DISPLAY_SIZE; i++) {
-        cpu->framebuffer[i] = 0;
+    FOR_EACH_PLANE(cpu, plane) {
+        memset(cpu->framebuffer[plane], 0, sizeof(cpu->framebuffer[plane]));
     }
+    cpu->drawFlag = true;
+
+    next(cpu);
+}
+
+// 0x00CN
+void ch8_op_ScrollDown(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    int n = opcode & 0x000F;
+    int height = ch8_fbHeight(cpu);
+
+    // Whole rows move at once; the lines scrolled in are blank
+    FOR_EACH_PLANE(cpu, plane) {
+        u64(*rows)[CH8_DISPLAY_ROW_WORDS] = cpu->framebuffer[plane];
+        memmove(rows[n], rows[0], (height - n) * sizeof(rows[0]));
+        memset(rows[0], 0, n * sizeof(rows[0]));
+    }
+    cpu->drawFlag = true;
+
+    next(cpu);
+}
+
+// 0x00FB
+void ch8_op_ScrollRight(ch8_cpu *cpu)
+{
+    assert(cpu != NULL);
+
+    int height = ch8_fbHeight(cpu);
+
+    FOR_EACH_PLANE(cpu, plane) {
+        for (int y = 0; y < height; y++) {
+            ch8_fbShiftRight(cpu->framebuffer[plane][y], 4);
+            if (!cpu->hires) {
+                cpu->framebuffer[plane][y][1] = 0;
+            }
+        }
+    }
+    cpu->drawFlag = true;
+
+    next(cpu);
+}
+
+// 0x00FC
+void ch8_op_ScrollLeft(ch8_cpu *cpu)
+{
+    assert(cpu != NULL);
+
+    int height = ch8_fbHeight(cpu);
+
+    FOR_EACH_PLANE(cpu, plane) {
+        for (int y = 0; y < height; y++) {
+            ch8_fbShiftLeft(cpu->framebuffer[plane][y], 4);
+        }
+    }
+    cpu->drawFlag = true;
+
+    next(cpu);
+}
+
+// 0x00FE
+void ch8_op_LowRes(ch8_cpu *cpu)
+{
+    assert(cpu != NULL);
+
+    cpu->hires = false;
+    memset(cpu->framebuffer, 0, sizeof(cpu->framebuffer));
+    cpu->drawFlag = true;
+
+    next(cpu);
+}
+
+// 0x00FF
+void ch8_op_HighRes(ch8_cpu *cpu)
+{
+    assert(cpu != NULL);
+
+    cpu->hires = true;
+    memset(cpu->framebuffer, 0, sizeof(cpu->framebuffer));
+    cpu->drawFlag = true;
 
     next(cpu);
 }
@@ -29,7 +124,11 @@ void ch8_op_ClearDisplay(ch8_cpu *cpu)
 void ch8_op_ReturnFromSub(ch8_cpu* cpu)
 {
     assert(cpu != NULL);
-    ch8_logDebug("[00EE] - Return from sub-routine");
+
+    if (cpu->stackPointer == 0) {
+        cpu->fault = CH8_FAULT_STACK_UNDERFLOW;
+        return;
+    }
 
     // Set program counter to address at top of stack
     cpu->programCounter = cpu->stack[--cpu->stackPointer];
@@ -43,8 +142,6 @@ void ch8_op_JumpTo(ch8_cpu* cpu, u16 opcode)
     assert(cpu != NULL);
     u16 addr = opcode & 0x0FFF;
 
-    ch8_logDebug("[1NNN] - Jump to address %X", addr);
-
     cpu->programCounter = addr;
 }
 
@@ -54,9 +151,11 @@ void ch8_op_CallSub(ch8_cpu *cpu, u16 opcode)
     assert(cpu != NULL);
 
     u16 addr = opcode & 0x0FFF;
-    ch8_logDebug("[2NNN] - Call subroutine at address %X", addr);
 
-    // TODO: check for stack overflow
+    if (cpu->stackPointer >= CH8_STACK_DEPTH) {
+        cpu->fault = CH8_FAULT_STACK_OVERFLOW;
+        return;
+    }
 
     cpu->stack[cpu->stackPointer++] = cpu->programCounter;
     cpu->programCounter = addr;
@@ -69,11 +168,9 @@ void ch8_op_SkipEquals(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 operand = opcode & 0x00FF;
 
-    ch8_logDebug("[3XKK] - IF conditional (V[%d] == %d)", x, operand);
-
     if (cpu->V[x] == operand) {
         // Skip the next instruction
-        next(cpu);
+        skip(cpu);
     }
 
     next(cpu);
@@ -86,10 +183,8 @@ void ch8_op_SkipNotEquals(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 operand = opcode & 0x00FF;
 
-    ch8_logDebug("[4XKK] - IF conditional (V[%d] != %d)", x, operand);
-
     if (cpu->V[x] != operand) {
-        next(cpu);
+        skip(cpu);
     }
 
     next(cpu);
@@ -103,10 +198,8 @@ void ch8_op_SkipVXEqualsVY(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 y = (opcode & 0x00F0) >> 4;
 
-    ch8_logDebug("[5XY0] - IF conditional (V[%d] == V[%d])\n", x, y);
-
     if (cpu->V[x] == cpu->V[y]) {
-        next(cpu);
+        skip(cpu);
     }
 
     next(cpu);
@@ -120,8 +213,6 @@ void ch8_op_Set(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 value = opcode & 0x00FF;
 
-    ch8_logDebug("[6XKK] - SET register V[%d] = %d\n", x, value);
-
     cpu->V[x] = value;
 
     next(cpu);
@@ -135,8 +226,6 @@ void ch8_op_Add(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 operand = opcode & 0x00FF;
 
-    ch8_logDebug("[7XKK] - ADD %d to register V[%d]\n", operand, x);
-
     cpu->V[x] += operand;
 
     next(cpu);
@@ -150,8 +239,6 @@ void ch8_op_Assign(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 y = (opcode & 0x00F0) >> 4;
 
-    ch8_logDebug("[8XY0] - SET V[%d] = V[%d]\n", x, y);
-
     cpu->V[x] = cpu->V[y];
 
     next(cpu);
@@ -160,46 +247,19 @@ void ch8_op_Assign(ch8_cpu *cpu, u16 opcode)
 // 0x8XY1
 void ch8_op_LogicalOr(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 y = (opcode & 0x00F0) >> 4;
-
-    ch8_logDebug("[8XY1] - OR V[%d] = (V[%d] | V[%d])\n", x, x, y);
-
-    cpu->V[x] |= cpu->V[y];
-
-    next(cpu);
+    ch8_op_LogicalOr<CH8_QUIRKS_LEGACY>(cpu, opcode);
 }
 
 // 0x8XY2
 void ch8_op_LogicalAnd(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 y = (opcode & 0x00F0) >> 4;
-
-    ch8_logDebug("[8XY2] - AND V[%d] = (V[%d] & V[%d])\n", x, x, y);
-
-    cpu->V[x] &= cpu->V[y];
-
-    next(cpu);
+    ch8_op_LogicalAnd<CH8_QUIRKS_LEGACY>(cpu, opcode);
 }
 
 // 0x8XY3
 void ch8_op_LogicalXor(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 y = (opcode & 0x00F0) >> 4;
-
-    ch8_logDebug("[8XY3] - XOR V[%d] = (V[%d] ^ V[%d])\n", x, x, y);
-
-    cpu->V[x] ^= cpu->V[y];
-
-    next(cpu);
+    ch8_op_LogicalXor<CH8_QUIRKS_LEGACY>(cpu, opcode);
 }
 
 // 0x8XY4
@@ -220,8 +280,6 @@ void ch8_op_AddAssign(ch8_cpu *cpu, u16 opcode)
 
     cpu->V[x] = (u8)sum;
 
-    ch8_logDebug("[8XY4] - ADD V[%d] += V[%d] : V[0xF] = %d", x, y, cpu->V[0xF]);
-
     next(cpu);
 }
 
@@ -241,25 +299,13 @@ void ch8_op_SubtractAssign(ch8_cpu *cpu, u16 opcode)
 
     cpu->V[x] = cpu->V[x] - cpu->V[y];
 
-    ch8_logDebug("[8XY5] - SUB V[%d] -= V[%d] : V[0xF] = %d", x, y, cpu->V[0xF]);
-
     next(cpu);
 }
 
 // 0x8XY6
 void ch8_op_BitshiftRight(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 y = (opcode & 0x00F0) >> 4;
-
-    cpu->V[0xF] = cpu->V[x] & 0x1;
-    cpu->V[x] = cpu->V[y] >> 1;
-
-    ch8_logDebug("[8XY6] - SHIFTR V[%d] >>= 1", x);
-
-    next(cpu);
+    ch8_op_BitshiftRight<CH8_QUIRKS_LEGACY>(cpu, opcode);
 }
 
 // 0x8XY7
@@ -276,39 +322,64 @@ void ch8_op_SubtractAssignReverse(ch8_cpu *cpu, u16 opcode)
     cpu->V[x] = vy - vx;
     cpu->V[0xF] = vy < vx ? 0x0 : 0x1;
 
-    ch8_logDebug("[8XY7] - SUB V[%d] = V[%d] - V[%d]", x, y, x);
-
     next(cpu);
 }
 
 // 0x8XYE
 void ch8_op_BitshiftLeft(ch8_cpu *cpu, u16 opcode)
+{
+    ch8_op_BitshiftLeft<CH8_QUIRKS_LEGACY>(cpu, opcode);
+}
+
+// 0x9XY0
+void ch8_op_SkipVXNotEqualsVY(ch8_cpu *cpu, u16 opcode)
 {
     assert(cpu != NULL);
 
     u8 x = (opcode & 0x0F00) >> 8;
     u8 y = (opcode & 0x00F0) >> 4;
 
-    cpu->V[0xF] = (cpu->V[x] >> 7) & 0x1;
-    cpu->V[x] = cpu->V[y] << 1;
-
-    ch8_logDebug("[8XYE] - SHIFTL V[%d] <<= 1", x);
+    if (cpu->V[x] != cpu->V[y]) {
+        skip(cpu);
+    }
 
     next(cpu);
 }
 
-// 0x9XY0
-void ch8_op_SkipVXNotEqualsVY(ch8_cpu *cpu, u16 opcode)
+// 0x5XY2
+void ch8_op_StoreRange(ch8_cpu *cpu, u16 opcode)
 {
     assert(cpu != NULL);
 
     u8 x = (opcode & 0x0F00) >> 8;
     u8 y = (opcode & 0x00F0) >> 4;
+    int step = x <= y ? 1 : -1;
 
-    ch8_logDebug("[9XY0] - IF conditional (V[%d] != V[%d])\n", x, y);
+    // VX first, in either direction; I is left unchanged
+    for (int i = 0, r = x; ; i++, r += step) {
+        ch8_writeMemory(cpu, cpu->index + i, cpu->V[r]);
+        if (r == y) {
+            break;
+        }
+    }
 
-    if (cpu->V[x] != cpu->V[y]) {
-        next(cpu);
+    next(cpu);
+}
+
+// 0x5XY3
+void ch8_op_LoadRange(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+    int step = x <= y ? 1 : -1;
+
+    for (int i = 0, r = x; ; i++, r += step) {
+        cpu->V[r] = cpu->memory[(cpu->index + i) & CH8_ADDR_MASK];
+        if (r == y) {
+            break;
+        }
     }
 
     next(cpu);
@@ -321,8 +392,6 @@ void ch8_op_SetIndex(ch8_cpu *cpu, u16 opcode)
 
     u16 addr = opcode & 0x0FFF;
 
-    ch8_logDebug("[ANNN] - SET I = %d\n", addr);
-
     cpu->index = addr;
 
     next(cpu);
@@ -331,14 +400,7 @@ void ch8_op_SetIndex(ch8_cpu *cpu, u16 opcode)
 // 0xBNNN
 void ch8_op_JumpOffset(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
-
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 addr = opcode & 0x00FF;
-
-    ch8_logDebug("JUMP to %d + V[%d]\n", x, addr);
-
-    cpu->programCounter = addr + cpu->V[x];
+    ch8_op_JumpOffset<CH8_QUIRKS_LEGACY>(cpu, opcode);
 }
 
 // 0xCNNN
@@ -348,9 +410,7 @@ void ch8_op_BitwiseRandom(ch8_cpu *cpu, u16 opcode)
     u8 x = (opcode & 0x0F00) >> 8;
     u8 nn = (opcode & 0x00FF);
 
-    ch8_logDebug("RAND V[%d] = rand() & %d\n", x, nn);
-
-    cpu->V[x] = ch8_randU8() & nn;
+    cpu->V[x] = ch8_nextRandom(cpu) & nn;
 
     next(cpu);
 }
@@ -358,81 +418,54 @@ void ch8_op_BitwiseRandom(ch8_cpu *cpu, u16 opcode)
 // 0xDXYN
 void ch8_op_DrawSprite(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
+    ch8_op_DrawSprite<CH8_QUIRKS_LEGACY>(cpu, opcode);
+}
 
-    u8 x = (opcode & 0x0F00) >> 8;
-    u8 y = (opcode & 0x00F0) >> 4;
-    u8 n = opcode & 0x000F;
+// 0xEX9E
+void ch8_op_KeyEquals(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
 
-    int startX = cpu->V[x];
-    int startY = cpu->V[y];
+    u8 key = (opcode & 0x0F00) >> 8;
 
-    if (startX >= CH8_DISPLAY_WIDTH) {
-        startX = startX % CH8_DISPLAY_WIDTH;
-    }
-    if (startY >= CH8_DISPLAY_HEIGHT) {
-        startY = startY % CH8_DISPLAY_HEIGHT;
+    if (cpu->keypad & (1 << key)) {
+        skip(cpu);
     }
 
-    int endX = ch8_min(startX + 8, CH8_DISPLAY_WIDTH);
-    int endY = ch8_min(startY + n, CH8_DISPLAY_HEIGHT);
-
-    cpu->V[0xF] = 0;
-
-    for (int y = startY; y < endY; y++) {
-        u8 spriteByte = cpu->memory[cpu->index + (y - startY)];
-        for (int x = startX; x < endX; x++) {
-            // NOTE: spritePixel and screenPixel are 0 or non-zero
-            // not 0 or 1 !!!
-            int spritePixel = spriteByte & (0x80 >> (x - startX));
-            int screenPixel = ch8_getPixel(cpu, x, y);
-
-            if(spritePixel) {
-                if(screenPixel) {
-                    cpu->V[0xF] = 1;
-                }
-
-                ch8_setPixel(cpu, x, y, screenPixel == 0 ? true : false);
-            }
-        }
-    }
-
-    // Set the flag indicating that the framebuffer should be drawn to the screen
-    cpu->drawFlag = true;
-
-    ch8_logDebug("[DXYN] - Draw X: %d, Y: %d, N: %d", cpu->V[x], cpu->V[y], n);
-
     next(cpu);
 }
 
-// 0xEX9E
-void ch8_op_KeyEquals(ch8_cpu *cpu, u16 opcode)
+// 0xEXA1
+void ch8_op_KeyNotEquals(ch8_cpu *cpu, u16 opcode)
 {
     assert(cpu != NULL);
 
     u8 key = (opcode & 0x0F00) >> 8;
 
-    ch8_logDebug("KEY check if keypad[%d] is down\n", key);
-
-    if (cpu->keypad[key] == true) {
-        next(cpu);
+    if ((cpu->keypad & (1 << key)) == 0) {
+        skip(cpu);
     }
 
     next(cpu);
 }
 
-// 0xEXA1
-void ch8_op_KeyNotEquals(ch8_cpu *cpu, u16 opcode)
+// 0xF000 0xNNNN
+void ch8_op_SetIndexLong(ch8_cpu *cpu)
 {
     assert(cpu != NULL);
 
-    u8 key = (opcode & 0x0F00) >> 8;
+    u16 addr = cpu->programCounter + CH8_PC_STEP_SIZE;
+    cpu->index = cpu->memory[addr & CH8_ADDR_MASK] << 8 | cpu->memory[(addr + 1) & CH8_ADDR_MASK];
 
-    ch8_logDebug("KEY check if keypad[%d] is up\n", key);
+    cpu->programCounter += 2 * CH8_PC_STEP_SIZE;
+}
 
-    if (cpu->keypad[key] == false) {
-        next(cpu);
-    }
+// 0xFN01
+void ch8_op_SelectPlanes(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    cpu->planeMask = ((opcode & 0x0F00) >> 8) & ((1 << CH8_NUM_PLANES) - 1);
 
     next(cpu);
 }
@@ -446,8 +479,6 @@ void ch8_op_ReadDelayTimer(ch8_cpu *cpu, u16 opcode)
 
     cpu->V[x] = cpu->delayTimer;
 
-    ch8_logDebug("TIMER set V[%d] = delay timer val %d", x, cpu->delayTimer);
-
     next(cpu);
 }
 
@@ -456,8 +487,6 @@ void ch8_op_KeyWait(ch8_cpu *cpu, u16 opcode)
 {
     assert(cpu != NULL);
 
-    ch8_logDebug("[FX0A] - Await keypress...");
-
     cpu->waitFlag = true;
     cpu->waitReg = (opcode & 0x0F00) >> 8;
 
@@ -473,8 +502,6 @@ void ch8_op_SetDelayTimer(ch8_cpu *cpu, u16 opcode)
 
     cpu->delayTimer = cpu->V[x];
 
-    ch8_logDebug("TIMER set delay timer to V[%d] (%d)", x, cpu->delayTimer);
-
     next(cpu);
 }
 
@@ -487,8 +514,6 @@ void ch8_op_SetSoundTimer(ch8_cpu *cpu, u16 opcode)
 
     cpu->soundTimer = cpu->V[x];
 
-    ch8_logDebug("SOUND set sound timer to V[%d] (%d)", x, cpu->soundTimer);
-
     next(cpu);
 }
 
@@ -501,8 +526,6 @@ void ch8_op_AddToIndex(ch8_cpu *cpu, u16 opcode)
 
     cpu->index += cpu->V[x];
 
-    ch8_logDebug("[FX1E] - ADD I += V[%d]", x);
-
     next(cpu);
 }
 
@@ -515,7 +538,17 @@ void ch8_op_SetFontChar(ch8_cpu *cpu, u16 opcode)
 
     cpu->index = cpu->V[x] * 5;
 
-    ch8_logDebug("[FX29] - SET I = V[%d] * 5 (sprite_addr)", x);
+    next(cpu);
+}
+
+// 0xFX30
+void ch8_op_SetBigFontChar(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+
+    cpu->index = CH8_BIG_FONT_OFFSET + (cpu->V[x] & 0xF) * 10;
 
     next(cpu);
 }
@@ -527,11 +560,9 @@ void ch8_op_StoreBinaryCodedDecimal(ch8_cpu *cpu, u16 opcode)
 
     u8 x = (opcode & 0x0F00) >> 8;
 
-    cpu->memory[cpu->index] = (u8)cpu->V[x] / 100;
-    cpu->memory[cpu->index + 1] = (u8)(cpu->V[x] % 100) / 10;
-    cpu->memory[cpu->index + 2] = (u8)cpu->V[x] % 10;
-
-    ch8_logDebug("[FX33] - BCD store V[%d] (%d)", x, cpu->V[x]);
+    ch8_writeMemory(cpu, cpu->index, (u8)cpu->V[x] / 100);
+    ch8_writeMemory(cpu, cpu->index + 1, (u8)(cpu->V[x] % 100) / 10);
+    ch8_writeMemory(cpu, cpu->index + 2, (u8)cpu->V[x] % 10);
 
     next(cpu);
 }
@@ -539,35 +570,35 @@ void ch8_op_StoreBinaryCodedDecimal(ch8_cpu *cpu, u16 opcode)
 // 0xFX55
 void ch8_op_Store(ch8_cpu *cpu, u16 opcode)
 {
-    assert(cpu != NULL);
+    ch8_op_Store<CH8_QUIRKS_LEGACY>(cpu, opcode);
+}
 
-    u8 x = (opcode & 0x0F00) >> 8;
+// 0xFX65
+void ch8_op_Load(ch8_cpu *cpu, u16 opcode)
+{
+    ch8_op_Load<CH8_QUIRKS_LEGACY>(cpu, opcode);
+}
 
-    for (int i = 0; i <= x; i++) {
-        cpu->memory[cpu->index + i] = cpu->V[i];
-    }
+// 0xFX75
+void ch8_op_StoreFlags(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
 
-    //cpu->index += x + 1;
+    u8 x = (opcode & 0x0F00) >> 8;
 
-    ch8_logDebug("[FX55] - STORE V[0]..V[%d] in memory", x);
+    memcpy(cpu->flags, cpu->V, x + 1);
 
     next(cpu);
 }
 
-// 0xFX65
-void ch8_op_Load(ch8_cpu *cpu, u16 opcode)
+// 0xFX85
+void ch8_op_LoadFlags(ch8_cpu *cpu, u16 opcode)
 {
     assert(cpu != NULL);
 
     u8 x = (opcode & 0x0F00) >> 8;
 
-    for (int i = 0; i <= x; i++) {
-        cpu->V[i] = cpu->memory[cpu->index + i];
-    }
-
-    //cpu->index += x + 1;
-
-    ch8_logDebug("[FX55] - FILL memory bytes into V[0]..V[%d]", x);
+    memcpy(cpu->V, cpu->flags, x + 1);
 
     next(cpu);
 }
@@ -12,6 +12,18 @@ void ch8_op_ReturnFromSub(ch8_cpu *cpu);
 void ch8_op_JumpTo(ch8_cpu *cpu, u16 opcode);
 void ch8_op_ClearDisplay(ch8_cpu *cpu);
 
+// SCHIP display control
+// 00CN
+void ch8_op_ScrollDown(ch8_cpu *cpu, u16 opcode);
+// 00FB
+void ch8_op_ScrollRight(ch8_cpu *cpu);
+// 00FC
+void ch8_op_ScrollLeft(ch8_cpu *cpu);
+// 00FE
+void ch8_op_LowRes(ch8_cpu *cpu);
+// 00FF
+void ch8_op_HighRes(ch8_cpu *cpu);
+
 void ch8_op_CallSub(ch8_cpu *cpu, u16 opcode);
 
 void ch8_op_SkipEquals(ch8_cpu *cpu, u16 opcode);
@@ -19,6 +31,16 @@ void ch8_op_SkipNotEquals(ch8_cpu *cpu, u16 opcode);
 void ch8_op_SkipVXEqualsVY(ch8_cpu *cpu, u16 opcode);
 void ch8_op_SkipVXNotEqualsVY(ch8_cpu *cpu, u16 opcode);
 
+// XO-CHIP
+// 5XY2
+void ch8_op_StoreRange(ch8_cpu *cpu, u16 opcode);
+// 5XY3
+void ch8_op_LoadRange(ch8_cpu *cpu, u16 opcode);
+// F000 NNNN
+void ch8_op_SetIndexLong(ch8_cpu *cpu);
+// FN01
+void ch8_op_SelectPlanes(ch8_cpu *cpu, u16 opcode);
+
 void ch8_op_Set(ch8_cpu *cpu, u16 opcode);
 void ch8_op_Add(ch8_cpu *cpu, u16 opcode);
 
@@ -52,12 +74,18 @@ void ch8_op_SetSoundTimer(ch8_cpu *cpu, u16 opcode);
 void ch8_op_AddToIndex(ch8_cpu *cpu, u16 opcode);
 // FX29
 void ch8_op_SetFontChar(ch8_cpu *cpu, u16 opcode);
+// FX30
+void ch8_op_SetBigFontChar(ch8_cpu *cpu, u16 opcode);
 // FX33
 void ch8_op_StoreBinaryCodedDecimal(ch8_cpu *cpu, u16 opcode);
 // FX55
 void ch8_op_Store(ch8_cpu *cpu, u16 opcode);
 // FX65
 void ch8_op_Load(ch8_cpu *cpu, u16 opcode);
+// FX75
+void ch8_op_StoreFlags(ch8_cpu *cpu, u16 opcode);
+// FX85
+void ch8_op_LoadFlags(ch8_cpu *cpu, u16 opcode);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,214 @@
+#ifndef __QUIRKS_H__
+#define __QUIRKS_H__
+
+/*
+ * Opcode handlers whose behavior depends on the variant being emulated.
+ * `Quirks` is a set of ch8_quirk flags known at compile time, so each
+ * profile gets its own branch-free instantiation (see ch8_setQuirks).
+ * Flags outside CH8_QUIRKS_SPECIALIZED are read from the VM instead.
+ */
+
+#include <assert.h>
+
+#include "ch8_cpu.h"
+#include "ch8_framebuffer.h"
+#include "ch8_util.h"
+
+// 0x8XY1
+template <u32 Quirks>
+inline void ch8_op_LogicalOr(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+
+    cpu->V[x] |= cpu->V[y];
+    if constexpr ((Quirks & CH8_QUIRK_VF_RESET) != 0) {
+        cpu->V[0xF] = 0;
+    }
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0x8XY2
+template <u32 Quirks>
+inline void ch8_op_LogicalAnd(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+
+    cpu->V[x] &= cpu->V[y];
+    if constexpr ((Quirks & CH8_QUIRK_VF_RESET) != 0) {
+        cpu->V[0xF] = 0;
+    }
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0x8XY3
+template <u32 Quirks>
+inline void ch8_op_LogicalXor(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+
+    cpu->V[x] ^= cpu->V[y];
+    if constexpr ((Quirks & CH8_QUIRK_VF_RESET) != 0) {
+        cpu->V[0xF] = 0;
+    }
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0x8XY6
+template <u32 Quirks>
+inline void ch8_op_BitshiftRight(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+
+    // VF is written last so that 8FY6 keeps the shifted-out bit
+    u8 source = (Quirks & CH8_QUIRK_SHIFT_VX) ? cpu->V[x] : cpu->V[y];
+    cpu->V[x] = source >> 1;
+    cpu->V[0xF] = source & 0x1;
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0x8XYE
+template <u32 Quirks>
+inline void ch8_op_BitshiftLeft(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+
+    u8 source = (Quirks & CH8_QUIRK_SHIFT_VX) ? cpu->V[x] : cpu->V[y];
+    cpu->V[x] = source << 1;
+    cpu->V[0xF] = (source >> 7) & 0x1;
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0xBNNN / 0xBXNN
+template <u32 Quirks>
+inline void ch8_op_JumpOffset(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u16 addr = opcode & 0x0FFF;
+
+    cpu->programCounter = addr + cpu->V[(Quirks & CH8_QUIRK_JUMP_VX) ? x : 0];
+}
+
+// 0xDXYN
+template <u32 Quirks>
+inline void ch8_op_DrawSprite(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+    u8 y = (opcode & 0x00F0) >> 4;
+    u8 n = opcode & 0x000F;
+
+    constexpr bool wrap = (Quirks & CH8_QUIRK_SPRITE_WRAP) != 0;
+    int width = ch8_fbWidth(cpu);
+    int height = ch8_fbHeight(cpu);
+
+    // DXY0 draws a 16x16 sprite (two bytes per row) in high resolution; in low resolution it
+    // draws nothing, an 8x16 sprite or a 16x16 one depending on the variant
+    bool large = n == 0 && (cpu->hires || (cpu->quirks & CH8_QUIRK_LORES_BIG) != 0);
+    bool tall = n == 0 && (cpu->quirks & CH8_QUIRK_LORES_TALL) != 0;
+    int spriteWidth = large ? 16 : 8;
+    int spriteRows = large || tall ? 16 : n;
+    int bytesPerRow = large ? 2 : 1;
+
+    // The starting position always wraps; rows and pixels past the edge wrap or get clipped
+    int startX = cpu->V[x] % width;
+    int startY = cpu->V[y] % height;
+    int rows = wrap ? spriteRows : ch8_min(spriteRows, height - startY);
+
+    cpu->V[0xF] = 0;
+
+    // Each selected plane takes the next sprite's worth of bytes at I
+    u16 address = cpu->index;
+    for (int plane = 0; plane < CH8_NUM_PLANES; plane++) {
+        if ((cpu->planeMask & (1 << plane)) == 0) {
+            continue;
+        }
+
+        for (int row = 0; row < rows; row++) {
+            u16 at = address + row * bytesPerRow;
+            u32 bits = cpu->memory[at & CH8_ADDR_MASK];
+            if (large) {
+                bits = bits << 8 | cpu->memory[(at + 1) & CH8_ADDR_MASK];
+            }
+
+            u64 sprite[CH8_DISPLAY_ROW_WORDS];
+            ch8_fbSpriteRow(bits, spriteWidth, startX, width, wrap, sprite);
+
+            u64 *line = cpu->framebuffer[plane][(startY + row) % height];
+            if ((line[0] & sprite[0]) | (line[1] & sprite[1])) {
+                cpu->V[0xF] = 1;
+            }
+            line[0] ^= sprite[0];
+            line[1] ^= sprite[1];
+        }
+
+        address += spriteRows * bytesPerRow;
+    }
+
+    // Set the flag indicating that the framebuffer should be drawn to the screen
+    cpu->drawFlag = true;
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0xFX55
+template <u32 Quirks>
+inline void ch8_op_Store(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+
+    for (int i = 0; i <= x; i++) {
+        ch8_writeMemory(cpu, cpu->index + i, cpu->V[i]);
+    }
+
+    if constexpr ((Quirks & CH8_QUIRK_INCREMENT_I) != 0) {
+        cpu->index += x + 1;
+    }
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+// 0xFX65
+template <u32 Quirks>
+inline void ch8_op_Load(ch8_cpu *cpu, u16 opcode)
+{
+    assert(cpu != NULL);
+
+    u8 x = (opcode & 0x0F00) >> 8;
+
+    for (int i = 0; i <= x; i++) {
+        cpu->V[i] = cpu->memory[(cpu->index + i) & CH8_ADDR_MASK];
+    }
+
+    if constexpr ((Quirks & CH8_QUIRK_INCREMENT_I) != 0) {
+        cpu->index += x + 1;
+    }
+
+    cpu->programCounter += CH8_PC_STEP_SIZE;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "ch8_recomp.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "ch8_trace.h"
+#include "ch8_util.h"
+
+// Pages of the program whose code still matches the ROM, one bit each
+typedef struct codePages
+{
+    u64 valid[CH8_NUM_PAGES / 64];
+} codePages;
+
+static void checkPage(const ch8_recompProgram *program, const ch8_cpu *cpu, codePages *pages, u32 page)
+{
+    u32 start = CH8_PROGRAM_START_OFFSET;
+    u32 end = start + program->size;
+    u32 from = ch8_max(page << CH8_PAGE_SHIFT, start);
+    u32 to = ch8_min((page + 1) << CH8_PAGE_SHIFT, end);
+    if (from >= to) {
+        return;
+    }
+
+    u64 bit = 1ull << (page % 64);
+    if (memcmp(cpu->memory + from, program->rom + (from - start), to - from) == 0) {
+        pages->valid[page / 64] |= bit;
+    } else {
+        pages->valid[page / 64] &= ~bit;
+    }
+}
+
+static void checkCode(const ch8_recompProgram *program, const ch8_cpu *cpu, codePages *pages)
+{
+    memset(pages->valid, 0, sizeof(pages->valid));
+
+    u32 end = CH8_PROGRAM_START_OFFSET + program->size;
+    for (u32 page = CH8_PROGRAM_START_OFFSET >> CH8_PAGE_SHIFT; page << CH8_PAGE_SHIFT < end; page++) {
+        checkPage(program, cpu, pages, page);
+    }
+}
+
+// Re-checks the pages written since the last call and moves their dirty bits to `written`
+static void checkWritten(const ch8_recompProgram *program, ch8_cpu *cpu, codePages *pages, u64 *written)
+{
+    for (int w = 0; w < CH8_NUM_PAGES / 64; w++) {
+        u64 dirty = cpu->dirty[w];
+        written[w] |= dirty;
+        cpu->dirty[w] = 0;
+        while (dirty != 0) {
+            checkPage(program, cpu, pages, w * 64 + ch8_lowestSetBit(dirty));
+            dirty &= dirty - 1;
+        }
+    }
+}
+
+static bool isValid(const codePages *pages, u32 start, u32 end)
+{
+    for (u32 page = start >> CH8_PAGE_SHIFT; page <= (end - 1) >> CH8_PAGE_SHIFT; page++) {
+        if ((pages->valid[page / 64] & (1ull << (page % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool storesMemory(u16 opcode)
+{
+    return (opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055 || (opcode & 0xF00F) == 0x5002;
+}
+
+u32 ch8_recompRun(const ch8_recompProgram *program, ch8_cpu *cpu, u32 budget)
+{
+    assert(program != NULL);
+    assert(cpu != NULL);
+
+    u32 n = 0;
+
+    // Blocks bake in the quirks and skip the per-instruction trace hook
+    if (cpu->quirks != program->quirks || ch8_traceIsActive()) {
+        while (n < budget && !cpu->waitFlag && ch8_clockCycle(cpu, 0.0f)) {
+            n++;
+        }
+        return n;
+    }
+
+    // Anything may have changed the code since the last run; after that only this run's stores can
+    codePages pages;
+    checkCode(program, cpu, &pages);
+
+    // Borrow the dirty bits so each store shows just its own pages; the caller's set is restored below
+    u64 written[CH8_NUM_PAGES / 64];
+    memcpy(written, cpu->dirty, sizeof(written));
+    ch8_markClean(cpu);
+
+    while (n < budget && !cpu->waitFlag && cpu->fault == CH8_FAULT_NONE) {
+        const ch8_recompBlock *block = program->lookup(cpu->programCounter);
+
+        if (block != NULL && block->length <= budget - n && isValid(&pages, block->start, block->end)) {
+            u32 ran = block->run(cpu);
+            n += ran;
+            if (ran < block->length) {
+                break;
+            }
+            if (block->stores) {
+                checkWritten(program, cpu, &pages, written);
+            }
+            continue;
+        }
+
+        u16 opcode = ch8_nextOpcode(cpu);
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            break;
+        }
+        n++;
+        if (storesMemory(opcode)) {
+            checkWritten(program, cpu, &pages, written);
+        }
+    }
+
+    for (int w = 0; w < CH8_NUM_PAGES / 64; w++) {
+        cpu->dirty[w] |= written[w];
+    }
+
+    return n;
+}
@@ -0,0 +1,47 @@
+#ifndef __RECOMP_H__
+#define __RECOMP_H__
+
+/*
+ * Runtime for ROMs translated ahead of time by tools/ch8_recomp. The tool
+ * turns every basic block it can reach into a C++ function; ch8_recompRun
+ * dispatches between them and runs ch8_clockCycle wherever no block
+ * applies: computed jumps into code the tool never saw, code that no longer
+ * matches the ROM it was compiled from, a budget ending mid-block, a VM
+ * with other quirks, or an active trace.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Runs the whole block and returns the instructions executed, fewer if one faulted */
+typedef u32 (*ch8_recompBlockFn)(ch8_cpu *cpu);
+
+typedef struct ch8_recompBlock
+{
+    u16 start;
+    u32 end;     /* first address past the block's code, up to CH8_MEM_SIZE */
+    u32 length;  /* instructions */
+    bool stores; /* ends with a memory write, which may have changed code */
+    ch8_recompBlockFn run;
+} ch8_recompBlock;
+
+typedef struct ch8_recompProgram
+{
+    const u8 *rom; /* bytes the blocks were compiled from, loaded at CH8_PROGRAM_START_OFFSET */
+    u32 size;
+    u32 quirks;
+    const ch8_recompBlock *(*lookup)(u16 pc); /* NULL where no block starts */
+} ch8_recompProgram;
+
+/* Same contract as ch8_backendRun */
+u32 ch8_recompRun(const ch8_recompProgram *program, ch8_cpu *cpu, u32 budget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,309 @@
+#include "ch8_record.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ch8_log.h"
+
+#define RECORD_MAGIC 0x52384843u // "CH8R"
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 16
+
+// A second of frames; the writer wakes up far more often than that
+#define RECORD_RING_SLOTS 64
+#define RECORD_POLL_MS 10
+
+// Worst case payload: every byte changed, one token per 128 of them
+#define RECORD_MAX_PAYLOAD (CH8_RECORD_FRAME_BYTES + CH8_RECORD_FRAME_BYTES / 128)
+
+struct ch8_recorder
+{
+    FILE *file;
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+
+    // Single-producer ring between the frame loop and the writer
+    ch8_recordFrame ring[RECORD_RING_SLOTS];
+    std::atomic<u64> head{0};
+    std::atomic<u64> tail{0};
+    u64 dropped = 0;
+
+    // Writer state
+    u8 previous[CH8_RECORD_FRAME_BYTES];
+    u64 frames = 0;
+};
+
+struct ch8_recording
+{
+    FILE *file;
+    u8 current[CH8_RECORD_FRAME_BYTES];
+};
+
+static void put16(u8 *out, u16 value)
+{
+    out[0] = (u8)value;
+    out[1] = (u8)(value >> 8);
+}
+
+static void put32(u8 *out, u32 value)
+{
+    put16(out, (u16)value);
+    put16(out + 2, (u16)(value >> 16));
+}
+
+static u16 get16(const u8 *in)
+{
+    return (u16)(in[0] | in[1] << 8);
+}
+
+static u32 get32(const u8 *in)
+{
+    return get16(in) | (u32)get16(in + 2) << 16;
+}
+
+static void serialize(const ch8_recordFrame *frame, u8 out[CH8_RECORD_FRAME_BYTES])
+{
+    const u64 *words = &frame->framebuffer[0][0][0];
+    for (int w = 0; w < CH8_RECORD_FRAME_BYTES / 8; w++) {
+        for (int b = 0; b < 8; b++) {
+            out[w * 8 + b] = (u8)(words[w] >> (56 - b * 8));
+        }
+    }
+}
+
+static void deserialize(const u8 in[CH8_RECORD_FRAME_BYTES], ch8_recordFrame *frame)
+{
+    u64 *words = &frame->framebuffer[0][0][0];
+    for (int w = 0; w < CH8_RECORD_FRAME_BYTES / 8; w++) {
+        u64 word = 0;
+        for (int b = 0; b < 8; b++) {
+            word = word << 8 | in[w * 8 + b];
+        }
+        words[w] = word;
+    }
+}
+
+// Run-length encodes next ^ previous; returns the payload size
+static size_t encodeDelta(const u8 *previous, const u8 *next, u8 *out)
+{
+    size_t size = 0;
+    int i = 0;
+
+    while (i < CH8_RECORD_FRAME_BYTES) {
+        int run = 0;
+        while (i + run < CH8_RECORD_FRAME_BYTES && run < 128 && previous[i + run] == next[i + run]) {
+            run++;
+        }
+        if (run > 0) {
+            out[size++] = (u8)(run - 1);
+            i += run;
+            continue;
+        }
+
+        // Literals end at the next pair of unchanged bytes; a single one is cheaper to keep inline
+        int count = 0;
+        while (i + count < CH8_RECORD_FRAME_BYTES && count < 128) {
+            int at = i + count;
+            if (previous[at] == next[at] && at + 1 < CH8_RECORD_FRAME_BYTES && previous[at + 1] == next[at + 1]) {
+                break;
+            }
+            count++;
+        }
+        out[size++] = (u8)(0x7F + count);
+        for (int n = 0; n < count; n++) {
+            out[size++] = previous[i + n] ^ next[i + n];
+        }
+        i += count;
+    }
+
+    return size;
+}
+
+static void writeFrame(ch8_recorder *recorder, const ch8_recordFrame *frame)
+{
+    u8 next[CH8_RECORD_FRAME_BYTES];
+    u8 record[3 + RECORD_MAX_PAYLOAD];
+
+    serialize(frame, next);
+    size_t size = encodeDelta(recorder->previous, next, record + 3);
+    record[0] = frame->flags;
+    put16(record + 1, (u16)size);
+
+    fwrite(record, 1, 3 + size, recorder->file);
+    memcpy(recorder->previous, next, sizeof(next));
+    recorder->frames++;
+}
+
+static void writerLoop(ch8_recorder *recorder)
+{
+    for (;;) {
+        // Read the flag first so frames queued before stopping are still written
+        bool stopping = recorder->stopping.load(std::memory_order_acquire);
+
+        u64 tail = recorder->tail.load(std::memory_order_relaxed);
+        u64 head = recorder->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            writeFrame(recorder, &recorder->ring[tail % RECORD_RING_SLOTS]);
+            recorder->tail.store(tail + 1, std::memory_order_release);
+        }
+
+        if (stopping) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(RECORD_POLL_MS));
+    }
+}
+
+ch8_recorder *ch8_recorderCreate(const char *path)
+{
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        ch8_logError("Could not create recording %s", path);
+        return NULL;
+    }
+
+    u8 header[RECORD_HEADER_SIZE] = {0};
+    put32(header, RECORD_MAGIC);
+    put16(header + 4, RECORD_VERSION);
+    put16(header + 6, CH8_RECORD_FRAME_RATE);
+    put32(header + 8, CH8_RECORD_FRAME_BYTES);
+    fwrite(header, 1, sizeof(header), file);
+
+    // Blank screen: the first frame is a delta like any other
+    ch8_recorder *recorder = new ch8_recorder();
+    recorder->file = file;
+    memset(recorder->previous, 0, sizeof(recorder->previous));
+    recorder->writer = std::thread(writerLoop, recorder);
+
+    ch8_logInfo("Recording to %s", path);
+
+    return recorder;
+}
+
+void ch8_recorderDestroy(ch8_recorder **recorder)
+{
+    assert(recorder != NULL);
+
+    ch8_recorder *r = *recorder;
+    if (r == NULL) {
+        return;
+    }
+
+    r->stopping.store(true, std::memory_order_release);
+    r->writer.join();
+
+    if (r->dropped > 0) {
+        ch8_logWarning("Recording dropped %llu frames", (unsigned long long)r->dropped);
+    }
+    ch8_logInfo("Recorded %llu frames", (unsigned long long)r->frames);
+
+    fclose(r->file);
+    delete r;
+    *recorder = NULL;
+}
+
+void ch8_recorderCapture(ch8_recorder *recorder, const ch8_cpu *cpu)
+{
+    assert(recorder != NULL);
+    assert(cpu != NULL);
+
+    u64 head = recorder->head.load(std::memory_order_relaxed);
+    if (head - recorder->tail.load(std::memory_order_acquire) == RECORD_RING_SLOTS) {
+        recorder->dropped++;
+        return;
+    }
+
+    ch8_recordFrame &frame = recorder->ring[head % RECORD_RING_SLOTS];
+    frame.flags = (cpu->hires ? CH8_RECORD_HIRES : 0) | (cpu->soundTimer > 0 ? CH8_RECORD_SOUND : 0);
+    memcpy(frame.framebuffer, cpu->framebuffer, sizeof(frame.framebuffer));
+
+    recorder->head.store(head + 1, std::memory_order_release);
+}
+
+ch8_recording *ch8_recordingOpen(const char *path)
+{
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ch8_logError("Could not open recording %s", path);
+        return NULL;
+    }
+
+    u8 header[RECORD_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || get32(header) != RECORD_MAGIC
+        || get16(header + 4) != RECORD_VERSION || get32(header + 8) != CH8_RECORD_FRAME_BYTES) {
+        ch8_logError("%s is not a recording", path);
+        fclose(file);
+        return NULL;
+    }
+
+    ch8_recording *recording = (ch8_recording *)calloc(1, sizeof(ch8_recording));
+    if (recording == NULL) {
+        fclose(file);
+        return NULL;
+    }
+    recording->file = file;
+
+    return recording;
+}
+
+void ch8_recordingClose(ch8_recording **recording)
+{
+    assert(recording != NULL);
+
+    if (*recording != NULL) {
+        fclose((*recording)->file);
+        free(*recording);
+        *recording = NULL;
+    }
+}
+
+bool ch8_recordingNext(ch8_recording *recording, ch8_recordFrame *frame)
+{
+    assert(recording != NULL);
+    assert(frame != NULL);
+
+    u8 record[3];
+    u8 payload[RECORD_MAX_PAYLOAD];
+    if (fread(record, 1, sizeof(record), recording->file) != sizeof(record)) {
+        return false;
+    }
+
+    size_t size = get16(record + 1);
+    if (size > sizeof(payload) || fread(payload, 1, size, recording->file) != size) {
+        return false;
+    }
+
+    size_t at = 0;
+    int i = 0;
+    while (at < size) {
+        u8 token = payload[at++];
+        if (token < 0x80) {
+            i += token + 1;
+            continue;
+        }
+
+        int count = token - 0x7F;
+        if (at + count > size || i + count > CH8_RECORD_FRAME_BYTES) {
+            return false;
+        }
+        for (int n = 0; n < count; n++) {
+            recording->current[i++] ^= payload[at++];
+        }
+    }
+    if (i != CH8_RECORD_FRAME_BYTES) {
+        return false;
+    }
+
+    frame->flags = record[0];
+    deserialize(recording->current, frame);
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+/*
+ * Gameplay recordings. The recorder copies each frame's framebuffer into a
+ * ring and returns; a background thread XORs it against the previous frame,
+ * run-length encodes the difference and writes it out, so capturing costs
+ * the frame loop one small copy. Recordings are read back frame by frame
+ * with ch8_recordingOpen, e.g. by tools/ch8_recexport.
+ *
+ * File layout, little-endian: a 16 byte header (magic "CH8R", u16 version,
+ * u16 frame rate, u32 frame size, u32 reserved), then per frame a u8 of
+ * CH8_RECORD_* flags, a u16 payload size and the payload. Frames are
+ * serialized as words of 8 big-endian bytes in framebuffer order. In the
+ * payload, a token byte t < 0x80 stands for t + 1 unchanged bytes, and
+ * t >= 0x80 is followed by t - 0x7F bytes to XOR into the previous frame.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_RECORD_FRAME_RATE 60
+#define CH8_RECORD_FRAME_BYTES (CH8_NUM_PLANES * CH8_DISPLAY_HIRES_HEIGHT * CH8_DISPLAY_ROW_WORDS * 8)
+
+#define CH8_RECORD_HIRES (1 << 0)
+#define CH8_RECORD_SOUND (1 << 1)
+
+typedef struct ch8_recordFrame
+{
+    u8 flags;
+    u64 framebuffer[CH8_NUM_PLANES][CH8_DISPLAY_HIRES_HEIGHT][CH8_DISPLAY_ROW_WORDS];
+} ch8_recordFrame;
+
+typedef struct ch8_recorder ch8_recorder;
+typedef struct ch8_recording ch8_recording;
+
+/* Starts recording to `path`; returns NULL if the file can't be created */
+ch8_recorder *ch8_recorderCreate(const char *path);
+/* Writes out every captured frame and closes the file */
+void ch8_recorderDestroy(ch8_recorder **recorder);
+/* Queues the current frame; never blocks, frames are dropped if the writer falls a second behind */
+void ch8_recorderCapture(ch8_recorder *recorder, const ch8_cpu *cpu);
+
+/* Returns NULL if `path` isn't a recording */
+ch8_recording *ch8_recordingOpen(const char *path);
+void ch8_recordingClose(ch8_recording **recording);
+/* Decodes the next frame; false at the end or if the file is damaged */
+bool ch8_recordingNext(ch8_recording *recording, ch8_recordFrame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,385 @@
+#include "ch8_scheduler.h"
+
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+typedef enum sessionState
+{
+    SESSION_FREE,
+    SESSION_READY,      // queued for its next deadline
+    SESSION_RUNNING,    // a worker is running its frame
+    SESSION_KEY_WAIT,   // parked on FX0A until its keys change
+    SESSION_TIMER_WAIT, // queued, but skipping the frames it would spend waiting on the delay timer
+    SESSION_IDLE,       // parked for good: halted or jumping to itself
+} sessionState;
+
+typedef struct schedSession
+{
+    ch8_cpu *cpu;
+    u32 cyclesPerFrame;
+    ch8_schedFrameFn onFrame;
+    void *user;
+
+    sessionState state;
+    bool removed;    // removal requested while running
+    u32 generation;  // bumped on removal so stale queue entries are skipped
+    u64 deadline;
+    u64 parkedAt;
+
+    u16 keys;        // latest from ch8_schedSetKeys
+    u16 appliedKeys; // what the VM saw last frame, to detect new presses
+} schedSession;
+
+typedef struct schedEntry
+{
+    u64 deadline;
+    int id;
+    u32 generation;
+
+    bool operator>(const schedEntry &other) const
+    {
+        return deadline > other.deadline;
+    }
+} schedEntry;
+
+struct ch8_scheduler
+{
+    std::mutex lock;
+    std::condition_variable wake;    // the earliest deadline may have changed
+    std::condition_variable stopped; // a session finished its frame
+    std::priority_queue<schedEntry, std::vector<schedEntry>, std::greater<schedEntry>> queue;
+
+    std::vector<schedSession> sessions;
+    std::vector<int> freeIds;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    u64 frames = 0;
+    u64 lateFrames = 0;
+};
+
+static u64 nowNs()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void enqueue(ch8_scheduler *sched, int id)
+{
+    schedSession &s = sched->sessions[id];
+    s.state = SESSION_READY;
+    sched->queue.push({s.deadline, id, s.generation});
+    sched->wake.notify_one();
+}
+
+// Keys are the VM's keypad; a key pressed since the last frame also ends an FX0A wait
+static void applyKeys(ch8_cpu *cpu, u16 keys, u16 previous)
+{
+    cpu->keypad = keys;
+
+    u16 pressed = keys & ~previous;
+    if (cpu->waitFlag && pressed != 0) {
+        int key = 0;
+        while (((pressed >> key) & 1) == 0) {
+            key++;
+        }
+        cpu->V[cpu->waitReg] = (u8)key;
+        cpu->waitFlag = false;
+    }
+}
+
+static bool jumpsToItself(ch8_cpu *cpu)
+{
+    u16 opcode = ch8_nextOpcode(cpu);
+    return (opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == cpu->programCounter;
+}
+
+static u16 fetch(const ch8_cpu *cpu, u16 addr)
+{
+    return cpu->memory[addr & CH8_ADDR_MASK] << 8 | cpu->memory[(addr + 1) & CH8_ADDR_MASK];
+}
+
+// FX07 3X00 1NNN back to the FX07, stopped anywhere inside; returns X, or -1 if the PC is not in one
+static int timerWaitRegister(const ch8_cpu *cpu)
+{
+    u16 pc = cpu->programCounter;
+    for (u16 back = 0; back <= 2 * CH8_PC_STEP_SIZE; back += CH8_PC_STEP_SIZE) {
+        u16 head = pc - back;
+        u16 read = fetch(cpu, head);
+        u8 x = (read & 0x0F00) >> 8;
+        if ((read & 0xF0FF) != 0xF007 || fetch(cpu, head + CH8_PC_STEP_SIZE) != (0x3000 | x << 8) ||
+            fetch(cpu, head + 2 * CH8_PC_STEP_SIZE) != (0x1000 | (head & 0x0FFF))) {
+            continue;
+        }
+
+        // On the test with 0 already read, it leaves the loop by itself
+        if (back == CH8_PC_STEP_SIZE && cpu->V[x] == 0) {
+            return -1;
+        }
+        return x;
+    }
+    return -1;
+}
+
+// A timer wait changes nothing but its register until the delay timer runs out, one frame per tick.
+// Skips those frames at once and returns how many, leaving the VM as the last of them would.
+static u32 skipTimerWait(ch8_cpu *cpu, u32 cyclesPerFrame)
+{
+    int x = timerWaitRegister(cpu);
+    if (x < 0 || cpu->delayTimer == 0) {
+        return 0;
+    }
+
+    u32 frames = cpu->delayTimer;
+    cpu->V[x] = 1;
+    cpu->delayTimer = 0;
+    cpu->soundTimer = (u8)(cpu->soundTimer > frames ? cpu->soundTimer - frames : 0);
+    cpu->cycles += (u64)frames * cyclesPerFrame;
+    return frames;
+}
+
+// Runs one frame outside the lock; returns the state the session should go to next.
+// `skipped` is set to the number of frames a timer wait let it skip after this one.
+static sessionState runFrame(const schedSession &s, u16 keys, bool *drawn, u32 *skipped)
+{
+    ch8_cpu *cpu = s.cpu;
+    applyKeys(cpu, keys, s.appliedKeys);
+
+    // drawFlag only describes the last instruction, so collect it over the frame
+    bool halted = false;
+    *drawn = false;
+    *skipped = 0;
+    for (u32 n = 0; n < s.cyclesPerFrame && !cpu->waitFlag; n++) {
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            halted = true;
+            break;
+        }
+        *drawn |= cpu->drawFlag;
+    }
+
+    cpu->delayTimer = ch8_max(cpu->delayTimer - 1, 0);
+    cpu->soundTimer = ch8_max(cpu->soundTimer - 1, 0);
+
+    if (cpu->waitFlag) {
+        return SESSION_KEY_WAIT;
+    }
+    if (halted || jumpsToItself(cpu)) {
+        // Nothing can observe the timers any more; settle them where they would end up
+        cpu->delayTimer = 0;
+        cpu->soundTimer = 0;
+        return SESSION_IDLE;
+    }
+
+    *skipped = skipTimerWait(cpu, s.cyclesPerFrame);
+    return *skipped > 0 ? SESSION_TIMER_WAIT : SESSION_READY;
+}
+
+static void workerLoop(ch8_scheduler *sched)
+{
+    std::unique_lock<std::mutex> guard(sched->lock);
+
+    while (!sched->stopping) {
+        if (sched->queue.empty()) {
+            sched->wake.wait(guard);
+            continue;
+        }
+
+        schedEntry top = sched->queue.top();
+        schedSession &queued = sched->sessions[top.id];
+        if (queued.generation != top.generation || (queued.state != SESSION_READY && queued.state != SESSION_TIMER_WAIT)) {
+            sched->queue.pop();
+            continue;
+        }
+
+        u64 now = nowNs();
+        if (top.deadline > now) {
+            sched->wake.wait_until(guard, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(top.deadline)));
+            continue;
+        }
+        sched->queue.pop();
+
+        queued.state = SESSION_RUNNING;
+        schedSession frame = queued;
+        u16 keys = queued.keys;
+        guard.unlock();
+
+        bool drawn;
+        u32 skipped;
+        sessionState next = runFrame(frame, keys, &drawn, &skipped);
+        if (frame.onFrame != NULL) {
+            frame.onFrame(frame.cpu, drawn, frame.user);
+        }
+
+        guard.lock();
+        schedSession &s = sched->sessions[top.id];
+        sched->frames++;
+        if (now > top.deadline + CH8_SCHED_FRAME_NS) {
+            sched->lateFrames++;
+        }
+
+        s.appliedKeys = keys;
+        if (s.removed) {
+            s.state = SESSION_FREE;
+            sched->stopped.notify_all();
+            continue;
+        }
+
+        // Fixed-rate deadlines, but a session that fell far behind skips the missed frames
+        s.deadline = top.deadline + CH8_SCHED_FRAME_NS;
+        if (s.deadline + CH8_SCHED_FRAME_NS < now) {
+            s.deadline = now;
+        }
+        s.deadline += skipped * CH8_SCHED_FRAME_NS;
+
+        if (next == SESSION_READY || next == SESSION_TIMER_WAIT) {
+            enqueue(sched, top.id);
+            s.state = next;
+        } else {
+            s.state = next;
+            s.parkedAt = now;
+        }
+    }
+}
+
+ch8_scheduler *ch8_schedCreate(int workers)
+{
+    assert(workers > 0);
+
+    ch8_scheduler *sched = new ch8_scheduler();
+    for (int i = 0; i < workers; i++) {
+        sched->workers.emplace_back(workerLoop, sched);
+    }
+
+    ch8_logDebug("Scheduler started with %d workers", workers);
+
+    return sched;
+}
+
+void ch8_schedDestroy(ch8_scheduler **sched)
+{
+    assert(sched != NULL);
+
+    ch8_scheduler *s = *sched;
+    if (s == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        s->stopping = true;
+    }
+    s->wake.notify_all();
+    for (std::thread &t : s->workers) {
+        t.join();
+    }
+
+    delete s;
+    *sched = NULL;
+}
+
+int ch8_schedAdd(ch8_scheduler *sched, ch8_cpu *cpu, u32 cyclesPerFrame, ch8_schedFrameFn onFrame, void *user)
+{
+    assert(sched != NULL);
+    assert(cpu != NULL);
+
+    std::lock_guard<std::mutex> guard(sched->lock);
+
+    int id;
+    if (!sched->freeIds.empty()) {
+        id = sched->freeIds.back();
+        sched->freeIds.pop_back();
+    } else {
+        id = (int)sched->sessions.size();
+        sched->sessions.push_back({});
+    }
+
+    schedSession &s = sched->sessions[id];
+    u32 generation = s.generation;
+    s = {};
+    s.cpu = cpu;
+    s.cyclesPerFrame = cyclesPerFrame;
+    s.onFrame = onFrame;
+    s.user = user;
+    s.generation = generation + 1;
+    s.deadline = nowNs();
+    s.keys = cpu->keypad;
+    s.appliedKeys = cpu->keypad;
+
+    enqueue(sched, id);
+
+    return id;
+}
+
+void ch8_schedRemove(ch8_scheduler *sched, int id)
+{
+    assert(sched != NULL);
+
+    std::unique_lock<std::mutex> guard(sched->lock);
+    assert(id >= 0 && id < (int)sched->sessions.size());
+
+    schedSession &s = sched->sessions[id];
+    if (s.state == SESSION_FREE) {
+        return;
+    }
+
+    s.generation++;
+    if (s.state == SESSION_RUNNING) {
+        s.removed = true;
+        sched->stopped.wait(guard, [&] { return sched->sessions[id].state == SESSION_FREE; });
+    }
+
+    sched->sessions[id].state = SESSION_FREE;
+    sched->freeIds.push_back(id);
+}
+
+void ch8_schedSetKeys(ch8_scheduler *sched, int id, u16 keys)
+{
+    assert(sched != NULL);
+
+    std::lock_guard<std::mutex> guard(sched->lock);
+    assert(id >= 0 && id < (int)sched->sessions.size());
+
+    schedSession &s = sched->sessions[id];
+    s.keys = keys;
+
+    if (s.state == SESSION_KEY_WAIT && keys != s.appliedKeys) {
+        // Timers kept running in real time while parked
+        u64 now = nowNs();
+        u64 elapsed = (now - s.parkedAt) / CH8_SCHED_FRAME_NS;
+        s.cpu->delayTimer = (u8)(s.cpu->delayTimer > elapsed ? s.cpu->delayTimer - elapsed : 0);
+        s.cpu->soundTimer = (u8)(s.cpu->soundTimer > elapsed ? s.cpu->soundTimer - elapsed : 0);
+
+        s.deadline = now;
+        enqueue(sched, id);
+    }
+}
+
+void ch8_schedGetStats(ch8_scheduler *sched, ch8_schedStats *stats)
+{
+    assert(sched != NULL);
+    assert(stats != NULL);
+
+    std::lock_guard<std::mutex> guard(sched->lock);
+
+    stats->frames = sched->frames;
+    stats->lateFrames = sched->lateFrames;
+    stats->sessions = 0;
+    stats->parked = 0;
+    for (const schedSession &s : sched->sessions) {
+        if (s.state != SESSION_FREE) {
+            stats->sessions++;
+        }
+        if (s.state == SESSION_KEY_WAIT || s.state == SESSION_TIMER_WAIT || s.state == SESSION_IDLE) {
+            stats->parked++;
+        }
+    }
+}
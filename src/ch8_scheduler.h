@@ -0,0 +1,60 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+/*
+ * Runs many real-time VMs on a small pool of worker threads. Every session
+ * gets a 60hz frame (a cycle budget plus one timer tick) at fixed deadlines,
+ * and workers always take the session whose deadline is earliest. Sessions
+ * that can't make progress - waiting on FX0A, halted, or spinning on a jump
+ * to itself - are parked and cost nothing until their input changes.
+ *
+ * A session busy-waiting on the delay timer (FX07 3X00 1NNN back to the
+ * FX07) is parked too, and resumes at the frame where the timer runs out as
+ * if it had spun until then. Skipped frames are not reported to `onFrame`
+ * or counted in the stats.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_SCHED_FRAME_NS 16666667ull
+
+/* Called on the worker thread after each frame; `drawn` is set if the display changed */
+typedef void (*ch8_schedFrameFn)(ch8_cpu *cpu, bool drawn, void *user);
+
+typedef struct ch8_schedStats
+{
+    u64 frames;     /* frames run across all sessions */
+    u64 lateFrames; /* frames that started more than a frame past their deadline */
+    u32 sessions;
+    u32 parked;     /* sessions currently idle or waiting on the delay timer */
+} ch8_schedStats;
+
+typedef struct ch8_scheduler ch8_scheduler;
+
+ch8_scheduler *ch8_schedCreate(int workers);
+/* Stops the workers; sessions' VMs are left as they are */
+void ch8_schedDestroy(ch8_scheduler **sched);
+
+/*
+ * Starts running `cpu`, which belongs to the scheduler until removed.
+ * Returns the session id, or -1 on failure. `onFrame` may be NULL.
+ */
+int ch8_schedAdd(ch8_scheduler *sched, ch8_cpu *cpu, u32 cyclesPerFrame, ch8_schedFrameFn onFrame, void *user);
+/* Returns once the session is no longer running on any worker */
+void ch8_schedRemove(ch8_scheduler *sched, int id);
+
+/* Sets the keys held for a session (bit k for key k); applied at its next frame */
+void ch8_schedSetKeys(ch8_scheduler *sched, int id, u16 keys);
+
+void ch8_schedGetStats(ch8_scheduler *sched, ch8_schedStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
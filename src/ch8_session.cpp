@@ -0,0 +1,322 @@
+#include "ch8_session.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <SDL.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "ch8_audio.h"
+#include "ch8_debug.h"
+#include "ch8_display.h"
+#include "ch8_keyboard.h"
+#include "ch8_log.h"
+#include "ch8_record.h"
+#include "ch8_stream.h"
+#include "ch8_tier.h"
+#include "ch8_util.h"
+
+struct ch8_session
+{
+    ch8_cpu cpu; // first, so the aligned allocation lines up its hot state
+    ch8_debugger debugger;
+    ch8_debugView *debugView;
+    ch8_tier *tier; // runs the VM whenever the debugger has nothing to watch
+    char tierCache[512]; // saved to on exit; empty without ch8_sessionUseTierCache
+
+    SDL_Window *window;
+    ch8_display *display;
+    ch8_frameTime *frameTime;
+    ch8_audio *audio;
+    ch8_logger *log;
+
+    ch8_stream *stream; // optional, for external readers
+    ch8_recorder *recorder;
+    u64 frames;
+};
+
+ch8_session *ch8_sessionCreate(const char *name, const char *rom, u32 quirks)
+{
+    assert(rom != NULL);
+
+    ch8_session *session = (ch8_session *)aligned_alloc(CH8_CACHE_LINE, sizeof(ch8_session));
+    if (session == NULL) {
+        return NULL;
+    }
+    memset(session, 0, sizeof(ch8_session));
+
+    // Without a name the session logs through the process-wide logger
+    if (name != NULL) {
+        session->log = ch8_logCreate(name);
+        if (session->log == NULL) {
+            ch8_sessionDestroy(&session);
+            return NULL;
+        }
+    }
+    ch8_logBind(session->log);
+
+    // Initialize VM
+    ch8_reset(&session->cpu);
+    ch8_debugInit(&session->debugger);
+    ch8_seedRandom(&session->cpu, (u32)time(NULL));
+
+    if (!ch8_loadRomFile(&session->cpu, rom)) {
+        ch8_logCritical("Could not load ROM %s", rom);
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+    ch8_setQuirks(&session->cpu, quirks);
+
+    session->tier = ch8_tierCreate(NULL);
+    if (session->tier == NULL) {
+        ch8_logCritical("Could not create the execution engine");
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+
+    session->window = SDL_CreateWindow(name != NULL ? name : "CHIP-8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                       640, 320, 0);
+    if (session->window == NULL) {
+        ch8_logCritical("Could not create SDL window: %s", SDL_GetError());
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+
+    session->display = ch8_displayCreate(static_cast<void*>(session->window));
+    if (session->display == NULL) {
+        ch8_logCritical("Failed to initialize the display\n");
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+
+    session->debugView = ch8_debugViewCreate();
+    if (session->debugView == NULL) {
+        ch8_logCritical("Failed to initialize the debugger panel");
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+
+    session->frameTime = ch8_frameTimeCreate();
+    if (session->frameTime == NULL) {
+        ch8_logCritical("Failed to initialize frame timing");
+        ch8_sessionDestroy(&session);
+        return NULL;
+    }
+
+    // Runs silent without a sound device
+    session->audio = ch8_audioCreate();
+    if (session->audio == NULL) {
+        ch8_logCritical("Failed to initialize audio");
+    }
+
+    ch8_logBind(NULL);
+
+    return session;
+}
+
+void ch8_sessionDestroy(ch8_session **session)
+{
+    assert(session != NULL);
+
+    ch8_session *s = *session;
+    if (s == NULL) {
+        return;
+    }
+
+    ch8_logBind(s->log);
+    if (s->tier != NULL) {
+        ch8_tierStats stats;
+        ch8_tierGetStats(s->tier, &stats);
+        ch8_logDebug("Instructions interpreted: %llu, in decoded blocks: %llu, blocks promoted: %u, demoted: %u",
+                     (unsigned long long)stats.instructions[CH8_TIER_INTERPRETER],
+                     (unsigned long long)stats.instructions[CH8_TIER_DECODED], stats.promotions, stats.demotions);
+        if (s->tierCache[0] != '\0') {
+            ch8_tierSave(s->tier, s->tierCache);
+        }
+        ch8_tierDestroy(&s->tier);
+    }
+    ch8_streamClose(&s->stream);
+    ch8_recorderDestroy(&s->recorder);
+    ch8_frameTimeDestroy(&s->frameTime);
+    ch8_debugViewDestroy(&s->debugView);
+    ch8_displayDestroy(&s->display);
+    ch8_audioDestroy(&s->audio);
+    if (s->window != NULL) {
+        SDL_DestroyWindow(s->window);
+    }
+    ch8_logBind(NULL);
+    ch8_logDestroy(&s->log);
+
+    free(s);
+    *session = NULL;
+}
+
+void ch8_sessionHandleEvent(ch8_session *session, const void *event)
+{
+    assert(session != NULL);
+    assert(event != NULL);
+
+    const SDL_Event *e = static_cast<const SDL_Event*>(event);
+    ch8_cpu *cpu = &session->cpu;
+
+    ch8_displayProcessEvent(session->display, event);
+
+    switch (e->type) {
+    case SDL_KEYDOWN: {
+        ch8_key key = __SDLKeycodeToKeyRegister(e->key.keysym.sym);
+        if (key != KEY_UNKNOWN) {
+            ch8_setKeyDown(cpu, key);
+            if (cpu->waitFlag) {
+                cpu->V[cpu->waitReg] = key;
+                cpu->waitFlag = false;
+            }
+        }
+        break;
+    }
+    case SDL_KEYUP: {
+        ch8_key key = __SDLKeycodeToKeyRegister(e->key.keysym.sym);
+        if (key != KEY_UNKNOWN) {
+            ch8_setKeyUp(cpu, key);
+        }
+        break;
+    }
+    }
+}
+
+void ch8_sessionRunFrame(ch8_session *session)
+{
+    assert(session != NULL);
+
+    ch8_cpu *cpu = &session->cpu;
+    ch8_frameTime *ft = session->frameTime;
+    ch8_logBind(session->log);
+
+    if (session->stream != NULL) {
+        ch8_streamPollInput(session->stream, cpu);
+    }
+
+    ch8_frameTimeBegin(ft, CH8_STAGE_EMULATION);
+    u32 budget = ch8_debugViewCycleBudget(session->debugView, 1);
+    ch8_stopReason stop;
+    if (!ch8_debugIsArmed(&session->debugger) && session->debugger.coverage == NULL) {
+        u32 ran = ch8_tierRun(session->tier, cpu, budget);
+        stop = ran == budget ? CH8_STOP_BUDGET : cpu->waitFlag ? CH8_STOP_KEY_WAIT : CH8_STOP_HALT;
+    } else {
+        stop = ch8_runUntil(cpu, &session->debugger, budget);
+    }
+    ch8_debugViewOnStop(session->debugView, stop);
+    bool ran = budget > 0 && stop != CH8_STOP_KEY_WAIT && stop != CH8_STOP_HALT;
+    ch8_frameTimeEnd(ft, CH8_STAGE_EMULATION);
+
+    ch8_frameTimeBegin(ft, CH8_STAGE_TEXTURE_UPLOAD);
+    if (ran && cpu->drawFlag) {
+        ch8_displayWriteFb(session->display, cpu);
+    }
+    ch8_frameTimeEnd(ft, CH8_STAGE_TEXTURE_UPLOAD);
+
+    ch8_frameTimeBegin(ft, CH8_STAGE_IMGUI);
+    ch8_displayBeginFrame(session->display);
+    ch8_frameTimeDrawOverlay(ft);
+    ch8_debugViewDraw(session->debugView, cpu, &session->debugger);
+    ch8_displayEndFrame(session->display);
+    ch8_frameTimeEnd(ft, CH8_STAGE_IMGUI);
+
+    ch8_frameTimeBegin(ft, CH8_STAGE_PRESENT);
+    ch8_displayPresent(session->display);
+    ch8_frameTimeEnd(ft, CH8_STAGE_PRESENT);
+
+    // Update timers (frozen while paused in the debugger)
+    if (budget > 0) {
+        cpu->delayTimer = ch8_max(cpu->delayTimer - 1, 0);
+        cpu->soundTimer = ch8_max(cpu->soundTimer - 1, 0);
+    }
+    if (session->audio != NULL) {
+        ch8_audioUpdate(session->audio, cpu);
+    }
+    if (session->stream != NULL) {
+        ch8_streamPublish(session->stream, cpu, session->frames);
+    }
+    if (session->recorder != NULL) {
+        ch8_recorderCapture(session->recorder, cpu);
+    }
+    ch8_frameTimeCommit(ft);
+    session->frames++;
+
+    ch8_logBind(NULL);
+}
+
+int ch8_sessionStartStream(ch8_session *session, const char *name)
+{
+    assert(session != NULL);
+    assert(session->stream == NULL);
+
+    ch8_logBind(session->log);
+    session->stream = ch8_streamCreate(name);
+    ch8_logBind(NULL);
+
+    return session->stream != NULL ? 0 : 1;
+}
+
+int ch8_sessionStartRecording(ch8_session *session, const char *path)
+{
+    assert(session != NULL);
+    assert(session->recorder == NULL);
+
+    ch8_logBind(session->log);
+    session->recorder = ch8_recorderCreate(path);
+    ch8_logBind(NULL);
+
+    return session->recorder != NULL ? 0 : 1;
+}
+
+void ch8_sessionStopRecording(ch8_session *session)
+{
+    assert(session != NULL);
+
+    ch8_logBind(session->log);
+    ch8_recorderDestroy(&session->recorder);
+    ch8_logBind(NULL);
+}
+
+void ch8_sessionUseTierCache(ch8_session *session, const char *dir)
+{
+    assert(session != NULL);
+    assert(dir != NULL);
+
+    ch8_logBind(session->log);
+
+    // Usually already there; a failure shows up when saving
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+
+    ch8_tierCachePath(&session->cpu, dir, session->tierCache, sizeof(session->tierCache));
+    ch8_tierLoad(session->tier, &session->cpu, session->tierCache);
+
+    ch8_logBind(NULL);
+}
+
+ch8_cpu *ch8_sessionCpu(ch8_session *session)
+{
+    assert(session != NULL);
+    return &session->cpu;
+}
+
+ch8_debugView *ch8_sessionDebugView(ch8_session *session)
+{
+    assert(session != NULL);
+    return session->debugView;
+}
+
+ch8_frameTime *ch8_sessionFrameTime(ch8_session *session)
+{
+    assert(session != NULL);
+    return session->frameTime;
+}
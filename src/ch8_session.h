@@ -0,0 +1,49 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+/*
+ * One emulator instance with everything it owns: VM, debugger and its
+ * panel, window, display, frame timer, audio device and logger. Sessions
+ * share no state with each other, so several can run in one process, each
+ * driven by one thread at a time.
+ */
+
+#include "ch8_cpu.h"
+#include "ch8_debugview.h"
+#include "ch8_frametime.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct ch8_session ch8_session;
+
+/* `name` prefixes the session's log messages (NULL for none); returns NULL on failure */
+ch8_session *ch8_sessionCreate(const char *name, const char *rom, u32 quirks);
+void ch8_sessionDestroy(ch8_session **session);
+
+/* Feeds an SDL_Event to the session's UI and keypad */
+void ch8_sessionHandleEvent(ch8_session *session, const void *event);
+/* Runs one 60hz frame: emulation, texture upload, UI, present and timers */
+void ch8_sessionRunFrame(ch8_session *session);
+
+/* Publishes every frame to a shared memory stream (see ch8_stream.h) and takes keys back from it */
+int ch8_sessionStartStream(ch8_session *session, const char *name);
+
+/* Records every frame to `path` until stopped (see ch8_record.h) */
+int ch8_sessionStartRecording(ch8_session *session, const char *path);
+void ch8_sessionStopRecording(ch8_session *session);
+
+/* Loads hot blocks cached in `dir` before the first frame and saves them back on exit (see ch8_tier.h) */
+void ch8_sessionUseTierCache(ch8_session *session, const char *dir);
+
+ch8_cpu *ch8_sessionCpu(ch8_session *session);
+ch8_debugView *ch8_sessionDebugView(ch8_session *session);
+ch8_frameTime *ch8_sessionFrameTime(ch8_session *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
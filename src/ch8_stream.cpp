@@ -0,0 +1,336 @@
+#include "ch8_stream.h"
+
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ch8_log.h"
+
+#define STREAM_MAGIC 0x53384843u // "CH8S"
+#define STREAM_VERSION 2
+
+static_assert((CH8_STREAM_SLOTS & (CH8_STREAM_SLOTS - 1)) == 0, "stream slots must be a power of two");
+static_assert(std::atomic<u64>::is_always_lock_free, "stream counters must be lock-free to live in shared memory");
+
+typedef struct streamSlot
+{
+    // Seqlock: odd while the publisher is writing the frame
+    std::atomic<u32> sequence;
+    ch8_streamFrame frame;
+} streamSlot;
+
+// Layout of the shared memory object; everything else in a process is private
+typedef struct streamShared
+{
+    std::atomic<u32> magic; // stored last, once the rest is set up
+    u32 version;
+    u32 slots;
+    u32 frameSize;
+    u32 publisher; // pid of the creating process
+
+    // Frames published so far; written only by the publisher
+    CH8_ALIGNED(CH8_CACHE_LINE) std::atomic<u64> published;
+
+    // Key masks from a reader; head is advanced by the reader, tail by the publisher
+    CH8_ALIGNED(CH8_CACHE_LINE) std::atomic<u64> inputHead;
+    CH8_ALIGNED(CH8_CACHE_LINE) std::atomic<u64> inputTail;
+    u16 input[CH8_STREAM_INPUT_SLOTS];
+
+    CH8_ALIGNED(CH8_CACHE_LINE) streamSlot slot[CH8_STREAM_SLOTS];
+} streamShared;
+
+struct ch8_stream
+{
+    streamShared *shared;
+    bool owner; // the publisher removes the object when it closes
+    std::string name;
+};
+
+#ifndef _WIN32
+static streamShared *mapShared(int fd)
+{
+    void *ptr = mmap(NULL, sizeof(streamShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return ptr != MAP_FAILED ? (streamShared *)ptr : NULL;
+}
+
+// A stream whose publisher is gone (crashed, or from an older build) only blocks the name
+static bool publisherAlive(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(streamShared)) {
+        close(fd);
+        return false;
+    }
+
+    void *ptr = mmap(NULL, sizeof(streamShared), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+
+    const streamShared *shared = (const streamShared *)ptr;
+    bool alive = shared->magic.load(std::memory_order_acquire) == STREAM_MAGIC && shared->version == STREAM_VERSION &&
+                 (kill((pid_t)shared->publisher, 0) == 0 || errno == EPERM);
+    munmap(ptr, sizeof(streamShared));
+
+    return alive;
+}
+#endif
+
+ch8_stream *ch8_streamCreate(const char *name)
+{
+    assert(name != NULL);
+
+#ifdef _WIN32
+    ch8_logError("Frame streams are not supported on this platform");
+    return NULL;
+#else
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        if (publisherAlive(name)) {
+            ch8_logError("Frame stream %s is already being published", name);
+            return NULL;
+        }
+
+        // Readers still attached to the stale stream keep their mapping
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        ch8_logError("Could not create frame stream %s", name);
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(streamShared)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        ch8_logError("Could not size frame stream %s", name);
+        return NULL;
+    }
+
+    // ftruncate zero-fills, which is a valid initial state for every field
+    streamShared *shared = mapShared(fd);
+    if (shared == NULL) {
+        shm_unlink(name);
+        ch8_logError("Could not map frame stream %s", name);
+        return NULL;
+    }
+    shared->version = STREAM_VERSION;
+    shared->slots = CH8_STREAM_SLOTS;
+    shared->frameSize = sizeof(ch8_streamFrame);
+    shared->publisher = (u32)getpid();
+    shared->magic.store(STREAM_MAGIC, std::memory_order_release);
+
+    ch8_stream *stream = new ch8_stream();
+    stream->shared = shared;
+    stream->owner = true;
+    stream->name = name;
+
+    ch8_logDebug("Publishing frames to %s", name);
+
+    return stream;
+#endif
+}
+
+ch8_stream *ch8_streamOpen(const char *name)
+{
+    assert(name != NULL);
+
+#ifdef _WIN32
+    ch8_logError("Frame streams are not supported on this platform");
+    return NULL;
+#else
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        ch8_logError("No frame stream named %s", name);
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(streamShared)) {
+        close(fd);
+        ch8_logError("Frame stream %s is too small", name);
+        return NULL;
+    }
+
+    streamShared *shared = mapShared(fd);
+    if (shared == NULL) {
+        ch8_logError("Could not map frame stream %s", name);
+        return NULL;
+    }
+
+    if (shared->magic.load(std::memory_order_acquire) != STREAM_MAGIC || shared->version != STREAM_VERSION
+        || shared->slots != CH8_STREAM_SLOTS || shared->frameSize != sizeof(ch8_streamFrame)) {
+        munmap(shared, sizeof(streamShared));
+        ch8_logError("Frame stream %s has an unknown layout", name);
+        return NULL;
+    }
+
+    ch8_stream *stream = new ch8_stream();
+    stream->shared = shared;
+    stream->owner = false;
+    stream->name = name;
+
+    return stream;
+#endif
+}
+
+void ch8_streamClose(ch8_stream **stream)
+{
+    assert(stream != NULL);
+
+    ch8_stream *s = *stream;
+    if (s == NULL) {
+        return;
+    }
+
+#ifndef _WIN32
+    munmap(s->shared, sizeof(streamShared));
+    if (s->owner) {
+        shm_unlink(s->name.c_str());
+    }
+#endif
+
+    delete s;
+    *stream = NULL;
+}
+
+void ch8_streamPublish(ch8_stream *stream, const ch8_cpu *cpu, u64 frame)
+{
+    assert(stream != NULL);
+    assert(stream->owner);
+    assert(cpu != NULL);
+
+    streamShared *shared = stream->shared;
+    u64 index = shared->published.load(std::memory_order_relaxed);
+    streamSlot &slot = shared->slot[index & (CH8_STREAM_SLOTS - 1)];
+
+    u32 sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frame.index = index;
+    slot.frame.frame = frame;
+    slot.frame.cycles = cpu->cycles;
+    slot.frame.keypad = cpu->keypad;
+    slot.frame.soundOn = cpu->soundTimer > 0;
+    slot.frame.hires = cpu->hires;
+    slot.frame.planeMask = cpu->planeMask;
+    memcpy(slot.frame.framebuffer, cpu->framebuffer, sizeof(slot.frame.framebuffer));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    shared->published.store(index + 1, std::memory_order_release);
+}
+
+bool ch8_streamPollInput(ch8_stream *stream, ch8_cpu *cpu)
+{
+    assert(stream != NULL);
+    assert(cpu != NULL);
+
+    streamShared *shared = stream->shared;
+    u64 tail = shared->inputTail.load(std::memory_order_relaxed);
+    u64 head = shared->inputHead.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+
+    // Every mask is applied in turn, so a press and release within one frame still ends an FX0A wait
+    for (; tail != head; tail++) {
+        u16 keys = shared->input[tail % CH8_STREAM_INPUT_SLOTS];
+        u16 pressed = keys & ~cpu->keypad;
+        cpu->keypad = keys;
+
+        if (cpu->waitFlag && pressed != 0) {
+            int key = 0;
+            while (((pressed >> key) & 1) == 0) {
+                key++;
+            }
+            cpu->V[cpu->waitReg] = (u8)key;
+            cpu->waitFlag = false;
+        }
+    }
+    shared->inputTail.store(head, std::memory_order_release);
+
+    return true;
+}
+
+u64 ch8_streamCount(ch8_stream *stream)
+{
+    assert(stream != NULL);
+    return stream->shared->published.load(std::memory_order_acquire);
+}
+
+bool ch8_streamRead(ch8_stream *stream, u64 index, ch8_streamFrame *out)
+{
+    assert(stream != NULL);
+    assert(out != NULL);
+
+    streamShared *shared = stream->shared;
+    if (index >= shared->published.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const streamSlot &slot = shared->slot[index & (CH8_STREAM_SLOTS - 1)];
+    u32 before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return false;
+    }
+
+    memcpy(out, &slot.frame, sizeof(ch8_streamFrame));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    u32 after = slot.sequence.load(std::memory_order_relaxed);
+
+    // The slot may hold a newer frame if the reader fell a whole ring behind
+    return before == after && out->index == index;
+}
+
+bool ch8_streamReadLatest(ch8_stream *stream, ch8_streamFrame *out)
+{
+    assert(stream != NULL);
+    assert(out != NULL);
+
+    // Losing the race to the publisher means a newer frame is ready, so try that one
+    for (int attempt = 0; attempt < 4; attempt++) {
+        u64 count = ch8_streamCount(stream);
+        if (count == 0) {
+            return false;
+        }
+        if (ch8_streamRead(stream, count - 1, out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ch8_streamSendKeys(ch8_stream *stream, u16 keys)
+{
+    assert(stream != NULL);
+
+    streamShared *shared = stream->shared;
+    u64 head = shared->inputHead.load(std::memory_order_relaxed);
+    u64 tail = shared->inputTail.load(std::memory_order_acquire);
+    if (head - tail == CH8_STREAM_INPUT_SLOTS) {
+        return false;
+    }
+
+    shared->input[head % CH8_STREAM_INPUT_SLOTS] = keys;
+    shared->inputHead.store(head + 1, std::memory_order_release);
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+/*
+ * Live frame stream in POSIX shared memory. The emulator publishes every
+ * frame into a ring of slots, each guarded by a seqlock, so any number of
+ * external readers can follow along without ever blocking it. Readers can
+ * send key masks back through a second, single-producer ring that the
+ * emulator drains into the keypad.
+ */
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_STREAM_SLOTS 8 /* frames kept; must be a power of two */
+#define CH8_STREAM_INPUT_SLOTS 64
+
+typedef struct ch8_streamFrame
+{
+    u64 index;     /* position in the stream, counting from 0 */
+    u64 frame;     /* the publisher's frame number */
+    u64 cycles;
+    u16 keypad;
+    bool soundOn;
+    bool hires;
+    u8 planeMask;
+    u64 framebuffer[CH8_NUM_PLANES][CH8_DISPLAY_HIRES_HEIGHT][CH8_DISPLAY_ROW_WORDS];
+} ch8_streamFrame;
+
+typedef struct ch8_stream ch8_stream;
+
+/*
+ * Publisher side; `name` is a shared memory object name such as "/ch8-1".
+ * Fails while another live process publishes under the name; a stream left
+ * behind by a publisher that died is replaced.
+ */
+ch8_stream *ch8_streamCreate(const char *name);
+void ch8_streamPublish(ch8_stream *stream, const ch8_cpu *cpu, u64 frame);
+/* Applies key masks sent by readers, in order; returns false if there were none */
+bool ch8_streamPollInput(ch8_stream *stream, ch8_cpu *cpu);
+
+/* Reader side */
+ch8_stream *ch8_streamOpen(const char *name);
+/* Number of frames published so far */
+u64 ch8_streamCount(ch8_stream *stream);
+/* Copies frame `index`; false if it isn't published yet or was overwritten meanwhile */
+bool ch8_streamRead(ch8_stream *stream, u64 index, ch8_streamFrame *out);
+/* Copies the newest frame; false if none is published or it was overwritten meanwhile */
+bool ch8_streamReadLatest(ch8_stream *stream, ch8_streamFrame *out);
+/* Queues the keys to hold from the emulator's next frame on; false if the ring is full.
+   Only one reader at a time may send keys. */
+bool ch8_streamSendKeys(ch8_stream *stream, u16 keys);
+
+/* Unmaps the stream; the publisher also removes the shared memory object */
+void ch8_streamClose(ch8_stream **stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
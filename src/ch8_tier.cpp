@@ -0,0 +1,740 @@
+#include "ch8_tier.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <array>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ch8_log.h"
+#include "ch8_opcodes.h"
+#include "ch8_quirks.h"
+#include "ch8_trace.h"
+
+// Jump and call targets are 12 bits; code above that stays interpreted
+#define TIER_MAX_ADDR 0x1000
+#define TIER_MAX_BLOCK 32
+
+#define TIER_CACHE_MAGIC 0x42384843u // "CH8B"
+#define TIER_CACHE_HEADER_SIZE 16
+#define TIER_CACHE_ENTRY_SIZE 4
+
+typedef void (*opFn)(ch8_cpu *cpu, u16 opcode);
+
+typedef struct decodedOp
+{
+    opFn run;
+    u16 opcode;
+} decodedOp;
+
+typedef struct tierBlock
+{
+    u8 level; // ch8_tierLevel
+    u16 start;
+    u16 end;     // first address past the block's code
+    u32 length;  // instructions
+    u32 entries; // since it was decoded
+    const ch8_recompBlock *native;
+    decodedOp ops[TIER_MAX_BLOCK];
+} tierBlock;
+
+struct ch8_tier
+{
+    const ch8_recompProgram *native;
+
+    // The VM the blocks were built for, as the last run left it
+    const ch8_cpu *cpu;
+    u64 cycles;
+    u32 quirks;
+
+    u16 hits[TIER_MAX_ADDR]; // entries of addresses still interpreted
+    tierBlock *blocks[TIER_MAX_ADDR];
+    u64 covered[TIER_MAX_ADDR / 64]; // bytes inside promoted blocks
+    u32 numBlocks;
+
+    ch8_tierStats stats;
+};
+
+typedef u32 (*tierRunFn)(ch8_tier *tier, ch8_cpu *cpu, u32 budget);
+typedef tierBlock *(*decodeBlockFn)(const ch8_cpu *cpu, u16 start);
+
+static inline u16 fetch(const ch8_cpu *cpu, u16 addr)
+{
+    return cpu->memory[addr & CH8_ADDR_MASK] << 8 | cpu->memory[(addr + 1) & CH8_ADDR_MASK];
+}
+
+static void opClearDisplay(ch8_cpu *cpu, u16)
+{
+    ch8_op_ClearDisplay(cpu);
+}
+
+static void opReturnFromSub(ch8_cpu *cpu, u16)
+{
+    ch8_op_ReturnFromSub(cpu);
+}
+
+static void opScrollRight(ch8_cpu *cpu, u16)
+{
+    ch8_op_ScrollRight(cpu);
+}
+
+static void opScrollLeft(ch8_cpu *cpu, u16)
+{
+    ch8_op_ScrollLeft(cpu);
+}
+
+static void opLowRes(ch8_cpu *cpu, u16)
+{
+    ch8_op_LowRes(cpu);
+}
+
+static void opHighRes(ch8_cpu *cpu, u16)
+{
+    ch8_op_HighRes(cpu);
+}
+
+// Mirrors execute() in ch8_cpu.cpp; NULL for anything left to the interpreter (0000, F000 NNNN, invalid opcodes)
+template <u32 Quirks>
+static opFn decode(u16 opcode)
+{
+    switch (opcode & 0xF000)
+    {
+    case 0x0000:
+        if (opcode == 0x0000) {
+            return NULL;
+        }
+        if ((opcode & 0xFFF0) == 0x00C0) {
+            return ch8_op_ScrollDown;
+        }
+        switch (opcode & 0x00FF)
+        {
+        case 0x00E0:
+            return opClearDisplay;
+        case 0x00EE:
+            return opReturnFromSub;
+        case 0x00FB:
+            return opScrollRight;
+        case 0x00FC:
+            return opScrollLeft;
+        case 0x00FE:
+            return opLowRes;
+        case 0x00FF:
+            return opHighRes;
+        }
+        return NULL;
+    case 0x1000:
+        return ch8_op_JumpTo;
+    case 0x2000:
+        return ch8_op_CallSub;
+    case 0x3000:
+        return ch8_op_SkipEquals;
+    case 0x4000:
+        return ch8_op_SkipNotEquals;
+    case 0x5000:
+        switch (opcode & 0x000F)
+        {
+        case 0x0000:
+            return ch8_op_SkipVXEqualsVY;
+        case 0x0002:
+            return ch8_op_StoreRange;
+        case 0x0003:
+            return ch8_op_LoadRange;
+        }
+        return NULL;
+    case 0x6000:
+        return ch8_op_Set;
+    case 0x7000:
+        return ch8_op_Add;
+    case 0x8000:
+        switch (opcode & 0x000F)
+        {
+        case 0x0000:
+            return ch8_op_Assign;
+        case 0x0001:
+            return ch8_op_LogicalOr<Quirks>;
+        case 0x0002:
+            return ch8_op_LogicalAnd<Quirks>;
+        case 0x0003:
+            return ch8_op_LogicalXor<Quirks>;
+        case 0x0004:
+            return ch8_op_AddAssign;
+        case 0x0005:
+            return ch8_op_SubtractAssign;
+        case 0x0006:
+            return ch8_op_BitshiftRight<Quirks>;
+        case 0x0007:
+            return ch8_op_SubtractAssignReverse;
+        case 0x000E:
+            return ch8_op_BitshiftLeft<Quirks>;
+        }
+        return NULL;
+    case 0x9000:
+        return ch8_op_SkipVXNotEqualsVY;
+    case 0xA000:
+        return ch8_op_SetIndex;
+    case 0xB000:
+        return ch8_op_JumpOffset<Quirks>;
+    case 0xC000:
+        return ch8_op_BitwiseRandom;
+    case 0xD000:
+        return ch8_op_DrawSprite<Quirks>;
+    case 0xE000:
+        switch (opcode & 0x00FF)
+        {
+        case 0x009E:
+            return ch8_op_KeyEquals;
+        case 0x00A1:
+            return ch8_op_KeyNotEquals;
+        }
+        return NULL;
+    case 0xF000:
+        switch (opcode & 0x00FF)
+        {
+        case 0x0001:
+            return ch8_op_SelectPlanes;
+        case 0x0007:
+            return ch8_op_ReadDelayTimer;
+        case 0x000A:
+            return ch8_op_KeyWait;
+        case 0x0015:
+            return ch8_op_SetDelayTimer;
+        case 0x0018:
+            return ch8_op_SetSoundTimer;
+        case 0x001E:
+            return ch8_op_AddToIndex;
+        case 0x0029:
+            return ch8_op_SetFontChar;
+        case 0x0030:
+            return ch8_op_SetBigFontChar;
+        case 0x0033:
+            return ch8_op_StoreBinaryCodedDecimal;
+        case 0x0055:
+            return ch8_op_Store<Quirks>;
+        case 0x0065:
+            return ch8_op_Load<Quirks>;
+        case 0x0075:
+            return ch8_op_StoreFlags;
+        case 0x0085:
+            return ch8_op_LoadFlags;
+        }
+        return NULL;
+    }
+    return NULL;
+}
+
+// Control flow, key waits and stores are the last instruction of a block
+static bool endsBlock(u16 opcode)
+{
+    switch (opcode & 0xF000)
+    {
+    case 0x0000:
+        return opcode == 0x00EE;
+    case 0x1000:
+    case 0x2000:
+    case 0x3000:
+    case 0x4000:
+    case 0x5000:
+    case 0x9000:
+    case 0xB000:
+    case 0xE000:
+        return true;
+    case 0xF000:
+        return (opcode & 0x00FF) == 0x000A || (opcode & 0x00FF) == 0x0033 || (opcode & 0x00FF) == 0x0055;
+    }
+    return false;
+}
+
+template <u32 Quirks>
+static tierBlock *decodeBlock(const ch8_cpu *cpu, u16 start)
+{
+    tierBlock block;
+    block.length = 0;
+
+    u32 pc = start;
+    while (block.length < TIER_MAX_BLOCK && pc + CH8_PC_STEP_SIZE <= TIER_MAX_ADDR) {
+        u16 opcode = fetch(cpu, (u16)pc);
+        opFn run = decode<Quirks>(opcode);
+        if (run == NULL) {
+            break;
+        }
+
+        block.ops[block.length++] = {run, opcode};
+        pc += CH8_PC_STEP_SIZE;
+        if (endsBlock(opcode)) {
+            break;
+        }
+    }
+
+    if (block.length == 0) {
+        return NULL;
+    }
+
+    tierBlock *decoded = (tierBlock *)malloc(sizeof(tierBlock));
+    if (decoded == NULL) {
+        return NULL;
+    }
+    memcpy(decoded, &block, sizeof(tierBlock));
+    decoded->level = CH8_TIER_DECODED;
+    decoded->start = start;
+    decoded->end = (u16)pc;
+    decoded->entries = 0;
+    decoded->native = NULL;
+
+    return decoded;
+}
+
+static void cover(ch8_tier *tier, const tierBlock *block)
+{
+    for (u32 addr = block->start; addr < block->end; addr++) {
+        tier->covered[addr / 64] |= 1ull << (addr % 64);
+    }
+}
+
+static void addBlock(ch8_tier *tier, tierBlock *block)
+{
+    tier->blocks[block->start] = block;
+    tier->numBlocks++;
+    cover(tier, block);
+}
+
+// The recompiled block only applies while guest memory still holds the ROM it was compiled from
+static bool promoteNative(ch8_tier *tier, const ch8_cpu *cpu, tierBlock *block)
+{
+    const ch8_recompProgram *program = tier->native;
+    if (program == NULL || program->quirks != cpu->quirks) {
+        return false;
+    }
+
+    const ch8_recompBlock *native = program->lookup(block->start);
+    if (native == NULL || native->start < CH8_PROGRAM_START_OFFSET || native->end > TIER_MAX_ADDR
+        || (u32)(native->end - CH8_PROGRAM_START_OFFSET) > program->size) {
+        return false;
+    }
+    if (memcmp(cpu->memory + native->start, program->rom + (native->start - CH8_PROGRAM_START_OFFSET),
+               native->end - native->start) != 0) {
+        return false;
+    }
+
+    block->level = CH8_TIER_NATIVE;
+    block->native = native;
+    block->end = native->end;
+    block->length = native->length;
+    cover(tier, block);
+    return true;
+}
+
+static u32 runDecoded(const tierBlock *block, ch8_cpu *cpu)
+{
+    for (u32 i = 0; i < block->length; i++) {
+        cpu->drawFlag = false;
+        cpu->waitFlag = false;
+        cpu->waitReg = 0;
+        block->ops[i].run(cpu, block->ops[i].opcode);
+    }
+
+    // Only a call or return faults, and either one ends the block; like ch8_clockCycle, it does not count
+    u32 ran = block->length;
+    if (cpu->fault != CH8_FAULT_NONE) {
+        ch8_logError("%s at %X", ch8_faultName((ch8_fault)cpu->fault), block->end - CH8_PC_STEP_SIZE);
+        ran--;
+    }
+
+    cpu->cycles += ran;
+    return ran;
+}
+
+static void demote(ch8_tier *tier, u16 start, u32 length)
+{
+    for (u32 b = 0; b < TIER_MAX_ADDR; b++) {
+        tierBlock *block = tier->blocks[b];
+        if (block == NULL) {
+            continue;
+        }
+
+        for (u32 i = 0; i < length; i++) {
+            u16 addr = (start + i) & CH8_ADDR_MASK;
+            if (addr >= block->start && addr < block->end) {
+                free(block);
+                tier->blocks[b] = NULL;
+                tier->hits[b] = 0;
+                tier->numBlocks--;
+                tier->stats.demotions++;
+                break;
+            }
+        }
+    }
+
+    memset(tier->covered, 0, sizeof(tier->covered));
+    for (u32 b = 0; b < TIER_MAX_ADDR; b++) {
+        if (tier->blocks[b] != NULL) {
+            cover(tier, tier->blocks[b]);
+        }
+    }
+}
+
+// Demotes the blocks a store that just ran wrote to
+static void checkStore(ch8_tier *tier, const ch8_cpu *cpu, u16 opcode)
+{
+    if (tier->numBlocks == 0) {
+        return;
+    }
+
+    u16 start = cpu->index;
+    u32 length;
+    if ((opcode & 0xF0FF) == 0xF033) {
+        length = 3;
+    } else if ((opcode & 0xF0FF) == 0xF055) {
+        length = ((opcode & 0x0F00) >> 8) + 1;
+        if ((cpu->quirks & CH8_QUIRK_INCREMENT_I) != 0) {
+            start -= length;
+        }
+    } else if ((opcode & 0xF00F) == 0x5002) {
+        int x = (opcode & 0x0F00) >> 8;
+        int y = (opcode & 0x00F0) >> 4;
+        length = abs(x - y) + 1;
+    } else {
+        return;
+    }
+
+    for (u32 i = 0; i < length; i++) {
+        u16 addr = (start + i) & CH8_ADDR_MASK;
+        if (addr < TIER_MAX_ADDR && (tier->covered[addr / 64] >> (addr % 64)) & 1) {
+            demote(tier, start, length);
+            return;
+        }
+    }
+}
+
+static u32 interpret(ch8_tier *tier, ch8_cpu *cpu, u32 budget)
+{
+    u32 n = 0;
+    while (n < budget && !cpu->waitFlag) {
+        u16 opcode = ch8_nextOpcode(cpu);
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            break;
+        }
+        n++;
+        checkStore(tier, cpu, opcode);
+    }
+
+    tier->stats.instructions[CH8_TIER_INTERPRETER] += n;
+    return n;
+}
+
+template <u32 Quirks>
+static u32 run(ch8_tier *tier, ch8_cpu *cpu, u32 budget)
+{
+    // Blocks would skip mirroring the stack and display after each instruction
+    if constexpr ((Quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        return interpret(tier, cpu, budget);
+    }
+
+    u32 n = 0;
+    bool entered = true;
+
+    while (n < budget && !cpu->waitFlag && cpu->fault == CH8_FAULT_NONE) {
+        u16 pc = cpu->programCounter;
+        tierBlock *block = NULL;
+
+        // Only jump targets and fallthroughs past a block are counted, so blocks start where control arrives
+        if (entered && pc < TIER_MAX_ADDR) {
+            block = tier->blocks[pc];
+            if (block == NULL) {
+                if (++tier->hits[pc] >= CH8_TIER_DECODE_THRESHOLD) {
+                    tier->hits[pc] = 0;
+                    block = decodeBlock<Quirks>(cpu, pc);
+                    if (block != NULL) {
+                        addBlock(tier, block);
+                        tier->stats.promotions++;
+                    }
+                }
+            } else if (++block->entries == CH8_TIER_NATIVE_THRESHOLD && promoteNative(tier, cpu, block)) {
+                tier->stats.promotions++;
+            }
+        }
+
+        if (block != NULL && block->length <= budget - n) {
+            // Read before running: the block may overwrite its own code, or be demoted for it
+            u16 last = fetch(cpu, block->end - CH8_PC_STEP_SIZE);
+            u8 level = block->level;
+            u32 length = block->length;
+
+            u32 ran = level == CH8_TIER_NATIVE ? block->native->run(cpu) : runDecoded(block, cpu);
+            n += ran;
+            tier->stats.instructions[level] += ran;
+            if (ran < length) {
+                break;
+            }
+
+            checkStore(tier, cpu, last);
+            entered = true;
+            continue;
+        }
+
+        u16 opcode = ch8_nextOpcode(cpu);
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            break;
+        }
+        n++;
+        tier->stats.instructions[CH8_TIER_INTERPRETER]++;
+        checkStore(tier, cpu, opcode);
+        entered = cpu->programCounter != (u16)(pc + CH8_PC_STEP_SIZE);
+    }
+
+    return n;
+}
+
+template <u32... Quirks>
+static constexpr std::array<tierRunFn, sizeof...(Quirks)> makeRunners(std::integer_sequence<u32, Quirks...>)
+{
+    return {{run<Quirks>...}};
+}
+
+static constexpr auto runners = makeRunners(std::make_integer_sequence<u32, CH8_QUIRKS_SPECIALIZED + 1>());
+
+template <u32... Quirks>
+static constexpr std::array<decodeBlockFn, sizeof...(Quirks)> makeDecoders(std::integer_sequence<u32, Quirks...>)
+{
+    return {{decodeBlock<Quirks>...}};
+}
+
+static constexpr auto decoders = makeDecoders(std::make_integer_sequence<u32, CH8_QUIRKS_SPECIALIZED + 1>());
+
+static void put16(u8 *out, u16 value)
+{
+    out[0] = (u8)value;
+    out[1] = (u8)(value >> 8);
+}
+
+static void put32(u8 *out, u32 value)
+{
+    put16(out, (u16)value);
+    put16(out + 2, (u16)(value >> 16));
+}
+
+static u16 get16(const u8 *in)
+{
+    return (u16)(in[0] | in[1] << 8);
+}
+
+static u32 get32(const u8 *in)
+{
+    return get16(in) | (u32)get16(in + 2) << 16;
+}
+
+// FNV-1a
+static u64 hashBytes(u64 hash, const u8 *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+ch8_tier *ch8_tierCreate(const ch8_recompProgram *native)
+{
+    ch8_tier *tier = (ch8_tier *)calloc(1, sizeof(ch8_tier));
+    if (tier == NULL) {
+        return NULL;
+    }
+    tier->native = native;
+
+    return tier;
+}
+
+void ch8_tierDestroy(ch8_tier **tier)
+{
+    assert(tier != NULL);
+
+    if (*tier != NULL) {
+        ch8_tierFlush(*tier);
+        free(*tier);
+        *tier = NULL;
+    }
+}
+
+u32 ch8_tierRun(ch8_tier *tier, ch8_cpu *cpu, u32 budget)
+{
+    assert(tier != NULL);
+    assert(cpu != NULL);
+
+    if (cpu != tier->cpu || cpu->cycles != tier->cycles || cpu->quirks != tier->quirks) {
+        ch8_tierFlush(tier);
+        tier->cpu = cpu;
+        tier->quirks = cpu->quirks;
+    }
+
+    // A trace needs every instruction recorded on its own
+    u32 n = ch8_traceIsActive() ? interpret(tier, cpu, budget) : runners[cpu->quirks & CH8_QUIRKS_SPECIALIZED](tier, cpu, budget);
+
+    tier->cycles = cpu->cycles;
+    return n;
+}
+
+void ch8_tierFlush(ch8_tier *tier)
+{
+    assert(tier != NULL);
+
+    for (u32 b = 0; b < TIER_MAX_ADDR; b++) {
+        free(tier->blocks[b]);
+        tier->blocks[b] = NULL;
+    }
+    tier->numBlocks = 0;
+    memset(tier->hits, 0, sizeof(tier->hits));
+    memset(tier->covered, 0, sizeof(tier->covered));
+}
+
+void ch8_tierGetStats(const ch8_tier *tier, ch8_tierStats *stats)
+{
+    assert(tier != NULL);
+    assert(stats != NULL);
+
+    *stats = tier->stats;
+}
+
+void ch8_tierCachePath(const ch8_cpu *cpu, const char *dir, char *path, size_t size)
+{
+    assert(cpu != NULL);
+    assert(dir != NULL);
+    assert(path != NULL);
+
+    u8 key[6];
+    put16(key, CH8_TIER_CACHE_VERSION);
+    put32(key + 2, cpu->quirks);
+
+    // The whole program area, so ROMs differing only in length past their code share a file
+    u64 hash = hashBytes(0xCBF29CE484222325ull, key, sizeof(key));
+    hash = hashBytes(hash, cpu->memory + CH8_PROGRAM_START_OFFSET, CH8_MAX_PROGRAM_SIZE);
+
+    snprintf(path, size, "%s/%016llx.ch8tier", dir, (unsigned long long)hash);
+}
+
+int ch8_tierLoad(ch8_tier *tier, const ch8_cpu *cpu, const char *path)
+{
+    assert(tier != NULL);
+    assert(cpu != NULL);
+    assert(path != NULL);
+
+#ifdef _WIN32
+    ch8_logWarning("Tier caches are not supported on this platform");
+    return 1;
+#else
+    // No file yet is the normal first run
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TIER_CACHE_HEADER_SIZE) {
+        close(fd);
+        ch8_logWarning("Ignoring tier cache %s", path);
+        return 1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ch8_logError("Could not map tier cache %s", path);
+        return 1;
+    }
+
+    const u8 *data = (const u8 *)map;
+    u32 count = get32(data + 12);
+    if (get32(data) != TIER_CACHE_MAGIC || get16(data + 4) != CH8_TIER_CACHE_VERSION || get32(data + 8) != cpu->quirks
+        || count > (size - TIER_CACHE_HEADER_SIZE) / TIER_CACHE_ENTRY_SIZE) {
+        munmap(map, size);
+        ch8_logWarning("Ignoring tier cache %s", path);
+        return 1;
+    }
+
+    // Bind to the VM as ch8_tierRun would, so its first run keeps the blocks
+    ch8_tierFlush(tier);
+    tier->cpu = cpu;
+    tier->cycles = cpu->cycles;
+    tier->quirks = cpu->quirks;
+
+    for (u32 i = 0; i < count; i++) {
+        const u8 *entry = data + TIER_CACHE_HEADER_SIZE + i * TIER_CACHE_ENTRY_SIZE;
+        u16 start = get16(entry);
+        if (start >= TIER_MAX_ADDR || tier->blocks[start] != NULL) {
+            continue;
+        }
+
+        tierBlock *block = decoders[cpu->quirks & CH8_QUIRKS_SPECIALIZED](cpu, start);
+        if (block == NULL) {
+            continue;
+        }
+        addBlock(tier, block);
+        if (entry[2] == CH8_TIER_NATIVE) {
+            promoteNative(tier, cpu, block);
+        }
+    }
+
+    munmap(map, size);
+    ch8_logInfo("Loaded %u blocks from %s", tier->numBlocks, path);
+
+    return 0;
+#endif
+}
+
+int ch8_tierSave(const ch8_tier *tier, const char *path)
+{
+    assert(tier != NULL);
+    assert(path != NULL);
+
+#ifdef _WIN32
+    ch8_logWarning("Tier caches are not supported on this platform");
+    return 1;
+#else
+    // A short or debugged run promoted nothing; whatever an earlier run saved is still better
+    if (tier->numBlocks == 0) {
+        return 0;
+    }
+
+    std::vector<u8> data(TIER_CACHE_HEADER_SIZE + tier->numBlocks * TIER_CACHE_ENTRY_SIZE, 0);
+    put32(data.data(), TIER_CACHE_MAGIC);
+    put16(data.data() + 4, CH8_TIER_CACHE_VERSION);
+    put32(data.data() + 8, tier->quirks);
+    put32(data.data() + 12, tier->numBlocks);
+
+    u8 *entry = data.data() + TIER_CACHE_HEADER_SIZE;
+    for (u32 b = 0; b < TIER_MAX_ADDR; b++) {
+        if (tier->blocks[b] != NULL) {
+            put16(entry, (u16)b);
+            entry[2] = tier->blocks[b]->level;
+            entry += TIER_CACHE_ENTRY_SIZE;
+        }
+    }
+
+    // Processes sharing the directory only ever map complete files
+    char temp[1024];
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+
+    FILE *f = fopen(temp, "wb");
+    if (f == NULL) {
+        ch8_logError("Could not create tier cache %s", temp);
+        return 1;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (fclose(f) != 0 || !written || rename(temp, path) != 0) {
+        remove(temp);
+        ch8_logError("Could not write tier cache %s", path);
+        return 1;
+    }
+
+    ch8_logInfo("Saved %u blocks to %s", tier->numBlocks, path);
+
+    return 0;
+#endif
+}
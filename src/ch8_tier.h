@@ -0,0 +1,85 @@
+#ifndef __TIER_H__
+#define __TIER_H__
+
+/*
+ * Tiered execution for one VM. Every address starts out interpreted with
+ * ch8_clockCycle while the engine counts how often each jump, call, return
+ * or skip target is entered. Targets entered CH8_TIER_DECODE_THRESHOLD times
+ * are decoded once into a straight-line block of handler calls; decoded
+ * blocks entered CH8_TIER_NATIVE_THRESHOLD times switch to the matching
+ * function of a recompiled program (see ch8_recomp.h) when one was given.
+ * Short runs never reach the thresholds and pay nothing for either tier.
+ *
+ * Blocks end at control flow and at FX33/FX55/5XY2. When a store writes to
+ * a promoted block, that block is demoted back to the interpreter.
+ */
+
+#include "ch8_cpu.h"
+#include "ch8_recomp.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_TIER_DECODE_THRESHOLD 32
+#define CH8_TIER_NATIVE_THRESHOLD 1024
+
+/* Bump whenever block formation changes, so caches from older builds are ignored */
+#define CH8_TIER_CACHE_VERSION 2
+
+typedef enum ch8_tierLevel
+{
+    CH8_TIER_INTERPRETER,
+    CH8_TIER_DECODED,
+    CH8_TIER_NATIVE,
+    CH8_NUM_TIERS
+} ch8_tierLevel;
+
+typedef struct ch8_tierStats
+{
+    u64 instructions[CH8_NUM_TIERS]; /* executed in each tier */
+    u32 promotions;
+    u32 demotions;
+} ch8_tierStats;
+
+typedef struct ch8_tier ch8_tier;
+
+/* `native` may be NULL; returns NULL on failure */
+ch8_tier *ch8_tierCreate(const ch8_recompProgram *native);
+void ch8_tierDestroy(ch8_tier **tier);
+
+/*
+ * Same contract as ch8_backendRun. Switching to another VM, or one whose
+ * cycle count moved since the last run (reset, snapshot restore), drops all
+ * promoted blocks. So does a change of quirks.
+ */
+u32 ch8_tierRun(ch8_tier *tier, ch8_cpu *cpu, u32 budget);
+
+/* Drops all promoted blocks, e.g. after editing guest memory from outside */
+void ch8_tierFlush(ch8_tier *tier);
+
+void ch8_tierGetStats(const ch8_tier *tier, ch8_tierStats *stats);
+
+/*
+ * Promoted blocks can outlive the process. A cache file lists each block's
+ * start address and tier; decoded blocks hold handler pointers that are only
+ * valid in one process, so loading decodes them again from the VM's memory.
+ * A stale or foreign file can cost time but never correctness.
+ */
+
+/*
+ * <dir>/<hash>.ch8tier for a VM that has loaded a ROM but not run it yet.
+ * The hash covers the program area, the quirks and CH8_TIER_CACHE_VERSION.
+ */
+void ch8_tierCachePath(const ch8_cpu *cpu, const char *dir, char *path, size_t size);
+/* Maps the file and decodes its blocks right away; returns 0 on success, nonzero when there is no usable file */
+int ch8_tierLoad(ch8_tier *tier, const ch8_cpu *cpu, const char *path);
+/* Replaces the file atomically; returns 0 on success. Keeps the old file when nothing is promoted. */
+int ch8_tierSave(const ch8_tier *tier, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
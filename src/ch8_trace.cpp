@@ -0,0 +1,197 @@
+#include "ch8_trace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "ch8_log.h"
+#include "ch8_util.h"
+
+// Single producer ring: only the emulation thread writes records, readers
+// (on-demand flush, crash handler) snapshot whatever is there.
+static ch8_traceRecord *ring = nullptr;
+static u32 capacity = 0;
+static u32 mask = 0;
+static std::atomic<u64> written{0};
+
+static char crashFile[512] = {0};
+
+int ch8_traceStart(u32 requested)
+{
+    if (ring != nullptr) {
+        ch8_logInfo("Instruction trace already running");
+        return 1;
+    }
+
+    // Round up to a power of two so the write index is a mask, not a modulo
+    u32 cap = 1;
+    while (cap < requested) {
+        cap <<= 1;
+    }
+
+    ring = (ch8_traceRecord *)ch8_malloc(cap * sizeof(ch8_traceRecord));
+    if (ring == nullptr) {
+        ch8_logError("Could not allocate %u trace records", cap);
+        return 1;
+    }
+
+    capacity = cap;
+    mask = cap - 1;
+    written.store(0, std::memory_order_relaxed);
+
+    ch8_logDebug("Instruction trace started (%u records)", cap);
+
+    return 0;
+}
+
+void ch8_traceStop()
+{
+    if (ring == nullptr) {
+        return;
+    }
+
+    void *ptr = ring;
+    ring = nullptr;
+    ch8_free(&ptr);
+    capacity = 0;
+    mask = 0;
+}
+
+bool ch8_traceIsActive()
+{
+    return ring != nullptr;
+}
+
+void ch8_traceRecordCycle(const ch8_cpu *cpu, u16 pc, u16 opcode)
+{
+    ch8_traceRecord *r = ring;
+    if (r == nullptr) {
+        return;
+    }
+
+    u64 n = written.load(std::memory_order_relaxed);
+    ch8_traceRecord *rec = &r[n & mask];
+    rec->cycle = (u32)cpu->cycles;
+    rec->programCounter = pc;
+    rec->opcode = opcode;
+    rec->index = cpu->index;
+    rec->vx = cpu->V[(opcode & 0x0F00) >> 8];
+    rec->vf = cpu->V[0xF];
+    written.store(n + 1, std::memory_order_release);
+}
+
+// Fills in the header and returns the ring slot of the oldest record
+static u32 snapshotHeader(ch8_traceHeader *header)
+{
+    u64 n = written.load(std::memory_order_acquire);
+    u32 count = (u32)ch8_min(n, (u64)capacity);
+
+    memcpy(header->magic, CH8_TRACE_MAGIC, 4);
+    header->version = CH8_TRACE_VERSION;
+    header->recordSize = sizeof(ch8_traceRecord);
+    header->count = count;
+    header->overwritten = (u32)(n - count);
+
+    return (u32)((n - count) & mask);
+}
+
+bool ch8_traceFlush(const char *file)
+{
+    assert(file != NULL);
+
+    if (ring == nullptr) {
+        ch8_logError("No instruction trace to flush");
+        return false;
+    }
+
+    FILE *f = fopen(file, "wb");
+    if (f == NULL) {
+        ch8_logError("Could not open trace file %s", file);
+        return false;
+    }
+
+    ch8_traceHeader header;
+    u32 first = snapshotHeader(&header);
+    u32 head = ch8_min(header.count, capacity - first);
+
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(ring + first, sizeof(ch8_traceRecord), head, f);
+    fwrite(ring, sizeof(ch8_traceRecord), header.count - head, f);
+    fclose(f);
+
+    ch8_logInfo("Flushed %u trace records to %s", header.count, file);
+
+    return true;
+}
+
+#ifndef _WIN32
+static void writeAll(int fd, const void *data, size_t size)
+{
+    const u8 *p = (const u8 *)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+}
+
+// Only async-signal-safe calls from here on
+static void crashHandler(int sig)
+{
+    if (ring != nullptr) {
+        int fd = open(crashFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            ch8_traceHeader header;
+            u32 first = snapshotHeader(&header);
+            u32 head = ch8_min(header.count, capacity - first);
+
+            writeAll(fd, &header, sizeof(header));
+            writeAll(fd, ring + first, head * sizeof(ch8_traceRecord));
+            writeAll(fd, ring, (header.count - head) * sizeof(ch8_traceRecord));
+            close(fd);
+        }
+    }
+
+    // Handler was installed with SA_RESETHAND, so this takes the default action
+    raise(sig);
+}
+#endif
+
+bool ch8_traceInstallCrashHandler(const char *file)
+{
+    assert(file != NULL);
+
+#ifdef _WIN32
+    ch8_logWarning("Trace crash handler is not supported on this platform");
+    return false;
+#else
+    if (strlen(file) >= sizeof(crashFile)) {
+        ch8_logError("Trace file path too long");
+        return false;
+    }
+    strcpy(crashFile, file);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = crashHandler;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+
+    const int signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+    for (int sig : signals) {
+        sigaction(sig, &sa, NULL);
+    }
+
+    return true;
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+
+#include "ch8_cpu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CH8_TRACE_MAGIC "CH8T"
+#define CH8_TRACE_VERSION 1
+#define CH8_TRACE_DEFAULT_CAPACITY (1 << 16)
+
+/*
+ * One executed instruction. The register written by the instruction is
+ * implied by the opcode, so only VX (X taken from the opcode) and VF are
+ * captured after execution.
+ */
+typedef struct ch8_traceRecord
+{
+    u32 cycle;
+    u16 programCounter;
+    u16 opcode;
+    u16 index;
+    u8 vx;
+    u8 vf;
+} ch8_traceRecord;
+
+/* File layout: header followed by `count` records, oldest first */
+typedef struct ch8_traceHeader
+{
+    char magic[4];
+    u16 version;
+    u16 recordSize;
+    u32 count;
+    u32 overwritten;
+} ch8_traceHeader;
+
+int ch8_traceStart(u32 capacity);
+void ch8_traceStop();
+bool ch8_traceIsActive();
+
+void ch8_traceRecordCycle(const ch8_cpu *cpu, u16 pc, u16 opcode);
+
+bool ch8_traceFlush(const char *file);
+bool ch8_traceInstallCrashHandler(const char *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,6 +6,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include "ch8_def.h"
 
 #ifdef __cplusplus
@@ -33,6 +37,18 @@ static inline void ch8_free(void** pptr)
     }
 }
 
+/* `v` must not be 0 */
+static inline int ch8_lowestSetBit(u64 v)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return (int)i;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
 #define ch8_max(a, b) (((a) > (b)) ? (a) : (b))
 #define ch8_min(a, b) (((a) < (b)) ? (a) : (b))
 
@@ -1,71 +1,110 @@
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
 #include <SDL.h>
-#include <imgui_impl_sdl2.h>
 
 #include "ch8_cpu.h"
-#include "ch8_display.h"
-#include "ch8_audio.h"
-#include "ch8_keyboard.h"
+#include "ch8_grid.h"
+#include "ch8_session.h"
+#include "ch8_trace.h"
 #include "ch8_log.h"
 #include "ch8_util.h"
 
-ch8_cpu cpu;
+static ch8_session *session = NULL;
+static ch8_grid *grid = NULL; // --grid runs many VMs in one window instead of the session
 
-SDL_Window* window = NULL;
+static const char* traceFile = NULL;
+static u32 quirks = CH8_QUIRKS_LEGACY;
+static int gridCount = 0;
+static const char *streamName = NULL;
+static const char *recordFile = NULL;
+static const char *tierCacheDir = NULL;
 
 static void initialize(int argc, char* argv[])
 {
-    // Initialize VM
-    ch8_reset(&cpu);
-    srand((u32)time(NULL));
-
     // Initialize sub-systems
     if (ch8_logInit() != 0) {
         fprintf(stderr, "Could not initialize the logger\n");
         exit(EXIT_FAILURE);
     }
 
-    // Load test ROM
-    // TODO: Get ROM filename from argv
-    if (!ch8_loadRomFile(&cpu, "assets/test_opcode.ch8")) {
-        ch8_logCritical("Could not load ROM");
-        exit(EXIT_FAILURE);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if (!ch8_findQuirkProfile(argv[++i], &quirks)) {
+                ch8_logWarning("Unknown quirk profile %s, using legacy", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            gridCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            streamName = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--tier-cache") == 0 && i + 1 < argc) {
+            tierCacheDir = argv[++i];
+        }
     }
 
-    // Initialize SDL and create window
+    // Keep a binary history of executed instructions, dumped on demand (F2) or on crash
+    if (traceFile != NULL) {
+        if (ch8_traceStart(CH8_TRACE_DEFAULT_CAPACITY) == 0) {
+            ch8_traceInstallCrashHandler(traceFile);
+        }
+    }
+
+    // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
         fprintf(stderr, "Could not initialize SDL: %s\n", SDL_GetError());
         exit(EXIT_FAILURE);
     }
 
-    window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 640, 320, 0);
-    if (window == NULL) {
-        fprintf(stderr, "Could not create SDL window: %s\n", SDL_GetError());
+    // Load test ROM
+    // TODO: Get ROM filename from argv
+    if (gridCount > 0) {
+        grid = ch8_gridCreate("assets/test_opcode.ch8", quirks, gridCount);
+    } else {
+        session = ch8_sessionCreate(NULL, "assets/test_opcode.ch8", quirks);
+    }
+    if (session == NULL && grid == NULL) {
+        ch8_logCritical("Could not start the emulator session");
         exit(EXIT_FAILURE);
     }
 
-    if (ch8_displayInit(static_cast<void*>(window)) != 0) {
-        ch8_logCritical("Failed to initialize the display\n");
-        exit(EXIT_FAILURE);
+    // Restarted processes start with the blocks the last run found hot
+    if (tierCacheDir != NULL) {
+        if (session == NULL) {
+            ch8_logWarning("--tier-cache is not supported with --grid");
+        } else {
+            ch8_sessionUseTierCache(session, tierCacheDir);
+        }
     }
 
-    if (ch8_audioInit() != 0) {
-        ch8_logCritical("Failed to initialize audio");
+    // Lets recorders and bots attach to the running session
+    if (streamName != NULL) {
+        if (session == NULL) {
+            ch8_logWarning("--stream is not supported with --grid");
+        } else if (ch8_sessionStartStream(session, streamName) != 0) {
+            ch8_logError("Failed to start the frame stream");
+        }
+    }
+
+    // Convert with tools/ch8_recexport
+    if (recordFile != NULL) {
+        if (session == NULL) {
+            ch8_logWarning("--record is not supported with --grid");
+        } else if (ch8_sessionStartRecording(session, recordFile) != 0) {
+            ch8_logError("Failed to start recording");
+        }
     }
 }
 
 static void cleanup(void)
 {
-    ch8_displayQuit();
-    ch8_audioQuit();
+    ch8_traceStop();
+    ch8_sessionDestroy(&session);
+    ch8_gridDestroy(&grid);
     ch8_logQuit();
 
-    if (window != NULL) {
-        SDL_DestroyWindow(window);
-        window = NULL;
-    }
-
     SDL_Quit();
 
     printf("Freed CHIP-8 VM.\n");
@@ -76,27 +115,33 @@ static void windowMessageLoop(void)
     SDL_Event event;
 
     while (SDL_PollEvent(&event)) {
-        ImGui_ImplSDL2_ProcessEvent(&event);
+        if (grid != NULL) {
+            ch8_gridHandleEvent(grid, &event);
+        } else {
+            ch8_sessionHandleEvent(session, &event);
+        }
 
         switch (event.type) {
         case SDL_QUIT:
             exit(EXIT_SUCCESS);
             break;
         case SDL_KEYDOWN: {
-            ch8_key key = __SDLKeycodeToKeyRegister(event.key.keysym.sym);
-            if (key != KEY_UNKNOWN) {
-                ch8_setKeyDown(&cpu, key);
-                if (cpu.waitFlag) {
-                    cpu.V[cpu.waitReg] = key;
-                    cpu.waitFlag = false;
-                }
+            if (event.key.keysym.sym == SDLK_F1) {
+                ch8_frameTimeToggleOverlay(grid != NULL ? ch8_gridFrameTime(grid) : ch8_sessionFrameTime(session));
+                break;
             }
-            break;
-        }
-        case SDL_KEYUP: {
-            ch8_key key = __SDLKeycodeToKeyRegister(event.key.keysym.sym);
-            if (key != KEY_UNKNOWN) {
-                ch8_setKeyUp(&cpu, key);
+            // The grid has no debugger panel
+            if (event.key.keysym.sym == SDLK_F3 && session != NULL) {
+                ch8_debugViewToggle(ch8_sessionDebugView(session));
+                break;
+            }
+            if (event.key.keysym.sym == SDLK_F4 && session != NULL) {
+                ch8_debugViewToggleHeatmap(ch8_sessionDebugView(session));
+                break;
+            }
+            if (event.key.keysym.sym == SDLK_F2 && traceFile != NULL) {
+                ch8_traceFlush(traceFile);
+                break;
             }
             break;
         }
@@ -109,8 +154,6 @@ int main(int argc, char *argv[])
     atexit(cleanup);
     initialize(argc, argv);
 
-    f32 elapsedMs = 0.0f;
-
     while (1) {
         windowMessageLoop();
 
@@ -118,12 +161,10 @@ int main(int argc, char *argv[])
 
         start = SDL_GetPerformanceCounter();
 
-        if (!cpu.waitFlag && ch8_clockCycle(&cpu, elapsedMs)) {
-            ch8_displayBeginFrame();
-            if (cpu.drawFlag) {
-                ch8_displayWriteFb(&cpu);
-            }
-            ch8_displayEndFrame();
+        if (grid != NULL) {
+            ch8_gridRunFrame(grid);
+        } else {
+            ch8_sessionRunFrame(session);
         }
 
         end = SDL_GetPerformanceCounter();
@@ -132,11 +173,5 @@ int main(int argc, char *argv[])
 
         // Cap the framerate to 60hz
         SDL_Delay((u32)SDL_floorf(16.666f - elapsed));
-
-        // Update timers
-        cpu.delayTimer = ch8_max(cpu.delayTimer - 1, 0);
-        cpu.soundTimer = ch8_max(cpu.soundTimer - 1, 0);
-
-        elapsedMs = elapsed;
     }
 }
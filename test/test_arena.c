@@ -0,0 +1,145 @@
+#include <string.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_arena.h"
+#include "../src/ch8_cpu.h"
+
+#define NUM_INSTANCES 64
+
+// V0 = 0x2A, I = 0x300, [I] = V0, loop
+static const u8 program[] = {0x60, 0x2A, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x06};
+
+ch8_arena *arena;
+
+void setUp()
+{
+    arena = ch8_arenaCreate(program, sizeof(program), CH8_QUIRKS_LEGACY, NUM_INSTANCES);
+    TEST_ASSERT_NOT_NULL(arena);
+}
+
+void tearDown()
+{
+    ch8_arenaDestroy(&arena);
+}
+
+static void test_Arena_InstancesStartFromTheLoadedProgram(void)
+{
+    TEST_ASSERT_EQUAL(NUM_INSTANCES, ch8_arenaCount(arena));
+
+    for (int i = 0; i < NUM_INSTANCES; i++) {
+        ch8_cpu *cpu = ch8_arenaGet(arena, i);
+        TEST_ASSERT_EQUAL(0, (size_t)cpu % CH8_CACHE_LINE);
+        TEST_ASSERT_EQUAL(CH8_PROGRAM_START_OFFSET, cpu->programCounter);
+        TEST_ASSERT_EQUAL_MEMORY(program, cpu->memory + CH8_PROGRAM_START_OFFSET, sizeof(program));
+    }
+}
+
+static void test_Arena_InstancesAreContiguous(void)
+{
+    size_t stride = (u8 *)ch8_arenaGet(arena, 1) - (u8 *)ch8_arenaGet(arena, 0);
+
+    TEST_ASSERT_TRUE(stride >= sizeof(ch8_cpu));
+    for (int i = 1; i < NUM_INSTANCES; i++) {
+        TEST_ASSERT_EQUAL_PTR((u8 *)ch8_arenaGet(arena, 0) + i * stride, ch8_arenaGet(arena, i));
+    }
+}
+
+static void test_Arena_GuestWritesStayPrivate(void)
+{
+    ch8_cpu *a = ch8_arenaGet(arena, 3);
+    ch8_cpu *b = ch8_arenaGet(arena, 4);
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(ch8_clockCycle(a, 0.0f));
+    }
+    a->memory[CH8_PROGRAM_START_OFFSET] = 0xFF;
+
+    TEST_ASSERT_EQUAL_HEX8(0x2A, a->memory[0x300]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, b->memory[0x300]);
+    TEST_ASSERT_EQUAL_HEX8(0x60, b->memory[CH8_PROGRAM_START_OFFSET]);
+    TEST_ASSERT_EQUAL(CH8_PROGRAM_START_OFFSET, b->programCounter);
+}
+
+static void test_Arena_ResetRestoresTheTemplate(void)
+{
+    ch8_cpu *cpu = ch8_arenaGet(arena, 0);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(ch8_clockCycle(cpu, 0.0f));
+    }
+
+    TEST_ASSERT_TRUE(ch8_arenaReset(arena, 0));
+
+    cpu = ch8_arenaGet(arena, 0);
+    TEST_ASSERT_EQUAL_HEX8(0x00, cpu->memory[0x300]);
+    TEST_ASSERT_EQUAL(0, cpu->V[0]);
+    TEST_ASSERT_EQUAL(0, cpu->cycles);
+    TEST_ASSERT_EQUAL(CH8_PROGRAM_START_OFFSET, cpu->programCounter);
+}
+
+static void test_Dirty_StoresMarkTheirPage(void)
+{
+    ch8_cpu *cpu = ch8_arenaGet(arena, 0);
+    TEST_ASSERT_EACH_EQUAL_HEX64(0, cpu->dirty, CH8_NUM_PAGES / 64);
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(ch8_clockCycle(cpu, 0.0f));
+    }
+
+    // Only 0x300 was written
+    TEST_ASSERT_EQUAL_HEX64(1ull << 3, cpu->dirty[0]);
+    for (int w = 1; w < CH8_NUM_PAGES / 64; w++) {
+        TEST_ASSERT_EQUAL_HEX64(0, cpu->dirty[w]);
+    }
+}
+
+static void test_Dirty_SyncRestoresTheBaseline(void)
+{
+    static ch8_cpu baseline;
+    ch8_cpu *cpu = ch8_arenaGet(arena, 0);
+    memcpy(&baseline, cpu, sizeof(baseline));
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(ch8_clockCycle(cpu, 0.0f));
+    }
+    TEST_ASSERT_FALSE(ch8_dirtyEqual(cpu, &baseline));
+
+    ch8_syncDirty(cpu, &baseline);
+
+    TEST_ASSERT_TRUE(ch8_dirtyEqual(cpu, &baseline));
+    TEST_ASSERT_EQUAL_MEMORY(&baseline, cpu, sizeof(baseline));
+}
+
+static void test_Dirty_EqualityComparesDirtyPages(void)
+{
+    ch8_cpu *a = ch8_arenaGet(arena, 0);
+    ch8_cpu *b = ch8_arenaGet(arena, 1);
+
+    ch8_writeMemory(a, 0x1234, 7);
+    TEST_ASSERT_FALSE(ch8_dirtyEqual(a, b));
+
+    ch8_writeMemory(b, 0x1234, 7);
+    TEST_ASSERT_TRUE(ch8_dirtyEqual(a, b));
+}
+
+static void test_Arena_RejectsOversizedPrograms(void)
+{
+    static u8 big[CH8_MAX_PROGRAM_SIZE + 1];
+    TEST_ASSERT_NULL(ch8_arenaCreate(big, sizeof(big), CH8_QUIRKS_LEGACY, 1));
+}
+
+int main(void)
+{
+    UnityBegin("test/test_arena.c");
+
+    RUN_TEST(test_Arena_InstancesStartFromTheLoadedProgram);
+    RUN_TEST(test_Arena_InstancesAreContiguous);
+    RUN_TEST(test_Arena_GuestWritesStayPrivate);
+    RUN_TEST(test_Arena_ResetRestoresTheTemplate);
+    RUN_TEST(test_Arena_RejectsOversizedPrograms);
+    RUN_TEST(test_Dirty_StoresMarkTheirPage);
+    RUN_TEST(test_Dirty_SyncRestoresTheBaseline);
+    RUN_TEST(test_Dirty_EqualityComparesDirtyPages);
+
+    return UnityEnd();
+}
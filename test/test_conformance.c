@@ -0,0 +1,142 @@
+#include <stdio.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_util.h"
+
+// Timers tick once every this many cycles when running headless
+#define CYCLES_PER_TIMER_TICK 10
+
+#define MAX_CHECKPOINTS 4
+
+typedef struct checkpoint
+{
+    u32 cycle;
+    u64 hash;
+} checkpoint;
+
+ch8_cpu chip8;
+
+void setUp()
+{
+    ch8_reset(&chip8);
+}
+
+void tearDown()
+{
+}
+
+// FNV-1a over the display packed one bit per pixel, row-major, MSB first
+static u64 hashFramebuffer(const ch8_cpu *cpu)
+{
+    u64 hash = 0xCBF29CE484222325ull;
+
+    for (int y = 0; y < CH8_DISPLAY_HEIGHT; y++) {
+        for (int x = 0; x < CH8_DISPLAY_WIDTH; x += 8) {
+            u8 byte = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                byte = (u8)(byte << 1 | (ch8_getPixel(cpu, x + bit, y) ? 1 : 0));
+            }
+            hash ^= byte;
+            hash *= 0x100000001B3ull;
+        }
+    }
+
+    return hash;
+}
+
+static void printFramebuffer(const ch8_cpu *cpu)
+{
+    for (int y = 0; y < CH8_DISPLAY_HEIGHT; y++) {
+        for (int x = 0; x < CH8_DISPLAY_WIDTH; x++) {
+            putchar(ch8_getPixel(cpu, x, y) ? '#' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+// Runs until `cycle` has been reached, the VM halts or it waits for a key
+static u32 runTo(ch8_cpu *cpu, u32 cycle)
+{
+    while (cpu->cycles < cycle && !cpu->waitFlag) {
+        if (!ch8_clockCycle(cpu, 0.0f)) {
+            break;
+        }
+        if (cpu->cycles % CYCLES_PER_TIMER_TICK == 0) {
+            cpu->delayTimer = ch8_max(cpu->delayTimer - 1, 0);
+            cpu->soundTimer = ch8_max(cpu->soundTimer - 1, 0);
+        }
+    }
+
+    return (u32)cpu->cycles;
+}
+
+static void runConformance(const char *rom, u32 quirks, const checkpoint *checkpoints, int count)
+{
+    TEST_ASSERT_TRUE_MESSAGE(ch8_loadRomFile(&chip8, rom), rom);
+    ch8_setQuirks(&chip8, quirks);
+
+    for (int i = 0; i < count; i++) {
+        runTo(&chip8, checkpoints[i].cycle);
+
+        u64 hash = hashFramebuffer(&chip8);
+        if (hash != checkpoints[i].hash) {
+            printf("%s at cycle %u: hash 0x%016llX\n", rom, checkpoints[i].cycle, (unsigned long long)hash);
+            printFramebuffer(&chip8);
+        }
+        TEST_ASSERT_EQUAL_HEX64(checkpoints[i].hash, hash);
+    }
+}
+
+// Expects "BON" and the credits once every test passed; written for in-place shifts
+static void test_BC_test_DisplaysBON(void)
+{
+    const checkpoint checkpoints[] = {
+        {300, 0xCC6C4DE8039FB294ull},
+        {3000, 0xCC6C4DE8039FB294ull},
+    };
+    runConformance("assets/BC_test.ch8", CH8_QUIRKS_SCHIP, checkpoints, 2);
+}
+
+// Expects "OK" next to each opcode group
+static void test_test_opcode_AllGroupsOK(void)
+{
+    const checkpoint checkpoints[] = {
+        {100, 0x3352A8BB05192667ull},
+        {400, 0x750793DEFF877A67ull},
+        {3000, 0x750793DEFF877A67ull},
+    };
+    runConformance("assets/test_opcode.ch8", CH8_QUIRKS_LEGACY, checkpoints, 3);
+}
+
+// Expects "OK" instead of the number of the failing test
+static void test_c8_test_DisplaysOK(void)
+{
+    const checkpoint checkpoints[] = {
+        {3000, 0x04605DECAB6C4C9Dull},
+    };
+    runConformance("assets/c8_test.c8", CH8_QUIRKS_LEGACY, checkpoints, 1);
+}
+
+// Draws "OK" and then waits for a key press
+static void test_chip8_test_rom_DisplaysOKAndWaitsForKey(void)
+{
+    const checkpoint checkpoints[] = {
+        {3000, 0x99186197910EF873ull},
+    };
+    runConformance("assets/chip8-test-rom.ch8", CH8_QUIRKS_LEGACY, checkpoints, 1);
+    TEST_ASSERT_TRUE(chip8.waitFlag);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_conformance.c");
+
+    RUN_TEST(test_BC_test_DisplaysBON);
+    RUN_TEST(test_test_opcode_AllGroupsOK);
+    RUN_TEST(test_c8_test_DisplaysOK);
+    RUN_TEST(test_chip8_test_rom_DisplaysOKAndWaitsForKey);
+
+    return UnityEnd();
+}
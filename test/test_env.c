@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_env.h"
+
+#define NUM_ENVS 40
+
+// Draws digit V0 (the held key, random at start) at 0,0, waits a frame and erases it
+static const u8 program[] = {
+    0xC0, 0x0F, // V0 = random & 0xF
+    0x00, 0xE0, // loop: CLS
+    0xF0, 0x29, // I = digit V0
+    0xD1, 0x15, // draw at V1, V1
+    0xE0, 0x9E, // skip if key V0 held
+    0x12, 0x02, // loop
+    0x00, 0x00, // halt
+};
+
+static u8 obs[NUM_ENVS * CH8_DISPLAY_HIRES_WIDTH * CH8_DISPLAY_HIRES_HEIGHT];
+static u8 other[NUM_ENVS * CH8_DISPLAY_HIRES_WIDTH * CH8_DISPLAY_HIRES_HEIGHT];
+static u16 actions[NUM_ENVS];
+static f32 rewards[NUM_ENVS];
+static bool dones[NUM_ENVS];
+static u32 seeds[NUM_ENVS];
+
+static ch8_envConfig config;
+
+static f32 rewardV0(const ch8_cpu *cpu, int, void *, bool *)
+{
+    return (f32)cpu->V[0];
+}
+
+void setUp()
+{
+    memset(&config, 0, sizeof(config));
+    config.quirks = CH8_QUIRKS_LEGACY;
+    config.framesPerStep = 2;
+    config.cyclesPerFrame = 8;
+    config.format = CH8_OBS_1BPP;
+    config.threads = 1;
+
+    memset(actions, 0, sizeof(actions));
+    for (int i = 0; i < NUM_ENVS; i++) {
+        seeds[i] = 1000 + i;
+    }
+}
+
+void tearDown()
+{
+}
+
+static void test_Env_ResetWritesPackedObservations(void)
+{
+    ch8_envBatch *batch = ch8_envBatchCreate(program, sizeof(program), NUM_ENVS, &config);
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_EQUAL(CH8_DISPLAY_WIDTH * CH8_DISPLAY_HEIGHT / 8, ch8_envBatchObsSize(batch));
+
+    memset(obs, 0xAA, sizeof(obs));
+    ch8_envBatchReset(batch, seeds, obs);
+
+    TEST_ASSERT_EACH_EQUAL_HEX8(0, obs, NUM_ENVS * ch8_envBatchObsSize(batch));
+    ch8_envBatchDestroy(&batch);
+}
+
+static void test_Env_StepDrawsAndRewards(void)
+{
+    config.reward = rewardV0;
+    ch8_envBatch *batch = ch8_envBatchCreate(program, sizeof(program), NUM_ENVS, &config);
+    ch8_envBatchReset(batch, seeds, obs);
+    ch8_envBatchStep(batch, actions, obs, rewards, dones);
+
+    for (int i = 0; i < NUM_ENVS; i++) {
+        const ch8_cpu *cpu = ch8_envBatchCpu(batch, i);
+        const u8 *o = obs + i * ch8_envBatchObsSize(batch);
+
+        TEST_ASSERT_EQUAL_FLOAT((f32)cpu->V[0], rewards[i]);
+        TEST_ASSERT_FALSE(dones[i]);
+        for (int y = 0; y < 5; y++) {
+            TEST_ASSERT_EQUAL_HEX8(cpu->memory[cpu->V[0] * 5 + y], o[y * CH8_DISPLAY_WIDTH / 8]);
+        }
+    }
+    ch8_envBatchDestroy(&batch);
+}
+
+static void test_Env_ThreadsDoNotChangeResults(void)
+{
+    ch8_envBatch *single = ch8_envBatchCreate(program, sizeof(program), NUM_ENVS, &config);
+    config.threads = 4;
+    ch8_envBatch *pooled = ch8_envBatchCreate(program, sizeof(program), NUM_ENVS, &config);
+
+    ch8_envBatchReset(single, seeds, obs);
+    ch8_envBatchReset(pooled, seeds, other);
+    for (int step = 0; step < 20; step++) {
+        for (int i = 0; i < NUM_ENVS; i++) {
+            actions[i] = (u16)(1 << ((i + step) % 16));
+        }
+        ch8_envBatchStep(single, actions, obs, rewards, dones);
+        ch8_envBatchStep(pooled, actions, other, rewards, dones);
+        TEST_ASSERT_EQUAL_MEMORY(obs, other, NUM_ENVS * ch8_envBatchObsSize(single));
+    }
+
+    ch8_envBatchDestroy(&single);
+    ch8_envBatchDestroy(&pooled);
+}
+
+static void test_Env_HaltEndsAndRestartsTheEpisode(void)
+{
+    ch8_envBatch *batch = ch8_envBatchCreate(program, sizeof(program), 1, &config);
+    ch8_envBatchReset(batch, seeds, obs);
+
+    // Hold the key being drawn so the program falls through to 0000
+    actions[0] = (u16)(1 << ch8_envBatchCpu(batch, 0)->V[0]);
+    ch8_envBatchStep(batch, actions, obs, rewards, dones);
+    TEST_ASSERT_TRUE(dones[0]);
+
+    actions[0] = 0;
+    ch8_envBatchStep(batch, actions, obs, rewards, dones);
+    TEST_ASSERT_FALSE(dones[0]);
+    TEST_ASSERT_EQUAL(config.framesPerStep * config.cyclesPerFrame, ch8_envBatchCpu(batch, 0)->cycles);
+
+    ch8_envBatchDestroy(&batch);
+}
+
+static void test_Env_HiresU8DoublesLowResolution(void)
+{
+    config.format = CH8_OBS_U8;
+    config.hires = true;
+    ch8_envBatch *batch = ch8_envBatchCreate(program, sizeof(program), 1, &config);
+    TEST_ASSERT_EQUAL(CH8_DISPLAY_HIRES_WIDTH * CH8_DISPLAY_HIRES_HEIGHT, ch8_envBatchObsSize(batch));
+
+    ch8_envBatchReset(batch, seeds, obs);
+    ch8_envBatchStep(batch, actions, obs, rewards, dones);
+
+    const ch8_cpu *cpu = ch8_envBatchCpu(batch, 0);
+    for (int y = 0; y < 10; y++) {
+        for (int x = 0; x < 16; x++) {
+            TEST_ASSERT_EQUAL(ch8_getPixel(cpu, x / 2, y / 2), obs[y * CH8_DISPLAY_HIRES_WIDTH + x]);
+        }
+    }
+    ch8_envBatchDestroy(&batch);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_env.c");
+
+    RUN_TEST(test_Env_ResetWritesPackedObservations);
+    RUN_TEST(test_Env_StepDrawsAndRewards);
+    RUN_TEST(test_Env_ThreadsDoNotChangeResults);
+    RUN_TEST(test_Env_HaltEndsAndRestartsTheEpisode);
+    RUN_TEST(test_Env_HiresU8DoublesLowResolution);
+
+    return UnityEnd();
+}
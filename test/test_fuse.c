@@ -0,0 +1,78 @@
+#include "vendor/unity.h"
+#include "test_helpers.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_fuse.h"
+
+static ch8_cpu reference;
+static ch8_cpu fused;
+
+void setUp()
+{
+    ch8_reset(&reference);
+}
+
+void tearDown()
+{
+}
+
+static void load(const u16 *program, size_t count, u32 quirks)
+{
+    loadProgram(&reference, &fused, program, count, quirks);
+}
+
+static void runBoth(u32 budget)
+{
+    runAgainstInterpreter(&reference, &fused, ch8_fuseRun, 1, budget);
+}
+
+static void test_Fuse_TimerWaitMatchesReference(void)
+{
+    // V0 = 5, DT = V0, then wait for it: F107 3100 1204
+    const u16 program[] = {0x6005, 0xF015, 0xF107, 0x3100, 0x1204, 0x6201, 0x120C};
+    load(program, sizeof(program) / sizeof(program[0]), CH8_QUIRKS_LEGACY);
+
+    for (int frame = 0; frame < 8; frame++) {
+        runBoth(1000);
+        if (reference.delayTimer > 0) {
+            reference.delayTimer--;
+            fused.delayTimer--;
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX16(0x20C, fused.programCounter);
+    TEST_ASSERT_EQUAL(1, fused.V[2]);
+}
+
+static void test_Fuse_BudgetEndingMidSequenceMatchesReference(void)
+{
+    // Count V0 up by 3 until it reaches 0x30, then draw digit 0 and load registers
+    const u16 program[] = {0x6000, 0x7003, 0x3030, 0x1202, 0xA050, 0xD015, 0xA200, 0xF365, 0x1210};
+    for (u32 budget = 1; budget <= 8; budget++) {
+        load(program, sizeof(program) / sizeof(program[0]), CH8_QUIRKS_COSMAC);
+        while (reference.programCounter != 0x210) {
+            runBoth(budget);
+        }
+    }
+}
+
+static void test_Fuse_JumpIntoSequenceRunsFromTarget(void)
+{
+    // 0x204-0x207 would fuse as A214 D015, but the jump lands on the draw with I still at 0x20A
+    const u16 program[] = {0xA20A, 0x1206, 0xA214, 0xD015, 0x1208, 0xF0F0, 0xF0F0, 0xF000, 0x0000, 0x0000, 0xFFFF};
+    load(program, sizeof(program) / sizeof(program[0]), CH8_QUIRKS_LEGACY);
+
+    runBoth(100);
+    TEST_ASSERT_EQUAL_HEX16(0x20A, fused.index);
+    TEST_ASSERT_EQUAL_HEX64(0xF0ull << 56, fused.framebuffer[0][0][0]);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_fuse.c");
+
+    RUN_TEST(test_Fuse_TimerWaitMatchesReference);
+    RUN_TEST(test_Fuse_BudgetEndingMidSequenceMatchesReference);
+    RUN_TEST(test_Fuse_JumpIntoSequenceRunsFromTarget);
+
+    return UnityEnd();
+}
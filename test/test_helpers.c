@@ -0,0 +1,34 @@
+#include "test_helpers.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "vendor/unity.h"
+
+void loadProgram(ch8_cpu *reference, ch8_cpu *engine, const u16 *program, size_t count, u32 quirks)
+{
+    u8 bytes[64];
+    assert(count * 2 <= sizeof(bytes));
+    for (size_t i = 0; i < count; i++) {
+        bytes[i * 2] = program[i] >> 8;
+        bytes[i * 2 + 1] = program[i] & 0xFF;
+    }
+
+    ch8_reset(reference);
+    ch8_setQuirks(reference, quirks);
+    ch8_loadRomData(reference, bytes, count * 2);
+    memcpy(engine, reference, sizeof(ch8_cpu));
+}
+
+void runAgainstInterpreter(ch8_cpu *reference, ch8_cpu *engine, engineRunFn run, u32 slices, u32 budget)
+{
+    for (u32 s = 0; s < slices; s++) {
+        u32 expected = 0;
+        while (expected < budget && !reference->waitFlag && ch8_clockCycle(reference, 0.0f)) {
+            expected++;
+        }
+
+        TEST_ASSERT_EQUAL_UINT32(expected, run(engine, budget));
+        TEST_ASSERT_EQUAL_MEMORY(reference, engine, sizeof(ch8_cpu));
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef __TEST_HELPERS_H__
+#define __TEST_HELPERS_H__
+
+/*
+ * Shared by the suites that check an execution engine against the
+ * interpreter: both VMs start from the same program and must end every
+ * budget in the same state.
+ */
+
+#include "../src/ch8_cpu.h"
+
+/* Runs `cpu` for up to `budget` instructions the way ch8_backendRun does */
+typedef u32 (*engineRunFn)(ch8_cpu *cpu, u32 budget);
+
+/* Loads `count` opcodes into a reset `reference` with `quirks` and copies it to `engine` */
+void loadProgram(ch8_cpu *reference, ch8_cpu *engine, const u16 *program, size_t count, u32 quirks);
+
+/* Runs both VMs in `slices` slices of `budget`, `reference` on the interpreter; asserts the whole state matches after each */
+void runAgainstInterpreter(ch8_cpu *reference, ch8_cpu *engine, engineRunFn run, u32 slices, u32 budget);
+
+#endif
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "vendor/unity.h"
 
 #include "../src/ch8_opcodes.h"
@@ -18,15 +20,16 @@ void tearDown()
 static void test_00E0_ClearScreen_SetsAllPixelsTo0(void)
 {
     // arrange
-    for (int i = 0; i < CH8_DISPLAY_SIZE; i++) {
-        chip8.framebuffer[i] = ch8_randU8();
+    for (int y = 0; y < CH8_DISPLAY_HIRES_HEIGHT; y++) {
+        chip8.framebuffer[0][y][0] = ch8_randU16();
+        chip8.framebuffer[0][y][1] = ch8_randU16();
     }
 
     // act
     ch8_op_ClearDisplay(&chip8);
 
     // assert
-    TEST_ASSERT_EACH_EQUAL_UINT8(0, chip8.framebuffer, CH8_DISPLAY_SIZE);
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, (const u8 *)chip8.framebuffer, sizeof(chip8.framebuffer));
 }
 
 // 00EE
@@ -379,7 +382,7 @@ static void test_BXNN_JumpOffset_SetsPCToNNPlusVX(void)
 {
     chip8.V[1] = 0x04;
     ch8_op_JumpOffset(&chip8, 0xB199);
-    TEST_ASSERT_EQUAL(157, chip8.programCounter);
+    TEST_ASSERT_EQUAL(0x19D, chip8.programCounter);
 }
 
 // CXNN
@@ -407,7 +410,7 @@ static void test_DXYN_DrawSprite_SetsTheDrawFlag(void)
 // EX9E
 static void test_EX9E_KeyDown_SkipsNextInstructionIfKeyIsDown(void)
 {
-    chip8.keypad[8] = true;
+    chip8.keypad |= 1 << 8;
     chip8.programCounter = 5;
 
     ch8_op_KeyEquals(&chip8, 0xE89E);
@@ -417,8 +420,8 @@ static void test_EX9E_KeyDown_SkipsNextInstructionIfKeyIsDown(void)
 
 static void test_EX9E_KeyDown_DoesNotSkipNextInstructionIfKeyUp(void)
 {
-    chip8.keypad[8] = true;
-    chip8.keypad[4] = false;
+    chip8.keypad |= 1 << 8;
+    chip8.keypad &= ~(1 << 4);
     chip8.programCounter = 5;
 
     ch8_op_KeyEquals(&chip8, 0xE49E);
@@ -429,8 +432,8 @@ static void test_EX9E_KeyDown_DoesNotSkipNextInstructionIfKeyUp(void)
 // EXA1
 static void test_EXA1_KeyUp_SkipsNextInstructionIfKeyUp(void)
 {
-    chip8.keypad[8] = false;
-    chip8.keypad[2] = true;
+    chip8.keypad &= ~(1 << 8);
+    chip8.keypad |= 1 << 2;
     chip8.programCounter = 5;
 
     ch8_op_KeyNotEquals(&chip8, 0xE8A1);
@@ -440,7 +443,7 @@ static void test_EXA1_KeyUp_SkipsNextInstructionIfKeyUp(void)
 
 static void test_EXA1_KeyUp_DoesNotSkipNextInstructionIfKeyDown(void)
 {
-    chip8.keypad[4] = true;
+    chip8.keypad |= 1 << 4;
     chip8.programCounter = 5;
 
     ch8_op_KeyNotEquals(&chip8, 0xE4A1);
@@ -570,6 +573,383 @@ static void test_FX65_Load_LoadsV0ToVXFromMemory(void)
     //TEST_ASSERT_EQUAL(2083, chip8.index_register); /* I = I + x + 1 */
 }
 
+// 00FF
+static void test_00FF_HighRes_SwitchesResolutionAndClears(void)
+{
+    chip8.framebuffer[0][0][0] = 1;
+    chip8.programCounter = 212;
+
+    ch8_op_HighRes(&chip8);
+
+    TEST_ASSERT_TRUE(chip8.hires);
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][0][0]);
+    TEST_ASSERT_EQUAL(214, chip8.programCounter);
+}
+
+// 00CN
+static void test_00CN_ScrollDown_MovesRowsDownByN(void)
+{
+    chip8.framebuffer[0][0][0] = 0xF0;
+    chip8.framebuffer[0][CH8_DISPLAY_HEIGHT - 1][0] = 0xFF;
+
+    ch8_op_ScrollDown(&chip8, 0x00C3);
+
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][0][0]);
+    TEST_ASSERT_EQUAL_HEX64(0xF0, chip8.framebuffer[0][3][0]);
+    // Rows scrolled past the bottom of the low resolution screen are gone
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][CH8_DISPLAY_HEIGHT + 2][0]);
+}
+
+// 00FB
+static void test_00FB_ScrollRight_CarriesPixelsAcrossWordsInHighRes(void)
+{
+    chip8.hires = true;
+    chip8.framebuffer[0][5][0] = 0xF;
+
+    ch8_op_ScrollRight(&chip8);
+
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][5][0]);
+    TEST_ASSERT_EQUAL_HEX64(0xF000000000000000ull, chip8.framebuffer[0][5][1]);
+}
+
+static void test_00FB_ScrollRight_DropsPixelsPastTheLowResEdge(void)
+{
+    chip8.framebuffer[0][5][0] = 0xF;
+
+    ch8_op_ScrollRight(&chip8);
+
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][5][0]);
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][5][1]);
+}
+
+// 00FC
+static void test_00FC_ScrollLeft_MovesPixelsLeftBy4(void)
+{
+    chip8.hires = true;
+    chip8.framebuffer[0][5][1] = 0xF000000000000000ull;
+
+    ch8_op_ScrollLeft(&chip8);
+
+    TEST_ASSERT_EQUAL_HEX64(0xF, chip8.framebuffer[0][5][0]);
+    TEST_ASSERT_EQUAL_HEX64(0, chip8.framebuffer[0][5][1]);
+}
+
+// DXY0
+static void test_DXY0_DrawSprite_Draws16x16SpriteInHighRes(void)
+{
+    chip8.hires = true;
+    chip8.index = 0x400;
+    for (int i = 0; i < 32; i++) {
+        chip8.memory[0x400 + i] = 0xFF;
+    }
+    chip8.V[0] = 60;
+    chip8.V[1] = 40;
+
+    ch8_op_DrawSprite(&chip8, 0xD010);
+
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 60, 40));
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 75, 55));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 76, 55));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 60, 56));
+    TEST_ASSERT_EQUAL(0, chip8.V[0xF]);
+}
+
+// FX30
+static void test_FX30_SetBigFontChar_PointsIndexAtTheDigit(void)
+{
+    chip8.V[2] = 7;
+
+    ch8_op_SetBigFontChar(&chip8, 0xF230);
+
+    TEST_ASSERT_EQUAL(CH8_BIG_FONT_OFFSET + 70, chip8.index);
+}
+
+// FX75 / FX85
+static void test_FX75_FX85_FlagsRoundTripV0ToVX(void)
+{
+    chip8.V[0] = 1;
+    chip8.V[1] = 2;
+    chip8.V[2] = 3;
+
+    ch8_op_StoreFlags(&chip8, 0xF175);
+    chip8.V[0] = 0;
+    chip8.V[1] = 0;
+    chip8.V[2] = 0;
+    ch8_op_LoadFlags(&chip8, 0xF285);
+
+    TEST_ASSERT_EQUAL(1, chip8.V[0]);
+    TEST_ASSERT_EQUAL(2, chip8.V[1]);
+    TEST_ASSERT_EQUAL(0, chip8.V[2]);
+}
+
+// F000 NNNN
+static void test_F000_SetIndexLong_LoadsTheFollowingWord(void)
+{
+    chip8.programCounter = 0x300;
+    chip8.memory[0x302] = 0xAB;
+    chip8.memory[0x303] = 0xCD;
+
+    ch8_op_SetIndexLong(&chip8);
+
+    TEST_ASSERT_EQUAL_HEX16(0xABCD, chip8.index);
+    TEST_ASSERT_EQUAL(0x304, chip8.programCounter);
+}
+
+static void test_3XNN_SkipEquals_SkipsAllOfALongInstruction(void)
+{
+    chip8.programCounter = 0x300;
+    chip8.memory[0x302] = 0xF0;
+    chip8.memory[0x303] = 0x00;
+
+    ch8_op_SkipEquals(&chip8, 0x3000);
+
+    TEST_ASSERT_EQUAL(0x306, chip8.programCounter);
+}
+
+// 5XY2
+static void test_5XY2_StoreRange_StoresVXToVYInEitherOrder(void)
+{
+    chip8.index = 0x400;
+    chip8.V[2] = 2;
+    chip8.V[3] = 3;
+    chip8.V[4] = 4;
+
+    ch8_op_StoreRange(&chip8, 0x5422);
+
+    TEST_ASSERT_EQUAL(4, chip8.memory[0x400]);
+    TEST_ASSERT_EQUAL(3, chip8.memory[0x401]);
+    TEST_ASSERT_EQUAL(2, chip8.memory[0x402]);
+    TEST_ASSERT_EQUAL(0x400, chip8.index);
+}
+
+// 5XY3
+static void test_5XY3_LoadRange_LoadsVXToVYWithoutMovingIndex(void)
+{
+    chip8.index = 0x8000;
+    chip8.memory[0x8000] = 7;
+    chip8.memory[0x8001] = 8;
+
+    ch8_op_LoadRange(&chip8, 0x5563);
+
+    TEST_ASSERT_EQUAL(7, chip8.V[5]);
+    TEST_ASSERT_EQUAL(8, chip8.V[6]);
+    TEST_ASSERT_EQUAL(0x8000, chip8.index);
+}
+
+// FN01
+static void test_FN01_SelectPlanes_DrawsOneSpritePerPlane(void)
+{
+    chip8.index = 0x400;
+    chip8.memory[0x400] = 0x80; // first plane
+    chip8.memory[0x401] = 0xC0; // second plane
+
+    ch8_op_SelectPlanes(&chip8, 0xF301);
+    ch8_op_DrawSprite(&chip8, 0xD011);
+
+    TEST_ASSERT_EQUAL(3, ch8_getPixelColor(&chip8, 0, 0));
+    TEST_ASSERT_EQUAL(2, ch8_getPixelColor(&chip8, 1, 0));
+    TEST_ASSERT_EQUAL(0, ch8_getPixelColor(&chip8, 2, 0));
+}
+
+// Stack faults
+static void test_2NNN_CallSub_FaultsWhenTheStackIsFull(void)
+{
+    chip8.stackPointer = CH8_STACK_DEPTH;
+    chip8.programCounter = 0x300;
+
+    ch8_op_CallSub(&chip8, 0x2400);
+
+    TEST_ASSERT_EQUAL(CH8_FAULT_STACK_OVERFLOW, chip8.fault);
+    TEST_ASSERT_EQUAL(CH8_STACK_DEPTH, chip8.stackPointer);
+    TEST_ASSERT_EQUAL(0x300, chip8.programCounter);
+}
+
+static void test_00EE_ReturnFromSub_FaultsWhenTheStackIsEmpty(void)
+{
+    chip8.programCounter = 0x300;
+    chip8.memory[0x300] = 0x00;
+    chip8.memory[0x301] = 0xEE;
+
+    TEST_ASSERT_FALSE(ch8_clockCycle(&chip8, 0.0f));
+    TEST_ASSERT_EQUAL(CH8_FAULT_STACK_UNDERFLOW, chip8.fault);
+    TEST_ASSERT_EQUAL(0, chip8.stackPointer);
+    // Stays stopped until reset
+    TEST_ASSERT_FALSE(ch8_clockCycle(&chip8, 0.0f));
+}
+
+static void test_Snapshot_RestoresWithMemcpy(void)
+{
+    static ch8_cpu snapshot;
+    chip8.V[1] = 5;
+    ch8_op_CallSub(&chip8, 0x2400);
+    memcpy(&snapshot, &chip8, sizeof(chip8));
+
+    ch8_reset(&chip8);
+    memcpy(&chip8, &snapshot, sizeof(chip8));
+    ch8_op_ReturnFromSub(&chip8);
+
+    TEST_ASSERT_EQUAL(5, chip8.V[1]);
+    TEST_ASSERT_EQUAL(0, chip8.stackPointer);
+    TEST_ASSERT_EQUAL(CH8_PROGRAM_START_OFFSET + 2, chip8.programCounter);
+}
+
+// Quirk profiles, run through the specialized interpreter
+static void execute(u32 quirks, u16 opcode)
+{
+    ch8_setQuirks(&chip8, quirks);
+    chip8.memory[chip8.programCounter] = opcode >> 8;
+    chip8.memory[chip8.programCounter + 1] = opcode & 0xFF;
+    TEST_ASSERT_TRUE(ch8_clockCycle(&chip8, 0.0f));
+}
+
+static void test_8XY6_BitshiftRight_ShiftsVYByDefault(void)
+{
+    chip8.V[1] = 0x10;
+    chip8.V[2] = 0x05;
+    execute(CH8_QUIRKS_LEGACY, 0x8126);
+    TEST_ASSERT_EQUAL(0x02, chip8.V[1]);
+    TEST_ASSERT_EQUAL(1, chip8.V[0xF]);
+}
+
+static void test_8XY6_BitshiftRight_ShiftsVXWithShiftQuirk(void)
+{
+    chip8.V[1] = 0x10;
+    chip8.V[2] = 0x05;
+    execute(CH8_QUIRKS_SCHIP, 0x8126);
+    TEST_ASSERT_EQUAL(0x08, chip8.V[1]);
+    TEST_ASSERT_EQUAL(0, chip8.V[0xF]);
+}
+
+static void test_8XYE_BitshiftLeft_KeepsShiftedOutBitInVF(void)
+{
+    chip8.V[0xF] = 0x81;
+    execute(CH8_QUIRKS_SCHIP, 0x8FFE);
+    TEST_ASSERT_EQUAL(1, chip8.V[0xF]);
+}
+
+static void test_8XY1_LogicalOr_ResetsVFWithVFQuirk(void)
+{
+    chip8.V[0xF] = 1;
+    execute(CH8_QUIRKS_COSMAC, 0x8121);
+    TEST_ASSERT_EQUAL(0, chip8.V[0xF]);
+}
+
+static void test_BNNN_JumpOffset_UsesV0WithoutJumpQuirk(void)
+{
+    chip8.V[0] = 0x02;
+    chip8.V[3] = 0x40;
+    execute(CH8_QUIRKS_COSMAC, 0xB300);
+    TEST_ASSERT_EQUAL(0x302, chip8.programCounter);
+}
+
+static void test_FX55_Store_IncrementsIndexWithIndexQuirk(void)
+{
+    chip8.index = 0x400;
+    execute(CH8_QUIRKS_COSMAC, 0xF355);
+    TEST_ASSERT_EQUAL(0x404, chip8.index);
+}
+
+static void test_DXYN_DrawSprite_ClipsAtTheEdgeByDefault(void)
+{
+    chip8.index = 0x400;
+    chip8.memory[0x400] = 0xFF;
+    chip8.V[0] = CH8_DISPLAY_WIDTH - 4;
+    execute(CH8_QUIRKS_LEGACY, 0xD011);
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, CH8_DISPLAY_WIDTH - 1, 0));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 0, 0));
+}
+
+static void test_DXYN_DrawSprite_WrapsWithWrapQuirk(void)
+{
+    chip8.index = 0x400;
+    chip8.memory[0x400] = 0xFF;
+    chip8.V[0] = CH8_DISPLAY_WIDTH - 4;
+    execute(CH8_QUIRKS_XOCHIP, 0xD011);
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, CH8_DISPLAY_WIDTH - 1, 0));
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 3, 0));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 4, 0));
+}
+
+static void test_DXY0_DrawSprite_LowResSizeDependsOnProfile(void)
+{
+    chip8.index = 0x400;
+    for (int i = 0; i < 32; i++) {
+        chip8.memory[0x400 + i] = 0xFF;
+    }
+
+    // Nothing on the VIP
+    execute(CH8_QUIRKS_COSMAC, 0xD010);
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 0, 0));
+
+    // 8x16 on SUPER-CHIP
+    chip8.programCounter = CH8_PROGRAM_START_OFFSET;
+    execute(CH8_QUIRKS_SCHIP, 0xD010);
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 7, 15));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 8, 0));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 0, 16));
+    TEST_ASSERT_EQUAL(0, chip8.V[0xF]);
+
+    // 16x16 on XO-CHIP, colliding with the SUPER-CHIP sprite
+    chip8.programCounter = CH8_PROGRAM_START_OFFSET;
+    execute(CH8_QUIRKS_XOCHIP, 0xD010);
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 7, 15));
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 15, 15));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 16, 0));
+    TEST_ASSERT_EQUAL(1, chip8.V[0xF]);
+}
+
+static void test_0NNN_MachineCodeCall_DoesNotScroll(void)
+{
+    chip8.framebuffer[0][0][0] = 0xF0;
+    execute(CH8_QUIRKS_SCHIP, 0x01C3);
+    TEST_ASSERT_EQUAL_HEX64(0xF0, chip8.framebuffer[0][0][0]);
+}
+
+static void test_VipLayout_MirrorsTheStackIntoMemory(void)
+{
+    chip8.programCounter = 0x234;
+    execute(CH8_QUIRKS_VIP, 0x2400);
+    TEST_ASSERT_EQUAL_HEX8(0x02, chip8.memory[CH8_CALL_STACK_OFFSET]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, chip8.memory[CH8_CALL_STACK_OFFSET + 1]);
+}
+
+static void test_VipLayout_StoresIntoDisplayMemoryDraw(void)
+{
+    chip8.index = CH8_DISPLAY_REFRESH_OFFSET;
+    chip8.V[0] = 0x80;
+    execute(CH8_QUIRKS_VIP, 0xF055);
+    TEST_ASSERT_TRUE(ch8_getPixel(&chip8, 0, 0));
+    TEST_ASSERT_FALSE(ch8_getPixel(&chip8, 1, 0));
+}
+
+static void test_VipLayout_MirrorsOnlyWhatChanged(void)
+{
+    ch8_setQuirks(&chip8, CH8_QUIRKS_VIP);
+    ch8_markClean(&chip8);
+
+    const u8 program[] = {0x60, 0x00, 0x61, 0x03, 0xD0, 0x15};
+    memcpy(chip8.memory + CH8_PROGRAM_START_OFFSET, program, sizeof(program));
+    TEST_ASSERT_TRUE(ch8_clockCycle(&chip8, 0.0f));
+    TEST_ASSERT_TRUE(ch8_clockCycle(&chip8, 0.0f));
+    for (int w = 0; w < CH8_NUM_PAGES / 64; w++) {
+        TEST_ASSERT_EQUAL_HEX64(0, chip8.dirty[w]);
+    }
+
+    // Digit 0 at row 3 is copied; only the display page changes
+    TEST_ASSERT_TRUE(ch8_clockCycle(&chip8, 0.0f));
+    TEST_ASSERT_EQUAL_HEX8(0xF0, chip8.memory[CH8_DISPLAY_REFRESH_OFFSET + 3 * 8]);
+    TEST_ASSERT_EQUAL_HEX8(0x90, chip8.memory[CH8_DISPLAY_REFRESH_OFFSET + 4 * 8]);
+    TEST_ASSERT_EQUAL_HEX64(1ull << (CH8_DISPLAY_REFRESH_OFFSET >> CH8_PAGE_SHIFT), chip8.dirty[0]);
+}
+
+static void test_Quirks_FindsProfilesByName(void)
+{
+    u32 quirks = 0;
+    TEST_ASSERT_TRUE(ch8_findQuirkProfile("schip", &quirks));
+    TEST_ASSERT_EQUAL(CH8_QUIRKS_SCHIP, quirks);
+    TEST_ASSERT_FALSE(ch8_findQuirkProfile("chip-9", &quirks));
+}
+
 int main()
 {
     UnityBegin("test/test_opcodes.c");
@@ -656,5 +1036,43 @@ int main()
     RUN_TEST(test_FX55_Store_StoresV0ToVXInMemory);
     RUN_TEST(test_FX65_Load_LoadsV0ToVXFromMemory);
 
+    // SCHIP
+    RUN_TEST(test_00FF_HighRes_SwitchesResolutionAndClears);
+    RUN_TEST(test_00CN_ScrollDown_MovesRowsDownByN);
+    RUN_TEST(test_00FB_ScrollRight_CarriesPixelsAcrossWordsInHighRes);
+    RUN_TEST(test_00FB_ScrollRight_DropsPixelsPastTheLowResEdge);
+    RUN_TEST(test_00FC_ScrollLeft_MovesPixelsLeftBy4);
+    RUN_TEST(test_DXY0_DrawSprite_Draws16x16SpriteInHighRes);
+    RUN_TEST(test_FX30_SetBigFontChar_PointsIndexAtTheDigit);
+    RUN_TEST(test_FX75_FX85_FlagsRoundTripV0ToVX);
+
+    // XO-CHIP
+    RUN_TEST(test_F000_SetIndexLong_LoadsTheFollowingWord);
+    RUN_TEST(test_3XNN_SkipEquals_SkipsAllOfALongInstruction);
+    RUN_TEST(test_5XY2_StoreRange_StoresVXToVYInEitherOrder);
+    RUN_TEST(test_5XY3_LoadRange_LoadsVXToVYWithoutMovingIndex);
+    RUN_TEST(test_FN01_SelectPlanes_DrawsOneSpritePerPlane);
+
+    // Stack
+    RUN_TEST(test_2NNN_CallSub_FaultsWhenTheStackIsFull);
+    RUN_TEST(test_00EE_ReturnFromSub_FaultsWhenTheStackIsEmpty);
+    RUN_TEST(test_Snapshot_RestoresWithMemcpy);
+
+    // Quirks
+    RUN_TEST(test_8XY6_BitshiftRight_ShiftsVYByDefault);
+    RUN_TEST(test_8XY6_BitshiftRight_ShiftsVXWithShiftQuirk);
+    RUN_TEST(test_8XYE_BitshiftLeft_KeepsShiftedOutBitInVF);
+    RUN_TEST(test_8XY1_LogicalOr_ResetsVFWithVFQuirk);
+    RUN_TEST(test_BNNN_JumpOffset_UsesV0WithoutJumpQuirk);
+    RUN_TEST(test_FX55_Store_IncrementsIndexWithIndexQuirk);
+    RUN_TEST(test_DXYN_DrawSprite_ClipsAtTheEdgeByDefault);
+    RUN_TEST(test_DXYN_DrawSprite_WrapsWithWrapQuirk);
+    RUN_TEST(test_DXY0_DrawSprite_LowResSizeDependsOnProfile);
+    RUN_TEST(test_0NNN_MachineCodeCall_DoesNotScroll);
+    RUN_TEST(test_VipLayout_MirrorsTheStackIntoMemory);
+    RUN_TEST(test_VipLayout_StoresIntoDisplayMemoryDraw);
+    RUN_TEST(test_VipLayout_MirrorsOnlyWhatChanged);
+    RUN_TEST(test_Quirks_FindsProfilesByName);
+
     return UnityEnd();
 }
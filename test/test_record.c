@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_record.h"
+
+#define NUM_FRAMES 200
+
+static char path[64];
+static ch8_cpu cpu;
+
+void setUp()
+{
+    snprintf(path, sizeof(path), "/tmp/ch8-test-%d.ch8rec", (int)getpid());
+    ch8_reset(&cpu);
+}
+
+void tearDown()
+{
+    remove(path);
+}
+
+// Frame n's picture: a moving line, with every word flipped every 50th frame
+static void drawFrame(ch8_cpu *cpu, int n)
+{
+    memset(cpu->framebuffer, 0, sizeof(cpu->framebuffer));
+    cpu->framebuffer[n % 2][n % CH8_DISPLAY_HIRES_HEIGHT][1] = 0x0123456789ABCDEFull << (n % 64);
+    if (n % 50 == 0) {
+        memset(cpu->framebuffer, n & 0xFF, sizeof(cpu->framebuffer));
+    }
+    cpu->hires = (n / 10) % 2;
+    cpu->soundTimer = n % 3 == 0 ? 5 : 0;
+}
+
+static void test_Record_FramesRoundTrip(void)
+{
+    ch8_recorder *recorder = ch8_recorderCreate(path);
+    TEST_ASSERT_NOT_NULL(recorder);
+    for (int n = 0; n < NUM_FRAMES; n++) {
+        drawFrame(&cpu, n);
+        ch8_recorderCapture(recorder, &cpu);
+        // Let the writer keep up so no frames are dropped
+        if (n % 32 == 31) {
+            usleep(30000);
+        }
+    }
+    ch8_recorderDestroy(&recorder);
+    TEST_ASSERT_NULL(recorder);
+
+    ch8_recording *recording = ch8_recordingOpen(path);
+    TEST_ASSERT_NOT_NULL(recording);
+
+    static ch8_recordFrame frame;
+    for (int n = 0; n < NUM_FRAMES; n++) {
+        TEST_ASSERT_TRUE(ch8_recordingNext(recording, &frame));
+        drawFrame(&cpu, n);
+        TEST_ASSERT_EQUAL_MEMORY(cpu.framebuffer, frame.framebuffer, sizeof(frame.framebuffer));
+        TEST_ASSERT_EQUAL(cpu.hires, (frame.flags & CH8_RECORD_HIRES) != 0);
+        TEST_ASSERT_EQUAL(cpu.soundTimer > 0, (frame.flags & CH8_RECORD_SOUND) != 0);
+    }
+    TEST_ASSERT_FALSE(ch8_recordingNext(recording, &frame));
+
+    ch8_recordingClose(&recording);
+}
+
+static void test_Record_UnchangedFramesAreTiny(void)
+{
+    ch8_recorder *recorder = ch8_recorderCreate(path);
+    TEST_ASSERT_NOT_NULL(recorder);
+    for (int n = 0; n < 10; n++) {
+        ch8_recorderCapture(recorder, &cpu);
+    }
+    ch8_recorderDestroy(&recorder);
+
+    // Header plus, per frame, 3 bytes of record header and one token per 128 unchanged bytes
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 0, SEEK_END);
+    TEST_ASSERT_EQUAL(16 + 10 * (3 + CH8_RECORD_FRAME_BYTES / 128), ftell(f));
+    fclose(f);
+}
+
+static void test_Record_RejectsOtherFiles(void)
+{
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("not a recording at all", f);
+    fclose(f);
+
+    TEST_ASSERT_NULL(ch8_recordingOpen(path));
+}
+
+int main(void)
+{
+    UnityBegin("test/test_record.c");
+
+    RUN_TEST(test_Record_FramesRoundTrip);
+    RUN_TEST(test_Record_UnchangedFramesAreTiny);
+    RUN_TEST(test_Record_RejectsOtherFiles);
+
+    return UnityEnd();
+}
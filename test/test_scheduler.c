@@ -0,0 +1,144 @@
+#include <string.h>
+#include <time.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_scheduler.h"
+
+#define NUM_SESSIONS 32
+
+// Counts up in V0 forever
+static const u8 counter[] = {0x70, 0x01, 0x12, 0x00};
+// V1 = key, then jumps to itself
+static const u8 waitKey[] = {0xF1, 0x0A, 0x12, 0x02};
+// DT = 30, waits for it with F107 3100 1204, then V2 = 1 and jumps to itself
+static const u8 waitTimer[] = {0x60, 0x1E, 0xF0, 0x15, 0xF1, 0x07, 0x31, 0x00, 0x12, 0x04, 0x62, 0x01, 0x12, 0x0C};
+
+static ch8_cpu cpus[NUM_SESSIONS];
+static ch8_scheduler *sched;
+
+void setUp()
+{
+    sched = ch8_schedCreate(2);
+    TEST_ASSERT_NOT_NULL(sched);
+}
+
+void tearDown()
+{
+    ch8_schedDestroy(&sched);
+}
+
+static void sleepMs(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void load(ch8_cpu *cpu, const u8 *program, size_t size)
+{
+    ch8_reset(cpu);
+    ch8_loadRomData(cpu, program, size);
+}
+
+static void test_Scheduler_RunsSessionsInRealTime(void)
+{
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        load(&cpus[i], counter, sizeof(counter));
+        TEST_ASSERT_EQUAL(i, ch8_schedAdd(sched, &cpus[i], 10, NULL, NULL));
+    }
+
+    sleepMs(200);
+
+    ch8_schedStats stats;
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(NUM_SESSIONS, stats.sessions);
+    TEST_ASSERT_EQUAL(0, stats.parked);
+
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        ch8_schedRemove(sched, i);
+    }
+
+    // About 12 frames of 10 cycles each; allow for a slow machine but not for free running
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        TEST_ASSERT_TRUE(cpus[i].cycles >= 40);
+        TEST_ASSERT_TRUE(cpus[i].cycles <= 200);
+    }
+}
+
+static void test_Scheduler_ParksKeyWaitsUntilInput(void)
+{
+    load(&cpus[0], waitKey, sizeof(waitKey));
+    int id = ch8_schedAdd(sched, &cpus[0], 10, NULL, NULL);
+
+    sleepMs(50);
+
+    ch8_schedStats stats;
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(1, stats.parked);
+    u64 frames = stats.frames;
+
+    sleepMs(50);
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(frames, stats.frames);
+
+    ch8_schedSetKeys(sched, id, 1 << 0xB);
+    sleepMs(50);
+
+    // The key ends FX0A, then the self jump parks it for good
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(1, stats.parked);
+    ch8_schedRemove(sched, id);
+    TEST_ASSERT_EQUAL_HEX8(0xB, cpus[0].V[1]);
+    TEST_ASSERT_EQUAL(0x202, cpus[0].programCounter);
+}
+
+static void test_Scheduler_SkipsTimerWaits(void)
+{
+    load(&cpus[0], waitTimer, sizeof(waitTimer));
+    int id = ch8_schedAdd(sched, &cpus[0], 10, NULL, NULL);
+
+    sleepMs(100);
+
+    ch8_schedStats stats;
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(1, stats.parked);
+
+    // 30 ticks take half a second; the session only runs the frames around them
+    sleepMs(600);
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(1, stats.parked);
+    TEST_ASSERT_TRUE(stats.frames <= 4);
+
+    ch8_schedRemove(sched, id);
+    TEST_ASSERT_EQUAL(1, cpus[0].V[2]);
+    TEST_ASSERT_EQUAL(0, cpus[0].delayTimer);
+    TEST_ASSERT_EQUAL(0x20C, cpus[0].programCounter);
+}
+
+static void test_Scheduler_ReusesRemovedIds(void)
+{
+    load(&cpus[0], counter, sizeof(counter));
+    load(&cpus[1], counter, sizeof(counter));
+
+    int a = ch8_schedAdd(sched, &cpus[0], 10, NULL, NULL);
+    ch8_schedRemove(sched, a);
+    TEST_ASSERT_EQUAL(a, ch8_schedAdd(sched, &cpus[1], 10, NULL, NULL));
+
+    ch8_schedStats stats;
+    ch8_schedGetStats(sched, &stats);
+    TEST_ASSERT_EQUAL(1, stats.sessions);
+    ch8_schedRemove(sched, a);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_scheduler.c");
+
+    RUN_TEST(test_Scheduler_RunsSessionsInRealTime);
+    RUN_TEST(test_Scheduler_ParksKeyWaitsUntilInput);
+    RUN_TEST(test_Scheduler_SkipsTimerWaits);
+    RUN_TEST(test_Scheduler_ReusesRemovedIds);
+
+    return UnityEnd();
+}
@@ -0,0 +1,125 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vendor/unity.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_stream.h"
+
+// V1 = key, then jumps to itself
+static const u8 waitKey[] = {0xF1, 0x0A, 0x12, 0x02};
+
+static char name[64];
+static ch8_cpu cpu;
+static ch8_stream *publisher;
+static ch8_stream *reader;
+
+void setUp()
+{
+    snprintf(name, sizeof(name), "/ch8-test-%d", (int)getpid());
+
+    ch8_reset(&cpu);
+    ch8_loadRomData(&cpu, waitKey, sizeof(waitKey));
+
+    publisher = ch8_streamCreate(name);
+    TEST_ASSERT_NOT_NULL(publisher);
+    reader = ch8_streamOpen(name);
+    TEST_ASSERT_NOT_NULL(reader);
+}
+
+void tearDown()
+{
+    ch8_streamClose(&reader);
+    ch8_streamClose(&publisher);
+}
+
+static void test_Stream_ReaderSeesPublishedFrames(void)
+{
+    ch8_streamFrame frame;
+    TEST_ASSERT_FALSE(ch8_streamReadLatest(reader, &frame));
+
+    cpu.framebuffer[0][5][1] = 0x8000000000000001ull;
+    cpu.soundTimer = 3;
+    cpu.keypad = 0x0102;
+    ch8_streamPublish(publisher, &cpu, 41);
+
+    TEST_ASSERT_EQUAL(1, ch8_streamCount(reader));
+    TEST_ASSERT_TRUE(ch8_streamReadLatest(reader, &frame));
+    TEST_ASSERT_EQUAL(0, frame.index);
+    TEST_ASSERT_EQUAL(41, frame.frame);
+    TEST_ASSERT_EQUAL_HEX16(0x0102, frame.keypad);
+    TEST_ASSERT_TRUE(frame.soundOn);
+    TEST_ASSERT_EQUAL_MEMORY(cpu.framebuffer, frame.framebuffer, sizeof(frame.framebuffer));
+
+    // Frames a whole ring behind are gone
+    for (int i = 0; i < CH8_STREAM_SLOTS; i++) {
+        ch8_streamPublish(publisher, &cpu, 42 + i);
+    }
+    TEST_ASSERT_FALSE(ch8_streamRead(reader, 0, &frame));
+    TEST_ASSERT_TRUE(ch8_streamRead(reader, 1, &frame));
+    TEST_ASSERT_EQUAL(42, frame.frame);
+    TEST_ASSERT_FALSE(ch8_streamRead(reader, CH8_STREAM_SLOTS + 1, &frame));
+}
+
+static void test_Stream_KeysFlowBackIntoTheKeypad(void)
+{
+    ch8_clockCycle(&cpu, 0.0f);
+    TEST_ASSERT_TRUE(cpu.waitFlag);
+    TEST_ASSERT_FALSE(ch8_streamPollInput(publisher, &cpu));
+
+    // Pressed and released before the emulator looked: the wait still sees key 7
+    TEST_ASSERT_TRUE(ch8_streamSendKeys(reader, 1 << 7));
+    TEST_ASSERT_TRUE(ch8_streamSendKeys(reader, 0));
+    TEST_ASSERT_TRUE(ch8_streamPollInput(publisher, &cpu));
+
+    TEST_ASSERT_FALSE(cpu.waitFlag);
+    TEST_ASSERT_EQUAL(7, cpu.V[1]);
+    TEST_ASSERT_EQUAL_HEX16(0, cpu.keypad);
+}
+
+static void test_Stream_InputRingFillsUp(void)
+{
+    for (int i = 0; i < CH8_STREAM_INPUT_SLOTS; i++) {
+        TEST_ASSERT_TRUE(ch8_streamSendKeys(reader, (u16)i));
+    }
+    TEST_ASSERT_FALSE(ch8_streamSendKeys(reader, 0xFFFF));
+
+    TEST_ASSERT_TRUE(ch8_streamPollInput(publisher, &cpu));
+    TEST_ASSERT_EQUAL_HEX16(CH8_STREAM_INPUT_SLOTS - 1, cpu.keypad);
+    TEST_ASSERT_TRUE(ch8_streamSendKeys(reader, 0xFFFF));
+}
+
+static void test_Stream_NameBelongsToOnePublisher(void)
+{
+    // A live publisher keeps its stream
+    TEST_ASSERT_NULL(ch8_streamCreate(name));
+    ch8_streamPublish(publisher, &cpu, 1);
+    TEST_ASSERT_EQUAL(1, ch8_streamCount(reader));
+
+    // Whatever a dead one left behind is replaced
+    char stale[80];
+    snprintf(stale, sizeof(stale), "%s-stale", name);
+    int fd = shm_open(stale, O_CREAT | O_RDWR, 0600);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, ftruncate(fd, 64));
+    close(fd);
+
+    ch8_stream *replaced = ch8_streamCreate(stale);
+    TEST_ASSERT_NOT_NULL(replaced);
+    ch8_streamClose(&replaced);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_stream.c");
+
+    RUN_TEST(test_Stream_ReaderSeesPublishedFrames);
+    RUN_TEST(test_Stream_KeysFlowBackIntoTheKeypad);
+    RUN_TEST(test_Stream_InputRingFillsUp);
+    RUN_TEST(test_Stream_NameBelongsToOnePublisher);
+
+    return UnityEnd();
+}
@@ -1,6 +1,7 @@
 #include "../src/ch8_cpu.h"
 #include "../src/ch8_log.h"
 #include "../src/ch8_keyboard.h"
+#include "../src/ch8_display.h"
 
 void ch8_logError(const char* fmt, ...)
 {
@@ -20,7 +21,7 @@ void ch8_logDebug(const char* fmt, ...)
 
 int ch8_awaitKeyPress(ch8_cpu* cpu, ch8_key* key)
 {
-    cpu->keypad[KEY_2] = true;
+    cpu->keypad |= 1 << KEY_2;
     (*key) = KEY_2;
     return 0;
 }
@@ -35,6 +36,6 @@ bool ch8_isKeyDown(const ch8_cpu* cpu, ch8_key key)
     return false;
 }
 
-void ch8_displayWriteFb(const ch8_cpu* cpu)
+void ch8_displayWriteFb(ch8_display* display, const ch8_cpu* cpu)
 {
 }
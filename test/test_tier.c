@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vendor/unity.h"
+#include "test_helpers.h"
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_tier.h"
+#include "../src/ch8_trace.h"
+
+static ch8_cpu reference;
+static ch8_cpu tiered;
+static ch8_tier *tier;
+
+// Counts V1 to 0x20, then rewrites the loop's 7101 to 7105 with FX55 and starts over
+static const u16 selfModifying[] = {0x6100, 0x7101, 0x3120, 0x1202, 0x6005, 0xA203, 0xF055, 0x1200};
+
+static const u16 counter[] = {0x7001, 0x1200};
+
+// What tools/ch8_recomp would emit for `counter`
+static u32 runCounterBlock(ch8_cpu *cpu)
+{
+    cpu->drawFlag = false;
+    cpu->waitFlag = false;
+    cpu->waitReg = 0;
+    cpu->V[0] += 1;
+    cpu->programCounter = 0x200;
+    cpu->cycles += 2;
+    return 2;
+}
+
+static const ch8_recompBlock counterBlock = {0x200, 0x204, 2, false, runCounterBlock};
+
+static const ch8_recompBlock *lookupCounterBlock(u16 pc)
+{
+    return pc == 0x200 ? &counterBlock : NULL;
+}
+
+static const u8 counterRom[] = {0x70, 0x01, 0x12, 0x00};
+static const ch8_recompProgram counterProgram = {counterRom, sizeof(counterRom), CH8_QUIRKS_LEGACY, lookupCounterBlock};
+
+void setUp()
+{
+    tier = ch8_tierCreate(NULL);
+}
+
+void tearDown()
+{
+    ch8_tierDestroy(&tier);
+}
+
+static u32 runTiered(ch8_cpu *cpu, u32 budget)
+{
+    return ch8_tierRun(tier, cpu, budget);
+}
+
+static void load(const u16 *program, size_t count, u32 quirks)
+{
+    loadProgram(&reference, &tiered, program, count, quirks);
+}
+
+static void runBoth(u32 slices, u32 budget)
+{
+    runAgainstInterpreter(&reference, &tiered, runTiered, slices, budget);
+}
+
+static void test_Tier_ShortRunStaysInterpreted(void)
+{
+    load(counter, 2, CH8_QUIRKS_LEGACY);
+    runBoth(1, CH8_TIER_DECODE_THRESHOLD);
+
+    ch8_tierStats stats;
+    ch8_tierGetStats(tier, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.promotions);
+    TEST_ASSERT_EQUAL_UINT64(CH8_TIER_DECODE_THRESHOLD, stats.instructions[CH8_TIER_INTERPRETER]);
+}
+
+static void test_Tier_HotLoopRunsDecoded(void)
+{
+    load(counter, 2, CH8_QUIRKS_LEGACY);
+    // Odd slices also start runs on the jump, which gets promoted on its own
+    runBoth(100, 101);
+
+    ch8_tierStats stats;
+    ch8_tierGetStats(tier, &stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.promotions);
+    TEST_ASSERT_GREATER_THAN_UINT64(stats.instructions[CH8_TIER_INTERPRETER], stats.instructions[CH8_TIER_DECODED]);
+}
+
+static void test_Tier_CodeWriteDemotesBlock(void)
+{
+    const u32 profiles[] = {CH8_QUIRKS_LEGACY, CH8_QUIRKS_COSMAC};
+    for (int p = 0; p < 2; p++) {
+        ch8_tierFlush(tier);
+        load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), profiles[p]);
+        runBoth(500, 7);
+    }
+
+    ch8_tierStats stats;
+    ch8_tierGetStats(tier, &stats);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, stats.demotions);
+    TEST_ASSERT_GREATER_THAN_UINT64(0, stats.instructions[CH8_TIER_DECODED]);
+}
+
+static void test_Tier_ResetVmStartsOver(void)
+{
+    load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), CH8_QUIRKS_LEGACY);
+    runBoth(10, 100);
+
+    // Same VM, same addresses, different code
+    load(counter, 2, CH8_QUIRKS_LEGACY);
+    runBoth(10, 100);
+}
+
+static void test_Tier_HotBlockSwitchesToNativeCode(void)
+{
+    ch8_tierDestroy(&tier);
+    tier = ch8_tierCreate(&counterProgram);
+
+    load(counter, 2, CH8_QUIRKS_LEGACY);
+    runBoth(100, 100);
+
+    ch8_tierStats stats;
+    ch8_tierGetStats(tier, &stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.promotions);
+    TEST_ASSERT_GREATER_THAN_UINT64(0, stats.instructions[CH8_TIER_NATIVE]);
+}
+
+static void test_Tier_SavedBlocksWarmTheNextRun(void)
+{
+    char path[256];
+    load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), CH8_QUIRKS_LEGACY);
+    ch8_tierCachePath(&tiered, "/tmp", path, sizeof(path));
+    remove(path);
+    TEST_ASSERT_NOT_EQUAL(0, ch8_tierLoad(tier, &tiered, path));
+
+    runBoth(1, 1000);
+    TEST_ASSERT_EQUAL(0, ch8_tierSave(tier, path));
+
+    // A restarted process: same ROM, fresh engine
+    ch8_tierDestroy(&tier);
+    tier = ch8_tierCreate(NULL);
+    load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), CH8_QUIRKS_LEGACY);
+    char again[256];
+    ch8_tierCachePath(&tiered, "/tmp", again, sizeof(again));
+    TEST_ASSERT_EQUAL_STRING(path, again);
+    TEST_ASSERT_EQUAL(0, ch8_tierLoad(tier, &tiered, path));
+
+    runBoth(1, CH8_TIER_DECODE_THRESHOLD);
+
+    ch8_tierStats stats;
+    ch8_tierGetStats(tier, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.promotions);
+    TEST_ASSERT_GREATER_THAN_UINT64(stats.instructions[CH8_TIER_INTERPRETER], stats.instructions[CH8_TIER_DECODED]);
+
+    // Other quirks hash to another file, and this one does not apply to them
+    load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), CH8_QUIRKS_COSMAC);
+    ch8_tierCachePath(&tiered, "/tmp", again, sizeof(again));
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(path, again));
+    TEST_ASSERT_NOT_EQUAL(0, ch8_tierLoad(tier, &tiered, path));
+
+    // A trace file saved under the cache's name is not taken for a cache
+    load(selfModifying, sizeof(selfModifying) / sizeof(selfModifying[0]), CH8_QUIRKS_LEGACY);
+    FILE *f = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    fwrite(CH8_TRACE_MAGIC, 1, 4, f);
+    fclose(f);
+    TEST_ASSERT_NOT_EQUAL(0, ch8_tierLoad(tier, &tiered, path));
+
+    remove(path);
+}
+
+int main(void)
+{
+    UnityBegin("test/test_tier.c");
+
+    RUN_TEST(test_Tier_ShortRunStaysInterpreted);
+    RUN_TEST(test_Tier_HotLoopRunsDecoded);
+    RUN_TEST(test_Tier_CodeWriteDemotesBlock);
+    RUN_TEST(test_Tier_ResetVmStartsOver);
+    RUN_TEST(test_Tier_HotBlockSwitchesToNativeCode);
+    RUN_TEST(test_Tier_SavedBlocksWarmTheNextRun);
+
+    return UnityEnd();
+}
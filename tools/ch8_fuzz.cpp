@@ -0,0 +1,607 @@
+// Differential fuzzer: runs generated or mutated ROMs on the reference
+// interpreter and a candidate backend, comparing the full VM state after
+// every interval of cycles.
+//
+// usage: ch8_fuzz [-b backend] [-j threads] [-n iterations] [-c cycles] [-e interval]
+//                 [-q quirks] [-s seed] [-o output dir] [--replay input] [corpus ROMs...]
+//
+// Built with -DCH8_LIBFUZZER (and -fsanitize=fuzzer) it exposes
+// LLVMFuzzerTestOneInput instead of main; the candidate backend is then taken
+// from the CH8_FUZZ_BACKEND environment variable.
+//
+// Input layout (also the format of saved divergences):
+//   u32 rng seed | 16 x u16 keypad masks, one per interval, cycled | ROM image
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/ch8_backend.h"
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_util.h"
+
+#define KEY_SLOTS 16
+#define HEADER_SIZE (4 + KEY_SLOTS * 2)
+#define DEFAULT_CYCLES 20000
+#define DEFAULT_INTERVAL 64
+
+typedef struct fuzzConfig
+{
+    const ch8_backend *reference;
+    const ch8_backend *candidate;
+    u32 cycles;
+    u32 interval;
+    u32 quirks;
+} fuzzConfig;
+
+typedef struct divergence
+{
+    u64 cycle;
+    char what[160];
+} divergence;
+
+static u16 readU16(const u8 *p)
+{
+    return (u16)(p[0] | p[1] << 8);
+}
+
+static u32 readU32(const u8 *p)
+{
+    return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static bool compareState(const ch8_cpu *a, const ch8_cpu *b, char *what, size_t size)
+{
+#define CHECK_FIELD(field)                                                                          \
+    if (a->field != b->field) {                                                                     \
+        snprintf(what, size, #field ": %X vs %X", (unsigned)a->field, (unsigned)b->field);          \
+        return false;                                                                               \
+    }
+
+    CHECK_FIELD(programCounter);
+    CHECK_FIELD(index);
+    CHECK_FIELD(stackPointer);
+    CHECK_FIELD(fault);
+    CHECK_FIELD(delayTimer);
+    CHECK_FIELD(soundTimer);
+    CHECK_FIELD(waitFlag);
+    CHECK_FIELD(waitReg);
+    CHECK_FIELD(cycles);
+    CHECK_FIELD(rngState);
+    CHECK_FIELD(hires);
+    CHECK_FIELD(planeMask);
+
+    for (int i = 0; i < CH8_NUM_REGISTERS; i++) {
+        if (a->V[i] != b->V[i]) {
+            snprintf(what, size, "V%X: %X vs %X", i, a->V[i], b->V[i]);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < a->stackPointer && i < CH8_STACK_DEPTH; i++) {
+        if (a->stack[i] != b->stack[i]) {
+            snprintf(what, size, "stack[%d]: %X vs %X", i, a->stack[i], b->stack[i]);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < CH8_NUM_FLAG_REGISTERS; i++) {
+        if (a->flags[i] != b->flags[i]) {
+            snprintf(what, size, "flags[%d]: %X vs %X", i, a->flags[i], b->flags[i]);
+            return false;
+        }
+    }
+
+    for (int p = 0; p < CH8_NUM_PLANES; p++) {
+        for (int y = 0; y < CH8_DISPLAY_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CH8_DISPLAY_ROW_WORDS; w++) {
+                if (a->framebuffer[p][y][w] != b->framebuffer[p][y][w]) {
+                    snprintf(what, size, "plane %d row %d word %d: %016llX vs %016llX", p, y, w,
+                             (unsigned long long)a->framebuffer[p][y][w], (unsigned long long)b->framebuffer[p][y][w]);
+                    return false;
+                }
+            }
+        }
+    }
+
+#undef CHECK_FIELD
+
+    // Only pages written since the ROM was loaded can differ; find the first difference only when there is one
+    if (!ch8_dirtyEqual(a, b)) {
+        for (int i = 0; i < CH8_MEM_SIZE; i++) {
+            if (a->memory[i] != b->memory[i]) {
+                snprintf(what, size, "memory[%04X]: %02X vs %02X", i, a->memory[i], b->memory[i]);
+                return false;
+            }
+        }
+        snprintf(what, size, "state outside the registers, display and memory");
+        return false;
+    }
+
+    return true;
+}
+
+// Mirrors the frontend: keypad follows the mask and FX0A takes the lowest pressed key
+static void applyInput(ch8_cpu *cpu, u16 keys)
+{
+    cpu->keypad = keys;
+
+    if (cpu->waitFlag && keys != 0) {
+        int key = 0;
+        while (((keys >> key) & 1) == 0) {
+            key++;
+        }
+        cpu->V[cpu->waitReg] = (u8)key;
+        cpu->waitFlag = false;
+    }
+}
+
+// Loading only rewrites the previous ROM's pages, and the VM is marked clean as the case's baseline
+static void startVm(ch8_cpu *cpu, u32 seed, u32 quirks, const u8 *rom, size_t romSize)
+{
+    ch8_loadRomData(cpu, rom, romSize);
+    ch8_seedRandom(cpu, seed);
+    ch8_setQuirks(cpu, quirks);
+    ch8_markClean(cpu);
+}
+
+static bool runCase(const u8 *data, size_t size, const fuzzConfig *cfg, divergence *div)
+{
+    if (size < HEADER_SIZE) {
+        return false;
+    }
+
+    // Two full VMs per thread are too large to keep on the stack comfortably.
+    // `image` is where the last case started from; restoring from it only copies the pages the case wrote.
+    static thread_local ch8_cpu a, b, image;
+    static thread_local bool ready = false;
+
+    if (!ready) {
+        ch8_reset(&image);
+        ch8_reset(&a);
+        ch8_reset(&b);
+        ready = true;
+    }
+
+    u32 seed = readU32(data);
+    const u8 *rom = data + HEADER_SIZE;
+    size_t romSize = ch8_min(size - HEADER_SIZE, (size_t)CH8_MAX_PROGRAM_SIZE);
+
+    ch8_syncDirty(&a, &image);
+    ch8_syncDirty(&b, &image);
+    startVm(&image, seed, cfg->quirks, rom, romSize);
+    startVm(&a, seed, cfg->quirks, rom, romSize);
+    startVm(&b, seed, cfg->quirks, rom, romSize);
+
+    u32 steps = cfg->cycles / cfg->interval;
+    for (u32 step = 0; step < steps; step++) {
+        u16 keys = readU16(data + 4 + (step % KEY_SLOTS) * 2);
+        applyInput(&a, keys);
+        applyInput(&b, keys);
+
+        u32 ran = cfg->reference->run(&a, cfg->interval);
+        cfg->candidate->run(&b, cfg->interval);
+
+        a.delayTimer = ch8_max(a.delayTimer - 1, 0);
+        a.soundTimer = ch8_max(a.soundTimer - 1, 0);
+        b.delayTimer = ch8_max(b.delayTimer - 1, 0);
+        b.soundTimer = ch8_max(b.soundTimer - 1, 0);
+
+        if (!compareState(&a, &b, div->what, sizeof(div->what))) {
+            div->cycle = a.cycles;
+            return true;
+        }
+
+        // Halted: nothing more will happen
+        if (ran < cfg->interval && !a.waitFlag) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+static bool diverges(const std::vector<u8> &input, const fuzzConfig *cfg)
+{
+    divergence div;
+    return runCase(input.data(), input.size(), cfg, &div);
+}
+
+// Shrinks a diverging input while it keeps diverging: trims the ROM tail,
+// then zeroes ever smaller chunks of the ROM and finally unused key slots.
+static std::vector<u8> minimize(std::vector<u8> input, const fuzzConfig *cfg)
+{
+    while (input.size() > HEADER_SIZE) {
+        size_t romSize = input.size() - HEADER_SIZE;
+        std::vector<u8> candidate(input.begin(), input.end() - (romSize + 1) / 2);
+        if (!diverges(candidate, cfg)) {
+            break;
+        }
+        input = candidate;
+    }
+
+    while (input.size() > HEADER_SIZE) {
+        std::vector<u8> candidate(input.begin(), input.end() - 1);
+        if (!diverges(candidate, cfg)) {
+            break;
+        }
+        input = candidate;
+    }
+
+    size_t romSize = input.size() - HEADER_SIZE;
+    for (size_t chunk = ch8_max(romSize / 2, (size_t)1); chunk >= 1; chunk /= 2) {
+        for (size_t offset = HEADER_SIZE; offset < input.size(); offset += chunk) {
+            size_t end = ch8_min(offset + chunk, input.size());
+            std::vector<u8> candidate = input;
+            bool changed = false;
+            for (size_t i = offset; i < end; i++) {
+                changed |= candidate[i] != 0;
+                candidate[i] = 0;
+            }
+            if (changed && diverges(candidate, cfg)) {
+                input = candidate;
+            }
+        }
+        if (chunk == 1) {
+            break;
+        }
+    }
+
+    for (int slot = 0; slot < KEY_SLOTS; slot++) {
+        std::vector<u8> candidate = input;
+        candidate[4 + slot * 2] = 0;
+        candidate[5 + slot * 2] = 0;
+        if (candidate != input && diverges(candidate, cfg)) {
+            input = candidate;
+        }
+    }
+
+    return input;
+}
+
+static const ch8_backend *defaultCandidate()
+{
+    int count = 0;
+    const ch8_backend *backends = ch8_getBackends(&count);
+    return &backends[count - 1];
+}
+
+static fuzzConfig defaultConfig()
+{
+    int count = 0;
+    fuzzConfig cfg;
+    cfg.reference = ch8_getBackends(&count);
+    cfg.candidate = defaultCandidate();
+    cfg.cycles = DEFAULT_CYCLES;
+    cfg.interval = DEFAULT_INTERVAL;
+    cfg.quirks = CH8_QUIRKS_LEGACY;
+    return cfg;
+}
+
+#ifdef CH8_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static fuzzConfig cfg = [] {
+        fuzzConfig c = defaultConfig();
+        const char *name = getenv("CH8_FUZZ_BACKEND");
+        if (name != NULL && ch8_findBackend(name) != NULL) {
+            c.candidate = ch8_findBackend(name);
+        }
+        return c;
+    }();
+
+    divergence div;
+    if (runCase(data, size, &cfg, &div)) {
+        fprintf(stderr, "%s diverged from %s at cycle %llu: %s\n", cfg.candidate->name, cfg.reference->name,
+                (unsigned long long)div.cycle, div.what);
+        abort();
+    }
+
+    return 0;
+}
+
+#else
+
+typedef std::vector<u8> rom;
+
+// Random instruction with operands biased towards the loaded program so
+// jumps, calls and I stay in interesting places
+static void randomInstruction(std::mt19937_64 &rng, size_t romSize, u8 *out)
+{
+    u16 opcode = (u16)rng();
+    u16 target = (u16)(CH8_PROGRAM_START_OFFSET + ((rng() % ch8_max(romSize, (size_t)2)) & ~1u));
+
+    switch (opcode & 0xF000)
+    {
+    case 0x0000: {
+        static const u16 system[] = {0x00E0, 0x00EE, 0x00C0, 0x00FB, 0x00FC, 0x00FE, 0x00FF};
+        opcode = system[rng() % (sizeof(system) / sizeof(system[0]))];
+        if (opcode == 0x00C0) {
+            opcode |= rng() & 0xF;
+        }
+        break;
+    }
+    case 0x1000:
+    case 0x2000:
+    case 0xA000:
+    case 0xB000:
+        opcode = (opcode & 0xF000) | (target & 0x0FFF);
+        break;
+    case 0x5000: {
+        static const u8 ops[] = {0x0, 0x2, 0x3};
+        opcode = (opcode & 0xFFF0) | ops[rng() % sizeof(ops)];
+        break;
+    }
+    case 0xE000:
+        opcode = (opcode & 0xFF00) | ((rng() & 1) ? 0x9E : 0xA1);
+        break;
+    case 0xF000: {
+        static const u8 ops[] = {0x00, 0x01, 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x30, 0x33, 0x55, 0x65, 0x75, 0x85};
+        opcode = (opcode & 0xFF00) | ops[rng() % sizeof(ops)];
+        if ((opcode & 0xFF) == 0x00) {
+            opcode = 0xF000;
+        }
+        break;
+    }
+    }
+
+    out[0] = opcode >> 8;
+    out[1] = opcode & 0xFF;
+}
+
+static void generateInput(std::mt19937_64 &rng, const std::vector<rom> &corpus, std::vector<u8> &input)
+{
+    input.assign(HEADER_SIZE, 0);
+
+    u32 seed = (u32)rng();
+    memcpy(input.data(), &seed, 4);
+    for (int slot = 0; slot < KEY_SLOTS; slot++) {
+        u16 keys = (rng() % 2) ? 0 : (u16)(1 << (rng() % CH8_NUM_KEYS));
+        input[4 + slot * 2] = keys & 0xFF;
+        input[5 + slot * 2] = keys >> 8;
+    }
+
+    rom program;
+    if (!corpus.empty() && rng() % 4 != 0) {
+        // Mutate a corpus ROM
+        program = corpus[rng() % corpus.size()];
+        int mutations = 1 + (int)(rng() % 8);
+        for (int m = 0; m < mutations && !program.empty(); m++) {
+            size_t at = rng() % program.size();
+            switch (rng() % 3)
+            {
+            case 0:
+                program[at] ^= (u8)(1 << (rng() % 8));
+                break;
+            case 1:
+                program[at] = (u8)rng();
+                break;
+            default:
+                at &= ~(size_t)1;
+                if (at + 1 < program.size()) {
+                    randomInstruction(rng, program.size(), &program[at]);
+                }
+                break;
+            }
+        }
+    } else {
+        // Fresh program of random instructions
+        size_t length = 2 * (1 + rng() % 256);
+        program.resize(length);
+        for (size_t at = 0; at < length; at += 2) {
+            randomInstruction(rng, length, &program[at]);
+        }
+    }
+
+    input.insert(input.end(), program.begin(), program.end());
+    if (input.size() > HEADER_SIZE + CH8_MAX_PROGRAM_SIZE) {
+        input.resize(HEADER_SIZE + CH8_MAX_PROGRAM_SIZE);
+    }
+}
+
+static bool readFile(const char *file, std::vector<u8> &data)
+{
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    data.clear();
+    u8 buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const std::string &file, const u8 *data, size_t size)
+{
+    FILE *f = fopen(file.c_str(), "wb");
+    if (f == NULL) {
+        return false;
+    }
+    fwrite(data, 1, size, f);
+    fclose(f);
+    return true;
+}
+
+static std::atomic<u64> executed{0};
+static std::atomic<bool> found{false};
+static std::mutex reportLock;
+
+static void reportDivergence(const std::vector<u8> &input, const fuzzConfig *cfg, const std::string &outDir)
+{
+    std::vector<u8> minimal = minimize(input, cfg);
+
+    divergence div;
+    runCase(minimal.data(), minimal.size(), cfg, &div);
+
+    char name[64];
+    snprintf(name, sizeof(name), "divergence-%08X", readU32(minimal.data()));
+    std::string base = outDir + "/" + name;
+
+    writeFile(base + ".bin", minimal.data(), minimal.size());
+    writeFile(base + ".ch8", minimal.data() + HEADER_SIZE, minimal.size() - HEADER_SIZE);
+
+    printf("\n%s diverged from %s at cycle %llu: %s\n", cfg->candidate->name, cfg->reference->name,
+           (unsigned long long)div.cycle, div.what);
+    printf("Minimized from %zu to %zu ROM bytes: %s.bin (replay with --replay)\n", input.size() - HEADER_SIZE,
+           minimal.size() - HEADER_SIZE, base.c_str());
+}
+
+static void worker(u64 seed, u64 iterations, const std::vector<rom> *corpus, const fuzzConfig *cfg,
+                   const std::string *outDir)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<u8> input;
+    divergence div;
+
+    while (!found.load(std::memory_order_relaxed)) {
+        if (iterations != 0 && executed.fetch_add(1, std::memory_order_relaxed) >= iterations) {
+            break;
+        }
+        if (iterations == 0) {
+            executed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        generateInput(rng, *corpus, input);
+        if (runCase(input.data(), input.size(), cfg, &div)) {
+            std::lock_guard<std::mutex> lock(reportLock);
+            if (!found.exchange(true)) {
+                reportDivergence(input, cfg, *outDir);
+            }
+        }
+    }
+}
+
+static int replay(const char *file, const fuzzConfig *cfg)
+{
+    std::vector<u8> input;
+    if (!readFile(file, input)) {
+        fprintf(stderr, "Could not read %s\n", file);
+        return EXIT_FAILURE;
+    }
+
+    divergence div;
+    if (runCase(input.data(), input.size(), cfg, &div)) {
+        printf("%s diverged from %s at cycle %llu: %s\n", cfg->candidate->name, cfg->reference->name,
+               (unsigned long long)div.cycle, div.what);
+        return EXIT_FAILURE;
+    }
+
+    printf("No divergence\n");
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char *exe)
+{
+    fprintf(stderr,
+            "usage: %s [-b backend] [-j threads] [-n iterations] [-c cycles] [-e interval]\n"
+            "          [-q quirks] [-s seed] [-o output dir] [--replay input] [corpus ROMs...]\n\nbackends:\n",
+            exe);
+
+    int count = 0;
+    const ch8_backend *backends = ch8_getBackends(&count);
+    for (int i = 0; i < count; i++) {
+        fprintf(stderr, "  %-12s %s\n", backends[i].name, backends[i].description);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    fuzzConfig cfg = defaultConfig();
+    u32 threads = ch8_max(std::thread::hardware_concurrency(), 1u);
+    u64 iterations = 0;
+    u64 seed = (u64)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::string outDir = ".";
+    const char *replayFile = NULL;
+    std::vector<rom> corpus;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "-b") == 0 && hasValue) {
+            cfg.candidate = ch8_findBackend(argv[++i]);
+            if (cfg.candidate == NULL) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(arg, "-j") == 0 && hasValue) {
+            threads = (u32)atoi(argv[++i]);
+        } else if (strcmp(arg, "-n") == 0 && hasValue) {
+            iterations = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "-c") == 0 && hasValue) {
+            cfg.cycles = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "-e") == 0 && hasValue) {
+            cfg.interval = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "-q") == 0 && hasValue) {
+            if (!ch8_findQuirkProfile(argv[++i], &cfg.quirks)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(arg, "-s") == 0 && hasValue) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(arg, "-o") == 0 && hasValue) {
+            outDir = argv[++i];
+        } else if (strcmp(arg, "--replay") == 0 && hasValue) {
+            replayFile = argv[++i];
+        } else if (arg[0] == '-') {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            rom program;
+            if (!readFile(arg, program) || program.size() > CH8_MAX_PROGRAM_SIZE) {
+                fprintf(stderr, "Skipping corpus file %s\n", arg);
+                continue;
+            }
+            corpus.push_back(program);
+        }
+    }
+
+    threads = ch8_max(threads, 1u);
+    cfg.interval = ch8_max(cfg.interval, 1u);
+
+    if (replayFile != NULL) {
+        return replay(replayFile, &cfg);
+    }
+
+    printf("Fuzzing %s against %s on %u threads (%u cycles, compare every %u), seed %llu\n", cfg.candidate->name,
+           cfg.reference->name, threads, cfg.cycles, cfg.interval, (unsigned long long)seed);
+
+    std::vector<std::thread> pool;
+    for (u32 t = 0; t < threads; t++) {
+        pool.emplace_back(worker, seed + t * 0x9E3779B97F4A7C15ull, iterations, &corpus, &cfg, &outDir);
+    }
+
+    // Progress until the workers finish or one of them finds a divergence
+    auto start = std::chrono::steady_clock::now();
+    std::thread progress([&] {
+        while (!found.load() && (iterations == 0 || executed.load() < iterations)) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+            u64 n = ch8_min(executed.load(), iterations == 0 ? executed.load() : iterations);
+            printf("\r%llu cases, %.0f cases/s", (unsigned long long)n, (f64)n / seconds);
+            fflush(stdout);
+        }
+    });
+
+    for (std::thread &t : pool) {
+        t.join();
+    }
+    progress.join();
+    printf("\n");
+
+    return found.load() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,251 @@
+// Converts a recording made with --record to a video or animated GIF.
+//
+// usage: ch8_recexport <recording> <output.y4m|output.gif> [-s <scale>]
+//
+// Output is 128x64 pixels times the scale; low resolution frames are doubled.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "../src/ch8_framebuffer.h"
+#include "../src/ch8_record.h"
+#include "../src/ch8_util.h"
+
+#define DEFAULT_SCALE 4
+#define MAX_SCALE 16
+
+// GIF delays are in hundredths of a second, and most viewers treat anything below 2 as slow
+#define GIF_MIN_DELAY 2
+
+// Color index 0-3 of every output pixel
+static void render(const ch8_recordFrame *frame, int scale, u8 *out)
+{
+    bool hires = (frame->flags & CH8_RECORD_HIRES) != 0;
+    int width = CH8_DISPLAY_HIRES_WIDTH * scale;
+    int height = CH8_DISPLAY_HIRES_HEIGHT * scale;
+    int shrink = hires ? 1 : 2;
+
+    for (int y = 0; y < height; y++) {
+        int fy = y / scale / shrink;
+        for (int x = 0; x < width; x++) {
+            int fx = x / scale / shrink;
+            int shift = 63 - fx % 64;
+            out[y * width + x] = (u8)(((frame->framebuffer[0][fy][fx / 64] >> shift) & 1)
+                                      | ((frame->framebuffer[1][fy][fx / 64] >> shift) & 1) << 1);
+        }
+    }
+}
+
+static void writeY4mFrame(FILE *f, const u8 *pixels, size_t count)
+{
+    // Full resolution chroma (C444), BT.601 studio range
+    static u8 planes[3][4];
+    static bool converted = false;
+    if (!converted) {
+        for (int c = 0; c < 4; c++) {
+            f32 r = ch8_palette[c][0], g = ch8_palette[c][1], b = ch8_palette[c][2];
+            planes[0][c] = (u8)(16.0f + 0.257f * r + 0.504f * g + 0.098f * b + 0.5f);
+            planes[1][c] = (u8)(128.0f - 0.148f * r - 0.291f * g + 0.439f * b + 0.5f);
+            planes[2][c] = (u8)(128.0f + 0.439f * r - 0.368f * g - 0.071f * b + 0.5f);
+        }
+        converted = true;
+    }
+
+    std::vector<u8> plane(count);
+    fputs("FRAME\n", f);
+    for (int p = 0; p < 3; p++) {
+        for (size_t i = 0; i < count; i++) {
+            plane[i] = planes[p][pixels[i]];
+        }
+        fwrite(plane.data(), 1, count, f);
+    }
+}
+
+typedef struct gifBits
+{
+    FILE *f;
+    u8 block[255];
+    int blockSize;
+    u32 bits;
+    int bitCount;
+} gifBits;
+
+static void gifPutCode(gifBits *out, u32 code, int size)
+{
+    out->bits |= code << out->bitCount;
+    out->bitCount += size;
+
+    while (out->bitCount >= 8) {
+        out->block[out->blockSize++] = (u8)out->bits;
+        out->bits >>= 8;
+        out->bitCount -= 8;
+
+        if (out->blockSize == 255) {
+            fputc(255, out->f);
+            fwrite(out->block, 1, 255, out->f);
+            out->blockSize = 0;
+        }
+    }
+}
+
+// LZW-compresses 2 bit pixels into data sub-blocks
+static void gifWriteImage(FILE *f, const u8 *pixels, size_t count)
+{
+    const int minCodeSize = 2;
+    const u32 clearCode = 1 << minCodeSize;
+
+    // Code for (prefix, pixel), or 0 when there is none yet: real entries start past clearCode + 1
+    std::vector<u16> next(4096 * 4, 0);
+
+    gifBits out = {f, {0}, 0, 0, 0};
+    int codeSize = minCodeSize + 1;
+    u32 maxCode = clearCode + 1;
+
+    fputc(minCodeSize, f);
+    gifPutCode(&out, clearCode, codeSize);
+
+    u32 prefix = pixels[0];
+    for (size_t i = 1; i < count; i++) {
+        u32 key = prefix * 4 + pixels[i];
+        if (next[key] != 0) {
+            prefix = next[key];
+            continue;
+        }
+
+        gifPutCode(&out, prefix, codeSize);
+        next[key] = (u16)++maxCode;
+        if (maxCode >= (1u << codeSize)) {
+            codeSize++;
+        }
+        if (maxCode == 4095) {
+            gifPutCode(&out, clearCode, codeSize);
+            std::fill(next.begin(), next.end(), 0);
+            codeSize = minCodeSize + 1;
+            maxCode = clearCode + 1;
+        }
+        prefix = pixels[i];
+    }
+
+    gifPutCode(&out, prefix, codeSize);
+    gifPutCode(&out, clearCode + 1, codeSize);
+    if (out.bitCount > 0) {
+        gifPutCode(&out, 0, 8 - out.bitCount);
+    }
+    if (out.blockSize > 0) {
+        fputc(out.blockSize, f);
+        fwrite(out.block, 1, out.blockSize, f);
+    }
+    fputc(0, f);
+}
+
+static void gifWriteFrame(FILE *f, const u8 *pixels, int width, int height, int delay)
+{
+    const u8 control[] = {0x21, 0xF9, 4, 0, (u8)delay, (u8)(delay >> 8), 0, 0};
+    const u8 descriptor[] = {0x2C, 0, 0, 0, 0, (u8)width, (u8)(width >> 8), (u8)height, (u8)(height >> 8), 0};
+
+    fwrite(control, 1, sizeof(control), f);
+    fwrite(descriptor, 1, sizeof(descriptor), f);
+    gifWriteImage(f, pixels, (size_t)width * height);
+}
+
+// Frame n's start time in hundredths of a second
+static int centiseconds(u64 frame)
+{
+    return (int)((frame * 100 + CH8_RECORD_FRAME_RATE / 2) / CH8_RECORD_FRAME_RATE);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    int scale = DEFAULT_SCALE;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+        } else if (input == NULL) {
+            input = argv[i];
+        } else {
+            output = argv[i];
+        }
+    }
+
+    size_t outputLength = output != NULL ? strlen(output) : 0;
+    bool gif = outputLength > 4 && strcmp(output + outputLength - 4, ".gif") == 0;
+    bool y4m = outputLength > 4 && strcmp(output + outputLength - 4, ".y4m") == 0;
+    if (input == NULL || (!gif && !y4m) || scale < 1 || scale > MAX_SCALE) {
+        fprintf(stderr, "usage: %s <recording> <output.y4m|output.gif> [-s <scale 1-%d>]\n", argv[0], MAX_SCALE);
+        return EXIT_FAILURE;
+    }
+
+    ch8_recording *recording = ch8_recordingOpen(input);
+    if (recording == NULL) {
+        fprintf(stderr, "%s is not a recording\n", input);
+        return EXIT_FAILURE;
+    }
+
+    FILE *f = fopen(output, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Could not create %s\n", output);
+        ch8_recordingClose(&recording);
+        return EXIT_FAILURE;
+    }
+
+    int width = CH8_DISPLAY_HIRES_WIDTH * scale;
+    int height = CH8_DISPLAY_HIRES_HEIGHT * scale;
+    size_t count = (size_t)width * height;
+
+    if (y4m) {
+        fprintf(f, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, CH8_RECORD_FRAME_RATE);
+    } else {
+        const u8 screen[] = {'G', 'I', 'F', '8', '9', 'a', (u8)width, (u8)(width >> 8), (u8)height, (u8)(height >> 8),
+                             0xF1, 0, 0};
+        const u8 loop[] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+        fwrite(screen, 1, sizeof(screen), f);
+        fwrite(ch8_palette, 1, sizeof(ch8_palette), f);
+        fwrite(loop, 1, sizeof(loop), f);
+    }
+
+    // GIF frames last until the picture changes; changes shorter than the minimum delay are skipped
+    std::vector<u8> pixels(count);
+    std::vector<u8> pending(count);
+    u64 pendingStart = 0;
+    u64 frames = 0;
+
+    ch8_recordFrame frame;
+    while (ch8_recordingNext(recording, &frame)) {
+        render(&frame, scale, pixels.data());
+
+        if (y4m) {
+            writeY4mFrame(f, pixels.data(), count);
+        } else if (frames == 0) {
+            pending.swap(pixels);
+        } else if (pixels != pending) {
+            int delay = centiseconds(frames) - centiseconds(pendingStart);
+            if (delay >= GIF_MIN_DELAY) {
+                gifWriteFrame(f, pending.data(), width, height, delay);
+                pendingStart = frames;
+            }
+            pending.swap(pixels);
+        }
+        frames++;
+    }
+
+    if (gif) {
+        if (frames > 0) {
+            int delay = ch8_max(centiseconds(frames) - centiseconds(pendingStart), GIF_MIN_DELAY);
+            gifWriteFrame(f, pending.data(), width, height, delay);
+        }
+        fputc(0x3B, f);
+    }
+
+    fclose(f);
+    ch8_recordingClose(&recording);
+
+    printf("Wrote %llu frames to %s\n", (unsigned long long)frames, output);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,704 @@
+// Static recompiler: finds the code reachable in a ROM and translates each
+// basic block into a C++ function for ch8_recompRun (src/ch8_recomp.h).
+//
+// usage: ch8_recomp <rom> -o <output.cpp> [-q quirks] [-n symbol] [--main]
+//
+// Control flow is followed through jumps, calls, returns and skips from the
+// entry point. BNNN targets are only known at run time, so they and any code
+// the analysis missed run on the interpreter, as does code the ROM overwrites.
+//
+// The output defines `const ch8_recompProgram <symbol>` (default
+// ch8_recompiled). With --main it also gets a headless runner, e.g.
+//   c++ -O2 -Isrc -o rom out.cpp src/ch8_recomp.cpp src/ch8_cpu.cpp
+//       src/ch8_opcodes.cpp src/ch8_trace.cpp src/ch8_log.cpp -lSDL2
+//   ./rom -f 600 --verify
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../src/ch8_cpu.h"
+#include "../src/ch8_disasm.h"
+#include "../src/ch8_recomp.h"
+
+typedef enum insnKind
+{
+    INSN_NEXT,     // falls through
+    INSN_JUMP,
+    INSN_CALL,
+    INSN_RETURN,
+    INSN_SKIP,
+    INSN_COMPUTED, // BNNN
+    INSN_WAIT,     // FX0A, ends the block so the caller sees the wait
+    INSN_STORE,    // writes memory, ends the block so code can be checked again
+    INSN_INTERPRET, // halts, invalid opcodes and anything not fully inside the ROM
+} insnKind;
+
+typedef struct insn
+{
+    u16 pc;
+    u16 opcode;
+    u16 size;
+    insnKind kind;
+    u16 target; // jump or call target, or the address a skip lands on
+    bool draws; // sets drawFlag
+    std::string code; // statements for INSN_NEXT and INSN_STORE; the rest are emitted by kind
+    bool handler;     // code calls an opcode handler, which needs the real PC and advances it
+} insn;
+
+typedef struct program
+{
+    const u8 *memory;
+    u32 start;
+    u32 end;
+    u32 quirks;
+} program;
+
+static std::string format(const char *fmt, ...)
+{
+    char buf[256];
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    va_end(va);
+    return buf;
+}
+
+static u16 readOpcode(const program &p, u32 addr)
+{
+    return (u16)(p.memory[addr] << 8 | p.memory[addr + 1]);
+}
+
+static bool inRom(const program &p, u32 addr, u32 size)
+{
+    return addr >= p.start && addr + size <= p.end;
+}
+
+// Mirrors the decoding in ch8_cpu.cpp's execute
+static insn decode(const program &p, u16 pc)
+{
+    insn in = {};
+    in.pc = pc;
+    in.size = CH8_PC_STEP_SIZE;
+    in.kind = INSN_INTERPRET;
+
+    if (!inRom(p, pc, CH8_PC_STEP_SIZE)) {
+        return in;
+    }
+
+    u16 op = readOpcode(p, pc);
+    u8 x = (op & 0x0F00) >> 8;
+    u8 y = (op & 0x00F0) >> 4;
+    u8 kk = op & 0x00FF;
+    u16 nnn = op & 0x0FFF;
+    in.opcode = op;
+
+    auto inlined = [&](std::string code) {
+        in.kind = INSN_NEXT;
+        in.code = code;
+    };
+    auto handler = [&](insnKind kind, std::string call) {
+        in.kind = kind;
+        in.code = call;
+        in.handler = true;
+    };
+    auto skip = [&](std::string condition) {
+        // The skipped instruction is four bytes if it is F000 NNNN
+        if (!inRom(p, pc + CH8_PC_STEP_SIZE, 2)) {
+            return;
+        }
+        bool isLong = readOpcode(p, pc + CH8_PC_STEP_SIZE) == 0xF000;
+        in.kind = INSN_SKIP;
+        in.target = pc + (isLong ? 3 : 2) * CH8_PC_STEP_SIZE;
+        in.code = condition;
+    };
+
+    std::string opcode = format("0x%04X", op);
+    std::string q = format("0x%02X", p.quirks & CH8_QUIRKS_SPECIALIZED);
+    std::string vx = format("cpu->V[0x%X]", x);
+    std::string vy = format("cpu->V[0x%X]", y);
+
+    switch (op & 0xF000)
+    {
+    case 0x0000:
+        if (op == 0) {
+            break;
+        }
+        in.draws = true;
+        if ((op & 0xFFF0) == 0x00C0) {
+            handler(INSN_NEXT, "ch8_op_ScrollDown(cpu, " + opcode + ");");
+            break;
+        }
+        switch (op & 0x00FF)
+        {
+        case 0x00E0:
+            handler(INSN_NEXT, "ch8_op_ClearDisplay(cpu);");
+            break;
+        case 0x00EE:
+            in.draws = false;
+            in.kind = INSN_RETURN;
+            break;
+        case 0x00FB:
+            handler(INSN_NEXT, "ch8_op_ScrollRight(cpu);");
+            break;
+        case 0x00FC:
+            handler(INSN_NEXT, "ch8_op_ScrollLeft(cpu);");
+            break;
+        case 0x00FE:
+            handler(INSN_NEXT, "ch8_op_LowRes(cpu);");
+            break;
+        case 0x00FF:
+            handler(INSN_NEXT, "ch8_op_HighRes(cpu);");
+            break;
+        default:
+            // Machine code calls don't advance the PC; leave them to the interpreter
+            in.draws = false;
+            break;
+        }
+        break;
+    case 0x1000:
+        in.kind = INSN_JUMP;
+        in.target = nnn;
+        break;
+    case 0x2000:
+        in.kind = INSN_CALL;
+        in.target = nnn;
+        break;
+    case 0x3000:
+        skip(vx + format(" == 0x%02X", kk));
+        break;
+    case 0x4000:
+        skip(vx + format(" != 0x%02X", kk));
+        break;
+    case 0x5000:
+        switch (op & 0x000F)
+        {
+        case 0x0:
+            skip(vx + " == " + vy);
+            break;
+        case 0x2:
+            handler(INSN_STORE, "ch8_op_StoreRange(cpu, " + opcode + ");");
+            break;
+        case 0x3:
+            handler(INSN_NEXT, "ch8_op_LoadRange(cpu, " + opcode + ");");
+            break;
+        }
+        break;
+    case 0x6000:
+        inlined(vx + format(" = 0x%02X;", kk));
+        break;
+    case 0x7000:
+        inlined(vx + format(" += 0x%02X;", kk));
+        break;
+    case 0x8000: {
+        std::string reset = (p.quirks & CH8_QUIRK_VF_RESET) != 0 ? " cpu->V[0xF] = 0;" : "";
+        std::string source = (p.quirks & CH8_QUIRK_SHIFT_VX) != 0 ? vx : vy;
+        switch (op & 0x000F)
+        {
+        case 0x0:
+            inlined(vx + " = " + vy + ";");
+            break;
+        case 0x1:
+            inlined(vx + " |= " + vy + ";" + reset);
+            break;
+        case 0x2:
+            inlined(vx + " &= " + vy + ";" + reset);
+            break;
+        case 0x3:
+            inlined(vx + " ^= " + vy + ";" + reset);
+            break;
+        // Flag and result are written in the handlers' order, which matters when X or Y is F
+        case 0x4:
+            inlined("{ u16 sum = " + vx + " + " + vy + "; cpu->V[0xF] = sum > 0xFF; " + vx + " = (u8)sum; }");
+            break;
+        case 0x5:
+            inlined("cpu->V[0xF] = 0; if (" + vx + " > " + vy + ") cpu->V[0xF] = 1; " + vx + " = " + vx + " - " + vy + ";");
+            break;
+        case 0x6:
+            inlined("{ u8 source = " + source + "; " + vx + " = source >> 1; cpu->V[0xF] = source & 0x1; }");
+            break;
+        case 0x7:
+            inlined("{ u8 vx = " + vx + ", vy = " + vy + "; " + vx + " = vy - vx; cpu->V[0xF] = vy >= vx; }");
+            break;
+        case 0xE:
+            inlined("{ u8 source = " + source + "; " + vx + " = source << 1; cpu->V[0xF] = source >> 7; }");
+            break;
+        }
+        break;
+    }
+    case 0x9000:
+        skip(vx + " != " + vy);
+        break;
+    case 0xA000:
+        inlined(format("cpu->index = 0x%03X;", nnn));
+        break;
+    case 0xB000:
+        in.kind = INSN_COMPUTED;
+        in.code = format("(u16)(0x%03X + cpu->V[0x%X])", nnn, (p.quirks & CH8_QUIRK_JUMP_VX) != 0 ? x : 0);
+        break;
+    case 0xC000:
+        inlined(vx + format(" = ch8_nextRandom(cpu) & 0x%02X;", kk));
+        break;
+    case 0xD000:
+        in.draws = true;
+        handler(INSN_NEXT, "ch8_op_DrawSprite<" + q + ">(cpu, " + opcode + ");");
+        break;
+    case 0xE000:
+        if (kk == 0x9E) {
+            skip(format("(cpu->keypad & (1 << 0x%X)) != 0", x));
+        } else if (kk == 0xA1) {
+            skip(format("(cpu->keypad & (1 << 0x%X)) == 0", x));
+        }
+        break;
+    case 0xF000:
+        switch (kk)
+        {
+        case 0x00:
+            if (op == 0xF000 && inRom(p, pc, 2 * CH8_PC_STEP_SIZE)) {
+                in.size = 2 * CH8_PC_STEP_SIZE;
+                inlined(format("cpu->index = 0x%04X;", readOpcode(p, pc + CH8_PC_STEP_SIZE)));
+            }
+            break;
+        case 0x01:
+            inlined(format("cpu->planeMask = 0x%X;", x & ((1 << CH8_NUM_PLANES) - 1)));
+            break;
+        case 0x07:
+            inlined(vx + " = cpu->delayTimer;");
+            break;
+        case 0x0A:
+            in.kind = INSN_WAIT;
+            in.code = format("cpu->waitFlag = true; cpu->waitReg = 0x%X;", x);
+            break;
+        case 0x15:
+            inlined("cpu->delayTimer = " + vx + ";");
+            break;
+        case 0x18:
+            inlined("cpu->soundTimer = " + vx + ";");
+            break;
+        case 0x1E:
+            inlined("cpu->index += " + vx + ";");
+            break;
+        case 0x29:
+            inlined("cpu->index = " + vx + " * 5;");
+            break;
+        case 0x30:
+            inlined("cpu->index = CH8_BIG_FONT_OFFSET + (" + vx + " & 0xF) * 10;");
+            break;
+        case 0x33:
+            handler(INSN_STORE, "ch8_op_StoreBinaryCodedDecimal(cpu, " + opcode + ");");
+            break;
+        case 0x55:
+            handler(INSN_STORE, "ch8_op_Store<" + q + ">(cpu, " + opcode + ");");
+            break;
+        case 0x65:
+            handler(INSN_NEXT, "ch8_op_Load<" + q + ">(cpu, " + opcode + ");");
+            break;
+        case 0x75:
+            handler(INSN_NEXT, "ch8_op_StoreFlags(cpu, " + opcode + ");");
+            break;
+        case 0x85:
+            handler(INSN_NEXT, "ch8_op_LoadFlags(cpu, " + opcode + ");");
+            break;
+        }
+        break;
+    }
+
+    if (in.kind != INSN_INTERPRET && !inRom(p, pc, in.size)) {
+        in.kind = INSN_INTERPRET;
+    }
+
+    return in;
+}
+
+static bool endsBlock(const insn &in)
+{
+    return in.kind != INSN_NEXT;
+}
+
+typedef struct analysis
+{
+    std::vector<bool> reached; // per address
+    std::vector<bool> leader;
+    u32 instructions;
+} analysis;
+
+static analysis recoverControlFlow(const program &p)
+{
+    analysis a;
+    a.reached.assign(CH8_MEM_SIZE, false);
+    a.leader.assign(CH8_MEM_SIZE, false);
+    a.instructions = 0;
+
+    std::vector<u16> work = {(u16)p.start};
+    a.leader[p.start] = true;
+
+    auto visit = [&](u16 addr, bool isLeader) {
+        if (isLeader) {
+            a.leader[addr] = true;
+        }
+        if (!a.reached[addr]) {
+            work.push_back(addr);
+        }
+    };
+
+    while (!work.empty()) {
+        u16 pc = work.back();
+        work.pop_back();
+        if (a.reached[pc] || !inRom(p, pc, CH8_PC_STEP_SIZE)) {
+            continue;
+        }
+        a.reached[pc] = true;
+        a.instructions++;
+
+        insn in = decode(p, pc);
+        u16 next = pc + in.size;
+
+        switch (in.kind)
+        {
+        case INSN_NEXT:
+            visit(next, false);
+            break;
+        case INSN_WAIT:
+        case INSN_STORE:
+            visit(next, true);
+            break;
+        case INSN_JUMP:
+            visit(in.target, true);
+            break;
+        case INSN_CALL:
+            visit(in.target, true);
+            visit(next, true);
+            break;
+        case INSN_SKIP:
+            visit(next, true);
+            visit(in.target, true);
+            break;
+        case INSN_RETURN:
+        case INSN_COMPUTED:
+        case INSN_INTERPRET:
+            break;
+        }
+    }
+
+    return a;
+}
+
+static void emitComment(FILE *f, const insn &in)
+{
+    char text[CH8_DISASM_MAX_LEN];
+    ch8_disassemble(in.opcode, text, sizeof(text));
+    fprintf(f, "    // %04X: %04X  %s\n", in.pc, in.opcode, text);
+}
+
+// Emits one block function; returns its instruction count
+static u32 emitBlock(FILE *f, const program &p, const analysis &a, u16 start, u32 *end, bool *stores)
+{
+    std::vector<insn> body;
+    for (u32 pc = start;;) {
+        insn in = decode(p, (u16)pc);
+        if (in.kind == INSN_INTERPRET) {
+            break;
+        }
+        body.push_back(in);
+        pc += in.size;
+        // A ROM filling memory ends its last block at CH8_MEM_SIZE
+        if (endsBlock(in) || pc >= p.end || a.leader[pc]) {
+            break;
+        }
+    }
+
+    u32 count = (u32)body.size();
+    const insn &last = body.back();
+    *end = (u32)last.pc + last.size;
+    *stores = last.kind == INSN_STORE;
+
+    fprintf(f, "static u32 block_%04X(ch8_cpu *cpu)\n{\n", start);
+    fprintf(f, "    cpu->drawFlag = false;\n    cpu->waitFlag = false;\n    cpu->waitReg = 0;\n\n");
+
+    // Inlined instructions leave the PC behind; it is only stored before a handler reads it and at the end
+    bool pcSynced = true;
+
+    for (u32 i = 0; i < count; i++) {
+        const insn &in = body[i];
+        u16 next = in.pc + in.size;
+
+        emitComment(f, in);
+        if (in.handler && !pcSynced) {
+            fprintf(f, "    cpu->programCounter = 0x%04X;\n", in.pc);
+        }
+
+        switch (in.kind)
+        {
+        case INSN_NEXT:
+        case INSN_STORE:
+            fprintf(f, "    %s\n", in.code.c_str());
+            pcSynced = in.handler;
+            break;
+        case INSN_JUMP:
+            fprintf(f, "    cpu->programCounter = 0x%04X;\n", in.target);
+            break;
+        case INSN_COMPUTED:
+            fprintf(f, "    cpu->programCounter = %s;\n", in.code.c_str());
+            break;
+        case INSN_SKIP:
+            fprintf(f, "    cpu->programCounter = %s ? 0x%04X : 0x%04X;\n", in.code.c_str(), in.target, next);
+            break;
+        case INSN_WAIT:
+            fprintf(f, "    %s\n    cpu->programCounter = 0x%04X;\n", in.code.c_str(), next);
+            break;
+        case INSN_CALL:
+        case INSN_RETURN: {
+            bool call = in.kind == INSN_CALL;
+            fprintf(f, "    if (cpu->stackPointer %s) {\n", call ? ">= CH8_STACK_DEPTH" : "== 0");
+            fprintf(f, "        cpu->fault = %s;\n", call ? "CH8_FAULT_STACK_OVERFLOW" : "CH8_FAULT_STACK_UNDERFLOW");
+            fprintf(f, "        cpu->programCounter = 0x%04X;\n", in.pc);
+            fprintf(f, "        cpu->cycles += %u;\n", i);
+            fprintf(f, "        ch8_logError(\"%%s at %%X\", ch8_faultName((ch8_fault)cpu->fault), 0x%04X);\n", in.pc);
+            fprintf(f, "        return %u;\n    }\n", i);
+            if (call) {
+                fprintf(f, "    cpu->stack[cpu->stackPointer++] = 0x%04X;\n", in.pc);
+                fprintf(f, "    cpu->programCounter = 0x%04X;\n", in.target);
+            } else {
+                fprintf(f, "    cpu->programCounter = cpu->stack[--cpu->stackPointer] + CH8_PC_STEP_SIZE;\n");
+            }
+            break;
+        }
+        case INSN_INTERPRET:
+            break;
+        }
+
+        if (in.kind != INSN_NEXT && in.kind != INSN_STORE) {
+            pcSynced = true;
+        }
+        if (in.draws && i + 1 < count) {
+            fprintf(f, "    cpu->drawFlag = false;\n");
+        }
+    }
+
+    if (!pcSynced) {
+        fprintf(f, "    cpu->programCounter = 0x%04X;\n", *end & 0xFFFF);
+    }
+    fprintf(f, "\n    cpu->cycles += %u;\n    return %u;\n}\n\n", count, count);
+
+    return count;
+}
+
+static void emitMain(FILE *f, const char *symbol)
+{
+    fprintf(f, "%s",
+            "// Headless runner: no input, stops when the ROM halts or waits for a key\n"
+            "#include <chrono>\n"
+            "\n"
+            "static ch8_cpu vm;\n"
+            "static ch8_cpu reference;\n"
+            "\n"
+            "static void boot(ch8_cpu *cpu)\n"
+            "{\n"
+            "    ch8_reset(cpu);\n");
+    fprintf(f, "    ch8_loadRomData(cpu, %s.rom, %s.size);\n    ch8_setQuirks(cpu, %s.quirks);\n}\n\n", symbol, symbol,
+            symbol);
+    fprintf(f, "%s",
+            "static void tick(ch8_cpu *cpu)\n"
+            "{\n"
+            "    cpu->delayTimer = cpu->delayTimer > 0 ? cpu->delayTimer - 1 : 0;\n"
+            "    cpu->soundTimer = cpu->soundTimer > 0 ? cpu->soundTimer - 1 : 0;\n"
+            "}\n"
+            "\n"
+            "int main(int argc, char *argv[])\n"
+            "{\n"
+            "    u32 frames = 600;\n"
+            "    u32 cyclesPerFrame = 1000;\n"
+            "    bool verify = false;\n"
+            "\n"
+            "    for (int i = 1; i < argc; i++) {\n"
+            "        if (strcmp(argv[i], \"-f\") == 0 && i + 1 < argc) {\n"
+            "            frames = (u32)strtoul(argv[++i], NULL, 10);\n"
+            "        } else if (strcmp(argv[i], \"-c\") == 0 && i + 1 < argc) {\n"
+            "            cyclesPerFrame = (u32)strtoul(argv[++i], NULL, 10);\n"
+            "        } else if (strcmp(argv[i], \"--verify\") == 0) {\n"
+            "            verify = true;\n"
+            "        } else {\n"
+            "            fprintf(stderr, \"usage: %s [-f frames] [-c cycles per frame] [--verify]\\n\", argv[0]);\n"
+            "            return EXIT_FAILURE;\n"
+            "        }\n"
+            "    }\n"
+            "\n"
+            "    boot(&vm);\n"
+            "    boot(&reference);\n"
+            "\n"
+            "    auto start = std::chrono::steady_clock::now();\n"
+            "    u32 frame = 0;\n"
+            "    for (; frame < frames; frame++) {\n");
+    fprintf(f, "        u32 ran = ch8_recompRun(&%s, &vm, cyclesPerFrame);\n", symbol);
+    fprintf(f, "%s",
+            "\n"
+            "        // The interpreter runs alongside and every frame's state must match exactly\n"
+            "        if (verify) {\n"
+            "            u32 expected = 0;\n"
+            "            while (expected < cyclesPerFrame && !reference.waitFlag && ch8_clockCycle(&reference, 0.0f)) {\n"
+            "                expected++;\n"
+            "            }\n"
+            "            if (ran != expected || memcmp(&vm, &reference, sizeof(vm)) != 0) {\n"
+            "                fprintf(stderr, \"Frame %u: state differs from the interpreter (PC %04X vs %04X)\\n\", frame,\n"
+            "                        vm.programCounter, reference.programCounter);\n"
+            "                return EXIT_FAILURE;\n"
+            "            }\n"
+            "            tick(&reference);\n"
+            "        }\n"
+            "        tick(&vm);\n"
+            "\n"
+            "        if (ran < cyclesPerFrame) {\n"
+            "            break;\n"
+            "        }\n"
+            "    }\n"
+            "    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();\n"
+            "\n"
+            "    printf(\"%u frames, %llu instructions in %.3f ms%s\\n\", frame, (unsigned long long)vm.cycles,\n"
+            "           seconds * 1000.0, vm.waitFlag ? \", waiting for a key\" : vm.fault != CH8_FAULT_NONE ? \", faulted\"\n"
+            "           : frame < frames ? \", halted\" : \"\");\n"
+            "    if (verify) {\n"
+            "        printf(\"Matches the interpreter\\n\");\n"
+            "    }\n"
+            "\n"
+            "    int width = vm.hires ? CH8_DISPLAY_HIRES_WIDTH : CH8_DISPLAY_WIDTH;\n"
+            "    int height = vm.hires ? CH8_DISPLAY_HIRES_HEIGHT : CH8_DISPLAY_HEIGHT;\n"
+            "    for (int y = 0; y < height; y++) {\n"
+            "        for (int x = 0; x < width; x++) {\n"
+            "            putchar(ch8_getPixelColor(&vm, x, y) != 0 ? '#' : ' ');\n"
+            "        }\n"
+            "        putchar('\\n');\n"
+            "    }\n"
+            "\n"
+            "    return EXIT_SUCCESS;\n"
+            "}\n");
+}
+
+static const char *quirkProfileName(u32 quirks)
+{
+    static const char *names[] = {"legacy", "cosmac", "schip", "xochip", "vip"};
+    for (const char *name : names) {
+        u32 profile;
+        if (ch8_findQuirkProfile(name, &profile) && profile == quirks) {
+            return name;
+        }
+    }
+    return "custom";
+}
+
+int main(int argc, char *argv[])
+{
+    const char *rom = NULL;
+    const char *output = NULL;
+    const char *symbol = "ch8_recompiled";
+    u32 quirks = CH8_QUIRKS_LEGACY;
+    bool withMain = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            symbol = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            if (!ch8_findQuirkProfile(argv[++i], &quirks)) {
+                fprintf(stderr, "Unknown quirk profile %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--main") == 0) {
+            withMain = true;
+        } else {
+            rom = argv[i];
+        }
+    }
+
+    if (rom == NULL || output == NULL) {
+        fprintf(stderr, "usage: %s <rom> -o <output.cpp> [-q quirks] [-n symbol] [--main]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The VIP layout mirrors memory after every instruction, which blocks can't batch
+    if ((quirks & CH8_QUIRK_VIP_LAYOUT) != 0) {
+        fprintf(stderr, "The %s profile can't be recompiled\n", quirkProfileName(quirks));
+        return EXIT_FAILURE;
+    }
+
+    FILE *in = fopen(rom, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Could not open %s\n", rom);
+        return EXIT_FAILURE;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fclose(in);
+
+    static ch8_cpu cpu;
+    ch8_reset(&cpu);
+    if (size <= 0 || !ch8_loadRomFile(&cpu, rom)) {
+        fprintf(stderr, "Could not load %s\n", rom);
+        return EXIT_FAILURE;
+    }
+
+    program p = {cpu.memory, CH8_PROGRAM_START_OFFSET, CH8_PROGRAM_START_OFFSET + (u32)size, quirks};
+    analysis a = recoverControlFlow(p);
+
+    FILE *f = fopen(output, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Could not create %s\n", output);
+        return EXIT_FAILURE;
+    }
+
+    const char *base = strrchr(rom, '/') != NULL ? strrchr(rom, '/') + 1 : rom;
+    fprintf(f, "// Generated by ch8_recomp from %s (%ld bytes, %s quirks). Do not edit.\n\n", base, size,
+            quirkProfileName(quirks));
+    fprintf(f, "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+    fprintf(f, "#include \"ch8_cpu.h\"\n#include \"ch8_log.h\"\n#include \"ch8_opcodes.h\"\n#include \"ch8_quirks.h\"\n"
+               "#include \"ch8_recomp.h\"\n\n");
+
+    fprintf(f, "static const u8 rom[] = {");
+    for (long i = 0; i < size; i++) {
+        fprintf(f, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", p.memory[p.start + i]);
+    }
+    fprintf(f, "\n};\n\n");
+
+    std::vector<ch8_recompBlock> blocks;
+    u32 compiled = 0;
+    for (u32 pc = p.start; pc < p.end; pc++) {
+        if (!a.leader[pc] || !a.reached[pc] || decode(p, (u16)pc).kind == INSN_INTERPRET) {
+            continue;
+        }
+        ch8_recompBlock block = {};
+        block.start = (u16)pc;
+        block.length = emitBlock(f, p, a, (u16)pc, &block.end, &block.stores);
+        blocks.push_back(block);
+        compiled += block.length;
+    }
+
+    fprintf(f, "static const ch8_recompBlock blocks[] = {\n");
+    for (const ch8_recompBlock &block : blocks) {
+        fprintf(f, "    {0x%04X, 0x%04X, %u, %s, block_%04X},\n", block.start, block.end, block.length,
+                block.stores ? "true" : "false", block.start);
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "static const ch8_recompBlock *lookup(u16 pc)\n{\n    switch (pc)\n    {\n");
+    for (size_t i = 0; i < blocks.size(); i++) {
+        fprintf(f, "    case 0x%04X:\n        return &blocks[%zu];\n", blocks[i].start, i);
+    }
+    fprintf(f, "    default:\n        return NULL;\n    }\n}\n\n");
+
+    fprintf(f, "extern const ch8_recompProgram %s = {rom, sizeof(rom), 0x%02X, lookup};\n", symbol, quirks);
+
+    if (withMain) {
+        fprintf(f, "\n");
+        emitMain(f, symbol);
+    }
+
+    fclose(f);
+
+    printf("%s: %u reachable instructions, %zu blocks with %u instructions translated\n", base, a.instructions,
+           blocks.size(), compiled);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// Decodes a binary instruction trace written by ch8_traceFlush or the crash handler.
+//
+// usage: ch8_tracedump <trace file> [-n <last N records>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/ch8_disasm.h"
+#include "../src/ch8_trace.h"
+
+// Register whose new value is stored in the record's `vx` field, -1 if none
+static int writtenRegister(u16 opcode)
+{
+    u8 x = (opcode & 0x0F00) >> 8;
+
+    switch (opcode & 0xF000)
+    {
+    case 0x6000:
+    case 0x7000:
+    case 0x8000:
+    case 0xC000:
+        return x;
+    case 0xF000:
+        switch (opcode & 0x00FF)
+        {
+        case 0x07:
+        case 0x0A:
+        case 0x65:
+            return x;
+        }
+        break;
+    }
+
+    return -1;
+}
+
+static bool writesFlag(u16 opcode)
+{
+    switch (opcode & 0xF000)
+    {
+    case 0x8000: {
+        u8 n = opcode & 0x000F;
+        return (n >= 0x4 && n <= 0x7) || n == 0xE;
+    }
+    case 0xD000:
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *file = NULL;
+    u32 last = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            last = (u32)strtoul(argv[++i], NULL, 10);
+        } else {
+            file = argv[i];
+        }
+    }
+
+    if (file == NULL) {
+        fprintf(stderr, "usage: %s <trace file> [-n <last N records>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Could not open %s\n", file);
+        return EXIT_FAILURE;
+    }
+
+    ch8_traceHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, CH8_TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not a CHIP-8 trace file\n", file);
+        fclose(f);
+        return EXIT_FAILURE;
+    }
+    if (header.version != CH8_TRACE_VERSION || header.recordSize != sizeof(ch8_traceRecord)) {
+        fprintf(stderr, "Unsupported trace version %u (record size %u)\n", header.version, header.recordSize);
+        fclose(f);
+        return EXIT_FAILURE;
+    }
+
+    u32 skip = 0;
+    if (last != 0 && last < header.count) {
+        skip = header.count - last;
+        fseek(f, (long)(skip * sizeof(ch8_traceRecord)), SEEK_CUR);
+    }
+
+    printf("; %u records shown, %u older records not shown\n", header.count - skip, header.overwritten + skip);
+    printf("; %-10s %-5s %-6s %-18s %-6s %s\n", "cycle", "pc", "op", "instruction", "I", "writes");
+
+    ch8_traceRecord rec;
+    char text[CH8_DISASM_MAX_LEN];
+    for (u32 i = skip; i < header.count; i++) {
+        if (fread(&rec, sizeof(rec), 1, f) != 1) {
+            fprintf(stderr, "Trace truncated after %u records\n", i);
+            break;
+        }
+
+        ch8_disassemble(rec.opcode, text, sizeof(text));
+        printf("  %-10u %04X  %04X   %-18s %04X  ", rec.cycle, rec.programCounter, rec.opcode, text, rec.index);
+
+        int reg = writtenRegister(rec.opcode);
+        if (reg >= 0) {
+            printf(" V%X=%02X", reg, rec.vx);
+        }
+        if (writesFlag(rec.opcode) && reg != 0xF) {
+            printf(" VF=%02X", rec.vf);
+        }
+        printf("\n");
+    }
+
+    fclose(f);
+
+    return EXIT_SUCCESS;
+}